@@ -0,0 +1,470 @@
+/*
+ * bench.c - Micro-benchmarks for the runtime's own machinery: translation,
+ *           block lookup, the page directory, block destruction,
+ *           checksumming and callbacks.  Each benchmark reports the time
+ *           and the number of xmalloc/xrealloc/xcalloc calls per
+ *           operation, so changes to one subsystem can be measured on
+ *           their own.
+ *
+ *   Like test/testrt.c, this has to include private header files
+ *   belonging to the runtime system because there is no official
+ *   outside interface to blocks; don't do this at home.
+ *
+ *   Usage: syn68kbench [-n num_blocks] [-r repetitions] [benchmark ...]
+ */
+
+#include "syn68k_public.h"
+#include "../runtime/include/block.h"
+#include "../runtime/include/alloc.h"
+#include "../runtime/include/translate.h"
+#include "../runtime/include/hash.h"
+#include "../runtime/include/pagedir.h"
+#include "../runtime/include/destroyblock.h"
+#include "../runtime/include/checksum.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MEM_SIZE (1024 * 1024)
+#define CORPUS_BASE 0x10000
+#define CORPUS_STRIDE 64    /* Bytes of 68k code per corpus entry. */
+#define MAX_CORPUS ((MEM_SIZE - CORPUS_BASE) / CORPUS_STRIDE)
+
+static uint8 *mem;
+static uint32 trap_vectors[64];
+static unsigned long num_blocks = 4096;
+static unsigned long repetitions = 5;
+static unsigned my_random_seed = 9;
+
+static struct timespec start_time;
+static unsigned long start_allocs;
+static double elapsed_ns;
+static unsigned long elapsed_allocs;
+
+
+static inline uint32
+my_random ()
+{
+  my_random_seed = (my_random_seed * 1233143127) ^ (my_random_seed >> 13);
+  return my_random_seed & 0x7FFFFFFF;
+}
+
+
+static inline syn68k_addr_t
+corpus_address (unsigned long i)
+{
+  return CORPUS_BASE + i * CORPUS_STRIDE;
+}
+
+
+static inline void
+write_word (syn68k_addr_t addr, uint16 w)
+{
+  mem[addr]     = w >> 8;
+  mem[addr + 1] = w;
+}
+
+
+/* Fills the corpus with NUM_BLOCKS small routines built from a mix of
+ * common, cheap instructions.  Straight line routines are one block
+ * each; branchy ones end in a conditional branch and so translate to
+ * three blocks.
+ */
+static void
+make_corpus (BOOL branchy_p)
+{
+  unsigned long i;
+
+  for (i = 0; i < num_blocks; i++)
+    {
+      syn68k_addr_t a = corpus_address (i);
+      syn68k_addr_t end = a + CORPUS_STRIDE - (branchy_p ? 8 : 2);
+
+      while (a + 6 <= end)
+	{
+	  int dn = my_random () & 7, dm = my_random () & 7;
+
+	  switch (my_random () % 8)
+	    {
+	    case 0:  /* moveq #imm,Dn */
+	      write_word (a, 0x7000 | (dn << 9) | (my_random () & 0xFF));
+	      a += 2;
+	      break;
+	    case 1:  /* add.l Dm,Dn */
+	      write_word (a, 0xD080 | (dn << 9) | dm);
+	      a += 2;
+	      break;
+	    case 2:  /* addq.l #1,Dn */
+	      write_word (a, 0x5280 | dn);
+	      a += 2;
+	      break;
+	    case 3:  /* move.l Dm,Dn */
+	      write_word (a, 0x2000 | (dn << 9) | dm);
+	      a += 2;
+	      break;
+	    case 4:  /* lsl.l #1,Dn */
+	      write_word (a, 0xE388 | dn);
+	      a += 2;
+	      break;
+	    case 5:  /* tst.l Dn */
+	      write_word (a, 0x4A80 | dn);
+	      a += 2;
+	      break;
+	    case 6:  /* lea d16(A0),A0 */
+	      write_word (a, 0x41E8);
+	      write_word (a + 2, my_random () & 0xFFFE);
+	      a += 4;
+	      break;
+	    default:  /* addi.l #imm,Dn */
+	      write_word (a, 0x0680 | dn);
+	      write_word (a + 2, my_random ());
+	      write_word (a + 4, my_random ());
+	      a += 6;
+	      break;
+	    }
+	}
+
+      if (branchy_p)
+	{
+	  write_word (a, 0x6602);      /* bne.s *+4 */
+	  write_word (a + 2, 0x4E75);  /* rts */
+	  write_word (a + 4, 0x7000);  /* moveq #0,d0 */
+	  write_word (a + 6, 0x4E75);  /* rts */
+	}
+      else
+	write_word (a, 0x4E75);        /* rts */
+    }
+}
+
+
+static void
+translate_corpus ()
+{
+  unsigned long i;
+
+  for (i = 0; i < num_blocks; i++)
+    hash_lookup_code_and_create_if_needed (corpus_address (i));
+}
+
+
+static void
+flush_all ()
+{
+  destroy_blocks (0, ~0);
+}
+
+
+/* Timing.  bench_pause and bench_resume bracket untimed setup work
+ * between bench_start and bench_stop.
+ */
+static void
+bench_resume ()
+{
+  start_allocs = xalloc_count;
+  clock_gettime (CLOCK_MONOTONIC, &start_time);
+}
+
+
+static void
+bench_pause ()
+{
+  struct timespec end_time;
+
+  clock_gettime (CLOCK_MONOTONIC, &end_time);
+  elapsed_ns += ((end_time.tv_sec - start_time.tv_sec) * 1e9
+		 + (end_time.tv_nsec - start_time.tv_nsec));
+  elapsed_allocs += xalloc_count - start_allocs;
+}
+
+
+static void
+bench_start ()
+{
+  elapsed_ns = 0;
+  elapsed_allocs = 0;
+  bench_resume ();
+}
+
+
+static void
+bench_stop (const char *name, unsigned long ops)
+{
+  bench_pause ();
+  printf ("%-28s %10lu %12.1f %10.2f\n", name, ops,
+	  ops ? elapsed_ns / ops : 0.0,
+	  ops ? (double) elapsed_allocs / ops : 0.0);
+}
+
+
+static void
+bench_generate (BOOL branchy_p, const char *name)
+{
+  unsigned long r, i;
+  Block *b;
+
+  make_corpus (branchy_p);
+  flush_all ();
+
+  bench_start ();
+  for (r = 0; r < repetitions; r++)
+    {
+      for (i = 0; i < num_blocks; i++)
+	generate_block (NULL, corpus_address (i), &b, FALSE);
+      bench_pause ();
+      flush_all ();
+      bench_resume ();
+    }
+  bench_stop (name, repetitions * num_blocks);
+}
+
+
+static void
+bench_generate_straight ()
+{
+  bench_generate (FALSE, "generate/straight");
+}
+
+
+static void
+bench_generate_branchy ()
+{
+  bench_generate (TRUE, "generate/branchy");
+}
+
+
+static void
+bench_lookup ()
+{
+  unsigned long r, i;
+
+  make_corpus (FALSE);
+  flush_all ();
+
+  bench_start ();
+  translate_corpus ();
+  bench_stop ("lookup/miss", num_blocks);
+
+  bench_start ();
+  for (r = 0; r < repetitions * 100; r++)
+    for (i = 0; i < num_blocks; i++)
+      hash_lookup_code_and_create_if_needed (corpus_address (i));
+  bench_stop ("lookup/hit", repetitions * 100 * num_blocks);
+
+  flush_all ();
+}
+
+
+static void
+bench_page_dir ()
+{
+  Block **blocks;
+  unsigned long r, i;
+  syn68k_addr_t *addrs;
+
+  blocks = (Block **) xmalloc (num_blocks * sizeof blocks[0]);
+  for (i = 0; i < num_blocks; i++)
+    {
+      blocks[i] = block_new ();
+      blocks[i]->m68k_start_address = (my_random () % MEM_SIZE) & ~1;
+      blocks[i]->m68k_code_length = 2 + (my_random () % 32) * 2;
+    }
+
+  bench_start ();
+  for (r = 0; r < repetitions; r++)
+    {
+      for (i = 0; i < num_blocks; i++)
+	page_dir_insert (blocks[i]);
+      if (r != repetitions - 1)
+	for (i = 0; i < num_blocks; i++)
+	  page_dir_remove (blocks[i]);
+    }
+  bench_stop ("pagedir/insert+remove", (2 * repetitions - 1) * num_blocks);
+
+  bench_start ();
+  for (i = 0; i < num_blocks * repetitions; i++)
+    {
+      syn68k_addr_t low = (my_random () % MEM_SIZE) & ~1;
+      page_dir_find_intersecting (low, low + 255, &addrs);
+      free (addrs);
+    }
+  bench_stop ("pagedir/intersect", num_blocks * repetitions);
+
+  for (i = 0; i < num_blocks; i++)
+    {
+      page_dir_remove (blocks[i]);
+      block_free (blocks[i]);
+    }
+  free (blocks);
+}
+
+
+static void
+bench_destroy ()
+{
+  unsigned long r, i;
+
+  make_corpus (FALSE);
+  flush_all ();
+
+  translate_corpus ();
+  bench_start ();
+  for (i = 0; i < num_blocks; i++)
+    destroy_blocks (corpus_address (i) + 2, 2);
+  bench_stop ("destroy/small-range", num_blocks);
+
+  /* Reported per block flushed. */
+  bench_start ();
+  for (r = 0; r < repetitions; r++)
+    {
+      bench_pause ();
+      translate_corpus ();
+      bench_resume ();
+      flush_all ();
+    }
+  bench_stop ("destroy/full-flush", repetitions * num_blocks);
+}
+
+
+static void
+bench_checksum ()
+{
+  Block **blocks;
+  unsigned long r, i;
+  volatile uint32 sum;
+
+  make_corpus (FALSE);
+  flush_all ();
+  translate_corpus ();
+
+  blocks = (Block **) xmalloc (num_blocks * sizeof blocks[0]);
+  for (i = 0; i < num_blocks; i++)
+    blocks[i] = hash_lookup (corpus_address (i));
+
+  sum = 0;
+  bench_start ();
+  for (r = 0; r < repetitions * 10; r++)
+    for (i = 0; i < num_blocks; i++)
+      sum += compute_block_checksum (blocks[i]);
+  bench_stop ("checksum", repetitions * 10 * num_blocks);
+
+  free (blocks);
+  flush_all ();
+}
+
+
+static syn68k_addr_t
+dummy_callback (syn68k_addr_t addr, void *arg)
+{
+  return addr;
+}
+
+
+static void
+bench_callback ()
+{
+  unsigned long i;
+
+  bench_start ();
+  for (i = 0; i < num_blocks * repetitions; i++)
+    callback_remove (callback_install (dummy_callback, NULL));
+  bench_stop ("callback/install+remove", num_blocks * repetitions);
+}
+
+
+static const struct
+{
+  const char *name;
+  void (*func) (void);
+} benchmark[] = {
+  { "generate",  bench_generate_straight },
+  { "generate",  bench_generate_branchy },
+  { "lookup",    bench_lookup },
+  { "pagedir",   bench_page_dir },
+  { "destroy",   bench_destroy },
+  { "checksum",  bench_checksum },
+  { "callback",  bench_callback },
+};
+
+#define NUM_BENCHMARKS (sizeof benchmark / sizeof benchmark[0])
+
+
+/* Makes MEM the 68k address space, along with the callback stubs and trap
+ * vectors, which live in our own data.
+ */
+static void
+setup_memory ()
+{
+  mem = calloc (MEM_SIZE, 1);
+#if SIZEOF_CHAR_P == 4 && !defined (TWENTYFOUR_BIT_ADDRESSING)
+  ROMlib_offset = (uintptr_t) mem;
+#else
+  {
+    uint64 lo = (uint64) callback_dummy_address_space;
+    uint64 hi = (uint64) trap_vectors;
+
+    if (hi < lo)
+      {
+	uint64 t = lo;
+	lo = hi;
+	hi = t;
+      }
+    lo &= ~(uint64) 0xFFF;
+    hi += 0x10000;
+
+    ROMlib_offsets[0] = (uint64) mem;
+    ROMlib_sizes[0] = MEM_SIZE;
+    ROMlib_offsets[1] = lo - (1ULL << (ADDRESS_BITS - OFFSET_TABLE_BITS));
+    ROMlib_sizes[1] = hi - lo;
+  }
+#endif
+}
+
+
+int
+main (int argc, char *argv[])
+{
+  int i, first_name;
+  unsigned long j;
+
+  for (i = 1; i < argc && argv[i][0] == '-'; i += 2)
+    {
+      if (i + 1 >= argc)
+	goto usage;
+      if (!strcmp (argv[i], "-n"))
+	num_blocks = strtoul (argv[i + 1], NULL, 0);
+      else if (!strcmp (argv[i], "-r"))
+	repetitions = strtoul (argv[i + 1], NULL, 0);
+      else
+	goto usage;
+    }
+  first_name = i;
+
+  if (num_blocks == 0 || num_blocks > MAX_CORPUS || repetitions == 0)
+    goto usage;
+
+  setup_memory ();
+  initialize_68k_emulator (NULL, FALSE, trap_vectors, 0);
+
+  printf ("%-28s %10s %12s %10s\n", "benchmark", "ops", "ns/op",
+	  "allocs/op");
+  for (j = 0; j < NUM_BENCHMARKS; j++)
+    {
+      BOOL run_p = (first_name >= argc);
+
+      for (i = first_name; i < argc; i++)
+	if (!strcmp (argv[i], benchmark[j].name))
+	  run_p = TRUE;
+      if (run_p)
+	benchmark[j].func ();
+    }
+
+  return EXIT_SUCCESS;
+
+ usage:
+  fprintf (stderr, "Usage: %s [-n num_blocks] [-r repetitions] "
+	   "[generate|lookup|pagedir|destroy|checksum|callback ...]\n"
+	   "num_blocks must be between 1 and %lu.\n",
+	   argv[0], (unsigned long) MAX_CORPUS);
+  return EXIT_FAILURE;
+}
@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <setjmp.h>
+#include <stdio.h>
 
 #ifdef __cplusplus
 extern "C"
@@ -159,6 +160,12 @@ typedef struct {
 			  * the value here will be outdated. */
   volatile uint8 interrupt_pending[8];     /* 1 if interrupt pending. */ 
   volatile TrapHandlerInfo trap_handler_info[64];
+  uint64 instructions_executed;   /* 68k instructions run, when counted.   */
+  int64 block_budget;             /* Blocks left in this slice.            */
+  int64 instruction_budget;       /* 68k instructions left in this slice.  */
+  syn68k_addr_t resume_address;   /* Where an exhausted slice stopped.     */
+  double fpreg[8];                /* fp0...fp7, if emulating the FPU.      */
+  uint32 fpcr, fpsr, fpiar;       /* FPU control/status/address registers. */
 #endif /* !MINIMAL_CPU_STATE */
 } CPUState;
 
@@ -464,9 +471,22 @@ extern CPUState cpu_state;
 #define INTERRUPT_STATUS_CHANGED    (-1)
 #define INTERRUPT_STATUS_UNCHANGED  0x7FFFFFFF
 
+/* Interrupts may be posted from other threads or signal handlers, so
+ * the status word is accessed atomically where the compiler allows.
+ * The poll itself is a relaxed load, which costs no more than the
+ * plain volatile read; stores are sequentially consistent so a post
+ * can't slip between clearing the status and scanning for interrupts.
+ */
+#if defined (__GNUC__)
+#define FETCH_INTERRUPT_STATUS() \
+__atomic_load_n (&cpu_state.interrupt_status_changed, __ATOMIC_RELAXED)
+#define SET_INTERRUPT_STATUS(n) \
+__atomic_store_n (&cpu_state.interrupt_status_changed, (n), __ATOMIC_SEQ_CST)
+#else
 #define FETCH_INTERRUPT_STATUS() cpu_state.interrupt_status_changed
 #define SET_INTERRUPT_STATUS(n) \
 ((void) (cpu_state.interrupt_status_changed = (n)))
+#endif
 
 
 #define INTERRUPT_PENDING() (FETCH_INTERRUPT_STATUS () < 0)
@@ -474,7 +494,13 @@ extern CPUState cpu_state;
 #endif /* SYNCHRONOUS_INTERRUPTS */
 
 
-/* Functions to be called from outside the emulator. */
+/* Functions to be called from outside the emulator.  Entry points added
+ * since the original interface are named syn68k_*, so they can't collide
+ * with names in the host, which includes this header everywhere.  The
+ * older unprefixed ones (interrupt_generate, callback_install,
+ * trap_install_handler and so on) keep their names because existing
+ * hosts link against them.
+ */
 extern void initialize_68k_emulator (void (*while_busy)(int), int native_p,
 				     uint32 trap_vector_storage[64],
 				     uint32 dos_int_flag_addr);
@@ -489,6 +515,11 @@ extern void initialize_68k_emulator (void (*while_busy)(int), int native_p,
 #if defined (SYNCHRONOUS_INTERRUPTS)
 extern void interrupt_generate (unsigned priority);
 extern void interrupt_note_if_present (void);
+/* Parking a host thread until an interrupt comes in; see interrupt.c. */
+extern int syn68k_interrupt_wait (int32 timeout_msecs);
+extern void syn68k_interrupt_wake (void);
+/* Parking the host when 68k code spins in an idle loop; see idle.c. */
+extern void syn68k_idle_loop_set_threshold (uint32 spins, int32 park_msecs);
 /* called from `host_interrupt_status_changed' assembly stub in
    host-native.c */
 extern syn68k_addr_t interrupt_process_any_pending(syn68k_addr_t pc)
@@ -497,6 +528,27 @@ extern syn68k_addr_t interrupt_process_any_pending(syn68k_addr_t pc)
 #endif /* SYNCHRONOUS_INTERRUPTS */
 
 extern void interpret_code (const uint16 *code);
+
+/* syn68k_interpret_code_with_budget runs 68k code like interpret_code,
+ * but returns SYN68K_INTERPRET_BUDGET_EXHAUSTED as soon as entering the
+ * next block would run more than MAX_BLOCKS blocks or MAX_INSTRUCTIONS
+ * 68k instructions (the first block always runs).  The CPU state is then
+ * consistent and execution continues by passing the code for
+ * cpu_state.resume_address back in.  Budgets, like
+ * cpu_state.instructions_executed, are only kept when syn68k is built
+ * without native code (GENERATE_NATIVE_CODE); native code chains from
+ * block to block without coming back to the interpreter, so there this
+ * always runs to completion and returns SYN68K_INTERPRET_DONE.
+ */
+typedef enum
+{
+  SYN68K_INTERPRET_DONE,
+  SYN68K_INTERPRET_BUDGET_EXHAUSTED
+} syn68k_interpret_status_t;
+
+extern syn68k_interpret_status_t
+syn68k_interpret_code_with_budget (const uint16 *code, int64 max_blocks,
+				   int64 max_instructions);
 /* called from asm; hence the need for the asm label, see
    `host_interrupt_status_changed' stub asm in host-native.c */
 extern const uint16 *hash_lookup_code_and_create_if_needed(syn68k_addr_t adr)
@@ -511,6 +563,13 @@ extern void trap_install_handler (unsigned trap_number,
 				  callback_handler_t func,
 				  void *arbitrary_argument);
 extern void trap_remove_handler (unsigned trap_number);
+/* A-line traps handled without an exception frame; see trap.c. */
+extern void syn68k_a_line_trap_install_handler (uint16 first_opcode,
+						uint16 last_opcode,
+						callback_handler_t func,
+						void *arbitrary_argument);
+extern void syn68k_a_line_trap_remove_handler (uint16 first_opcode,
+					       uint16 last_opcode);
 extern void *callback_argument (syn68k_addr_t callback_address);
 extern callback_handler_t callback_function (syn68k_addr_t callback_address);
 extern void dump_profile (const char *file);
@@ -518,10 +577,54 @@ extern void dump_profile (const char *file);
 #if defined (CHECKSUM_BLOCKS)
 extern unsigned long destroy_blocks_with_checksum_mismatch
 (syn68k_addr_t low_m68k_address, uint32 num_bytes);
+/* Checking blocks lazily after a flush; see checksum.c. */
+extern void syn68k_set_checksum_flush_deferred (int deferred_p);
 #endif
 
 extern void m68kaddr (const uint16 *pc);
 
+/* Ahead of time translation; see pretranslate.c. */
+extern unsigned long syn68k_pretranslate (syn68k_addr_t addr,
+					  uint32 num_bytes);
+extern void syn68k_pretranslate_later (syn68k_addr_t addr, uint32 num_bytes);
+extern int syn68k_pretranslate_some (unsigned long max_entries);
+
+/* Snapshots of a warmed up emulator; see snapshot.c. */
+typedef struct syn68k_snapshot syn68k_snapshot_t;
+extern syn68k_snapshot_t *syn68k_snapshot_take (void);
+extern void syn68k_snapshot_restore (const syn68k_snapshot_t *s);
+extern void syn68k_snapshot_free (syn68k_snapshot_t *s);
+extern int syn68k_snapshot_save (const syn68k_snapshot_t *s, FILE *fp);
+extern syn68k_snapshot_t *syn68k_snapshot_load (FILE *fp);
+extern void syn68k_fork_child_init (void);
+
+/* Chrome trace JSON logging of runtime activity; see trace.c. */
+extern void syn68k_trace_start (unsigned long max_events);
+extern void syn68k_trace_stop (void);
+extern int syn68k_trace_write (FILE *fp);
+
+/* SIGPROF sampling of where 68k time goes; see sample.c. */
+extern int syn68k_sample_start (unsigned hz);
+extern void syn68k_sample_stop (void);
+extern int syn68k_sample_write (FILE *fp);
+
+/* Call graph profiling of 68k routines; see callprof.c. */
+extern void syn68k_callprof_start (void);
+extern void syn68k_callprof_stop (void);
+extern int syn68k_callprof_write (FILE *fp);
+
+/* Native code coverage and transition counts; see nativecov.c. */
+extern int syn68k_native_coverage_start (void);
+extern void syn68k_native_coverage_stop (void);
+extern int syn68k_native_coverage_write (FILE *fp);
+
+/* Inline emulation of the common FPU instructions; see fpu.c. */
+extern void syn68k_set_fpu_emulation (int enable_p);
+
+/* Read-only regions of 68k memory; see rom.c. */
+extern void syn68k_rom_region_add (syn68k_addr_t addr, uint32 num_bytes);
+extern void syn68k_rom_regions_clear (void);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
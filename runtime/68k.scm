@@ -46,6 +46,18 @@
    (assign code "tmp_addr")
    "}"))
 
+; Like TRAP 10, but calls a host A-line handler directly when one is
+; registered for this opcode (see a_line_trap_dispatch in trap.c).
+(define (A_LINE_TRAP pc)
+  (list
+   "{ const uint16 *tmp_addr"
+   (call "SAVE_CPU_STATE")
+   (assign "tmp_addr" (call "code_lookup"
+			    (call "a_line_trap_dispatch" pc)))
+   (call "LOAD_CPU_STATE")
+   (assign code "tmp_addr")
+   "}"))
+
 
 ; Functions to determine truth value (0 or 1) for various cc combinations
 (define CC_CC (not ccc))
@@ -68,7 +80,7 @@
   (list 68000 amode_implicit (ends_block next_block_dynamic)
 	(list "1010xxxxxxxxxxxx"))
   (list "%%%%%" "CNVXZ" dont_expand
-	(TRAP 10 (deref "uint32 *" code 0) 0)))
+	(A_LINE_TRAP (deref "uint32 *" code 0))))
 
 
 (define (ABCD name amode bit_pattern src dst preamble postamble)
@@ -3367,6 +3379,7 @@
 (defopcode bfffo_reg
   (list 68020 amode_implicit () (list "1110110111000ddd" "0dddzzzzzzwwwwww"))
   (list "0N0-Z" "-----" dont_expand
+	(native_code "xlate_bfffo_reg_reg_0_1")
 	(list
 	 "{ uint32 width; int32 offset"
 	 (compute_bf_width_and_offset $3.uw $4.uw "offset" "width" 0)
@@ -3433,10 +3446,11 @@
 	 (assign $2.dsl tmp3.sl)
 	 "}")))
 
-(define (BF_REG name bit_pattern tmpbits final)
+(define (BF_REG name bit_pattern tmpbits final native)
   (defopcode name
     (list 68020 amode_implicit () (list bit_pattern "0000oooooowwwwww"))
     (list "0N0-Z" "-----" dont_expand
+	  (native_code native)
 	  (list
 	   "{ uint32 width; int32 offset"
 	   (compute_bf_width_and_offset $2.uw $3.uw "offset" "width" 1)
@@ -3455,13 +3469,13 @@
 	   final
 	   "}"))))
 
-(BF_REG bftst_reg "1110100011000ddd" tmp3.ul (list))
+(BF_REG bftst_reg "1110100011000ddd" tmp3.ul (list) "xlate_bftst_reg_0")
 (BF_REG bfchg_reg "1110101011000ddd" tmp3.ul
-	(assign $1.dul (^ $1.dul tmp3.ul)))
+	(assign $1.dul (^ $1.dul tmp3.ul)) "xlate_bfchg_reg_0")
 (BF_REG bfset_reg "1110111011000ddd" tmp3.ul
-	(assign $1.dul (| $1.dul tmp3.ul)))
+	(assign $1.dul (| $1.dul tmp3.ul)) "xlate_bfset_reg_0")
 (BF_REG bfclr_reg "1110110011000ddd" tmp3.ul
-	(assign $1.dul (& $1.dul (~ tmp3.ul))))
+	(assign $1.dul (& $1.dul (~ tmp3.ul))) "xlate_bfclr_reg_0")
 
 (define (BF_MEM name bit_pattern final1 final2)
   (defopcode name
@@ -3525,10 +3539,11 @@
 	 (assign (dereful (+ "ptr" 4)) (& tmp2.ul (~ "mask2"))))
 	(assign (dereful "ptr") (& tmp.ul (~ "mask"))))
 
-(define (BFEXT_REG name bit_pattern compute cc)
+(define (BFEXT_REG name bit_pattern compute cc native)
   (defopcode name
     (list 68020 amode_implicit () (list bit_pattern "0dddzzzzzzwwwwww"))
     (list "0N0-Z" "-----" dont_expand
+	  (native_code native)
 	  (list
 	   "{ uint32 width; int32 offset"
 	   (compute_bf_width_and_offset $3.uw $4.uw "offset" "width" 1)
@@ -3545,7 +3560,8 @@
 				  (>> tmp.ul (- 32 "offset"))))
 		(assign tmp.ul (<< tmp.ul "offset")))
 	    (assign tmp.sl (>> tmp.sl (- 32 "width"))))
-	   (ASSIGN_NNZ_LONG tmp.ul))
+	   (ASSIGN_NNZ_LONG tmp.ul)
+	   "xlate_bfexts_reg_reg_0_1")
 
 
 (BFEXT_REG bfextu_reg "1110100111000ddd"
@@ -3562,7 +3578,8 @@
 	    (assign ccn (& (>> tmp.ul (- "width" 1)) 1))
 	    "\n#else\n"
 	    (assign ccn (& (assign ccnz tmp.ul) (<< 1 (- "width" 1))))
-	    "\n#endif\n"))
+	    "\n#endif\n")
+	   "xlate_bfextu_reg_reg_0_1")
 
 
 (define (BFEXT_MEM name bit_pattern compute cc)
@@ -3618,6 +3635,7 @@
 (defopcode bfins_reg
   (list 68020 amode_implicit () (list "1110111111000ddd" "0dddzzzzzzwwwwww"))
   (list "0N0-Z" "-----" dont_expand
+	(native_code "xlate_bfins_reg_reg_1_0")
 	(list
 	 "{ uint32 width; int32 offset"
 	 (compute_bf_width_and_offset $3.uw $4.uw "offset" "width" 1)
@@ -4393,6 +4411,7 @@
 ; we want to dereference it, we need to convert it to local space.
 ;  (assign (call "DEREF" "uint32" a7.ul) "rts_addr")
    (assign (call "READUL_UNSWAPPED" a7.ul) "rts_addr")
+   (call "CALLPROF_CALL" "target_addr" a7.ul)
    (assign code (call "code_lookup " "target_addr"))))
 
 
@@ -4457,8 +4476,9 @@
 	(list
 	 (assign a7.ul (- a7.ul 4))
 	 (assign (dereful a7.ul) (call "READUL_US" code))
-	 (assign code (call "code_lookup "
-			    (call "CLEAN" (+ $2.asl $3.sl))))
+	 (assign tmp.ul (call "CLEAN" (+ $2.asl $3.sl)))
+	 (call "CALLPROF_CALL" tmp.ul a7.ul)
+	 (assign code (call "code_lookup " tmp.ul))
 	 $1.ul)))
 
 ; jsr's to dynamic addresses are a lost cause.  FIXME - we could still
@@ -4471,8 +4491,9 @@
 	(list
 	 (assign a7.ul (- a7.ul 4))
 	 (assign (dereful a7.ul) (call "READUL_US" code))
-	 (assign code (call "code_lookup "
-			    (call "CLEAN" $1.puw))))))
+	 (assign tmp.ul (call "CLEAN" $1.puw))
+	 (call "CALLPROF_CALL" tmp.ul a7.ul)
+	 (assign code (call "code_lookup " tmp.ul)))))
 
 
 (defopcode lea_w
@@ -5483,10 +5504,10 @@
   (list "CNV-Z" "-----" dont_expand
 	(ASSIGN_C_N_V_NZ_LONG (assign $1.dul (* $1.duw $2.muw)))))
 
-(define (mulsl_32_case reg)
+(define (mulsl_32_case reg src)
   (list
    "{ int64 tmp64"
-   (assign "tmp64" $1.msl)
+   (assign "tmp64" src)
    (ASSIGN_NNZ_LONG (assign reg (assign "tmp64" (* "tmp64" reg))))
    "\n#ifdef CCR_ELEMENT_8_BITS\n"
    (assign ccv (<> 0 (+ (>> "tmp64" 32) (>> (cast "uint32" reg) 31)))) ;hack
@@ -5495,10 +5516,10 @@
    "\n#endif\n"
    "}"))
 
-(define (mulul_32_case reg)
+(define (mulul_32_case reg src)
   (list
    "{ uint64 tmp64"
-   (assign "tmp64" $1.mul)
+   (assign "tmp64" src)
    (ASSIGN_NNZ_LONG (assign reg (assign "tmp64" (* "tmp64" reg))))
    "\n#ifdef CCR_ELEMENT_8_BITS\n"
    (assign ccv (<> 0 (>> "tmp64" 32)))
@@ -5507,60 +5528,71 @@
    "\n#endif\n"
    "}"))
 
-(define (mull_64_case reg mem decl64)
+(define (mull_64_case reg mem decl64 high)
   (list
    decl64
    (assign "tmp64" mem)
    (assign reg (assign "tmp64" (* "tmp64" reg)))
    (assign ccnz (<> "tmp64" 0))
    (assign ccn (SIGN_LONG (assign tmp.ul (>> "tmp64" 32))))
-   (assign $3.dul tmp.ul)
+   (assign high tmp.ul)
    (assign ccv 0)
    "}"))
 
+; mull with a data register source, which we can compile to native code.
+(defopcode mull_reg
+  (list 68020 amode_implicit () (list "0100110000000sss" "0dddzz0000000hhh"))
+  (list "0NV-Z" "-----" dont_expand
+	(native_code "xlate_mull_reg_reg_0_1")
+	(switch $3.uw
+		(0 (mulul_32_case $2.dul $1.dul))
+		(2 (mulsl_32_case $2.dsl $1.dsl))
+		(1 (mull_64_case $2.dul $1.dul "{ uint64 tmp64" $4.dul))
+		(default (mull_64_case $2.dsl $1.dsl "{ int64 tmp64" $4.dul)))))
+
 (defopcode mull
   (list 68020 amode_data () (list "0100110000mmmmmm" "0iiiii0000000hhh"))
   (list "0NV-Z" "-----" dont_expand
 	(switch $2.uw
 		; mulul 32x32->32
-		(0x00 (mulul_32_case d0.ul))
-		(0x04 (mulul_32_case d1.ul))
-		(0x08 (mulul_32_case d2.ul))
-		(0x0C (mulul_32_case d3.ul))
-		(0x10 (mulul_32_case d4.ul))
-		(0x14 (mulul_32_case d5.ul))
-		(0x18 (mulul_32_case d6.ul))
-		(0x1C (mulul_32_case d7.ul))
+		(0x00 (mulul_32_case d0.ul $1.mul))
+		(0x04 (mulul_32_case d1.ul $1.mul))
+		(0x08 (mulul_32_case d2.ul $1.mul))
+		(0x0C (mulul_32_case d3.ul $1.mul))
+		(0x10 (mulul_32_case d4.ul $1.mul))
+		(0x14 (mulul_32_case d5.ul $1.mul))
+		(0x18 (mulul_32_case d6.ul $1.mul))
+		(0x1C (mulul_32_case d7.ul $1.mul))
 		
 		; mulsl 32x32->32
-		(0x02 (mulsl_32_case d0.sl))
-		(0x06 (mulsl_32_case d1.sl))
-		(0x0A (mulsl_32_case d2.sl))
-		(0x0E (mulsl_32_case d3.sl))
-		(0x12 (mulsl_32_case d4.sl))
-		(0x16 (mulsl_32_case d5.sl))
-		(0x1A (mulsl_32_case d6.sl))
-		(0x1E (mulsl_32_case d7.sl))
+		(0x02 (mulsl_32_case d0.sl $1.msl))
+		(0x06 (mulsl_32_case d1.sl $1.msl))
+		(0x0A (mulsl_32_case d2.sl $1.msl))
+		(0x0E (mulsl_32_case d3.sl $1.msl))
+		(0x12 (mulsl_32_case d4.sl $1.msl))
+		(0x16 (mulsl_32_case d5.sl $1.msl))
+		(0x1A (mulsl_32_case d6.sl $1.msl))
+		(0x1E (mulsl_32_case d7.sl $1.msl))
 		
 		; mulul 32x32->64
-		(0x01 (mull_64_case d0.ul $1.mul "{ uint64 tmp64"))
-		(0x05 (mull_64_case d1.ul $1.mul "{ uint64 tmp64"))
-		(0x09 (mull_64_case d2.ul $1.mul "{ uint64 tmp64"))
-		(0x0D (mull_64_case d3.ul $1.mul "{ uint64 tmp64"))
-		(0x11 (mull_64_case d4.ul $1.mul "{ uint64 tmp64"))
-		(0x15 (mull_64_case d5.ul $1.mul "{ uint64 tmp64"))
-		(0x19 (mull_64_case d6.ul $1.mul "{ uint64 tmp64"))
-		(0x1D (mull_64_case d7.ul $1.mul "{ uint64 tmp64"))
+		(0x01 (mull_64_case d0.ul $1.mul "{ uint64 tmp64" $3.dul))
+		(0x05 (mull_64_case d1.ul $1.mul "{ uint64 tmp64" $3.dul))
+		(0x09 (mull_64_case d2.ul $1.mul "{ uint64 tmp64" $3.dul))
+		(0x0D (mull_64_case d3.ul $1.mul "{ uint64 tmp64" $3.dul))
+		(0x11 (mull_64_case d4.ul $1.mul "{ uint64 tmp64" $3.dul))
+		(0x15 (mull_64_case d5.ul $1.mul "{ uint64 tmp64" $3.dul))
+		(0x19 (mull_64_case d6.ul $1.mul "{ uint64 tmp64" $3.dul))
+		(0x1D (mull_64_case d7.ul $1.mul "{ uint64 tmp64" $3.dul))
 		
 		; mulsl 32x32->64
-		(0x03 (mull_64_case d0.sl $1.msl "{ int64 tmp64"))
-		(0x07 (mull_64_case d1.sl $1.msl "{ int64 tmp64"))
-		(0x0B (mull_64_case d2.sl $1.msl "{ int64 tmp64"))
-		(0x0F (mull_64_case d3.sl $1.msl "{ int64 tmp64"))
-		(0x13 (mull_64_case d4.sl $1.msl "{ int64 tmp64"))
-		(0x17 (mull_64_case d5.sl $1.msl "{ int64 tmp64"))
-		(0x1B (mull_64_case d6.sl $1.msl "{ int64 tmp64"))
-		(0x1F (mull_64_case d7.sl $1.msl "{ int64 tmp64")))))
+		(0x03 (mull_64_case d0.sl $1.msl "{ int64 tmp64" $3.dul))
+		(0x07 (mull_64_case d1.sl $1.msl "{ int64 tmp64" $3.dul))
+		(0x0B (mull_64_case d2.sl $1.msl "{ int64 tmp64" $3.dul))
+		(0x0F (mull_64_case d3.sl $1.msl "{ int64 tmp64" $3.dul))
+		(0x13 (mull_64_case d4.sl $1.msl "{ int64 tmp64" $3.dul))
+		(0x17 (mull_64_case d5.sl $1.msl "{ int64 tmp64" $3.dul))
+		(0x1B (mull_64_case d6.sl $1.msl "{ int64 tmp64" $3.dul))
+		(0x1F (mull_64_case d7.sl $1.msl "{ int64 tmp64" $3.dul)))))
 
 
 (defopcode nbcd
@@ -6015,6 +6047,7 @@
 	(list
 	 (assign tmp.ul (dereful a7.ul))
 	 (assign a7.ul (+ a7.ul 4 $1.sl))
+	 (call "CALLPROF_RETURN" a7.ul)
 	 (assign code (call "code_lookup" tmp.ul)))))
 
 (defopcode rtr
@@ -6033,6 +6066,7 @@
 	 (assign ccnz (& (~ tmp.uw) 0x4))
 	 (assign tmp2.ul (call "READUL_UNSWAPPED" a7.ul))
 	 (assign a7.ul (+ a7.ul 4))
+	 (call "CALLPROF_RETURN" a7.ul)
 	 (assign "ix" "cpu_state.jsr_stack_byte_index")
 	 (assign "j" "(jsr_stack_elt_t *)((char *)&cpu_state.jsr_stack + ix)")
 	 (if (= "j->tag" tmp2.ul)
@@ -6054,6 +6088,7 @@
 	 "const jsr_stack_elt_t *j"
 	 (assign tmp.ul (call "READUL_UNSWAPPED" a7.ul))
 	 (assign a7.ul (+ a7.ul 4))
+	 (call "CALLPROF_RETURN" a7.ul)
 	 (assign "ix" "cpu_state.jsr_stack_byte_index")
 	 (assign "j" "(jsr_stack_elt_t *)((char *)&cpu_state.jsr_stack + ix)")
 	 (if (= "j->tag" tmp.ul)
@@ -6505,18 +6540,67 @@
 	 (assign a7.ul (+ a7.ul 4))
 	 $1.ul)))  ; hack to get a7 operand for native code
 
-(defopcode cpush
-  (list 68040 (union "11110100xx101xxx" "11110100xx110xxx" "11110100xx111xxx")
-	() (list "11110100--1-----"))
+; cinv and cpush only matter to us when they touch the instruction cache,
+; and then only for the line (16 bytes) or page addressed by An.  We
+; don't know the MMU's page size, so assume the larger (8K) one.
+(defopcode cinv/cpush
+  (list 68040 (union "11110100xxx01xxx" "11110100xxx10xxx" "11110100xxx11xxx")
+	(ends_block next_block_dynamic skip_two_operand_words)
+	(list "11110100aabbbccc"))
   (list "-----" "-----" dont_expand
 	(list
 	 "{ syn68k_addr_t next_addr"
 	 (assign "next_addr" (call "CLEAN"
 				   (call "READUL_UNSWAPPED_US" code)))
-	 (call "destroy_blocks" 0 -1)
+	 (if (& $1.ul 2)	; Instruction cache?
+	     (switch (& $2.ul 3)	; Scope; bit 2 is push vs. invalidate.
+		     (1 (call "destroy_blocks" (& $3.aul (~ 15)) 16))
+		     (2 (call "destroy_blocks" (& $3.aul (~ 8191)) 8192))
+		     (default (call "destroy_blocks" 0 -1))))
 	 (assign code (call "code_lookup " (+ "next_addr" 2)))
 	 "}")))
 
+; The common FPU instructions, run on host doubles in cpu_state.fpreg
+; (see fpu.c).  These only get used while FPU emulation is on, and
+; then only for the forms fpu_translatable_p accepts.  Everything else
+; is translated as an F-line trap, so these never have to trap.
+(defopcode fpu_dreg
+  (list 68020 amode_implicit ()
+	(list "1111001000000ddd" "wwwwwwwwwwwwwwww"))
+  (list "-----" "-----" dont_expand
+	(call "fpu_op_dreg" $2.uw $1.ul)))
+
+(defopcode fpu_postinc
+  (list 68020 amode_implicit ()
+	(list "1111001000011aaa" "wwwwwwwwwwwwwwww"))
+  (list "-----" "-----" dont_expand
+	(assign $1.aul (+ $1.aul (call "fpu_op_mem" $2.uw $1.aul
+				       "FPU_EA_POSTINC")))))
+
+(defopcode fpu_predec
+  (list 68020 amode_implicit ()
+	(list "1111001000100aaa" "wwwwwwwwwwwwwwww"))
+  (list "-----" "-----" dont_expand
+	(assign $1.aul (- $1.aul (call "fpu_op_mem" $2.uw $1.aul
+				       "FPU_EA_PREDEC")))))
+
+(defopcode fpu_mem
+  (list 68020 amode_control ()
+	(list "1111001000mmmmmm" "wwwwwwwwwwwwwwww"))
+  (list "-----" "-----" dont_expand
+	(call "fpu_op_mem" $2.uw $1.pul "FPU_EA_CONTROL")))
+
+(define (FBCC name bit_pattern)
+  (defopcode name
+    (list 68020 amode_implicit (ends_block skip_two_pointers) bit_pattern)
+    (list "-----" "-----" dont_expand
+	  (if (call "fpu_condition" $1.uw)
+	      (assign code (deref "uint16 **" code 1))
+	      (assign code (deref "uint16 **" code 0))))))
+
+(FBCC fbccw (list "1111001010cccccc" "xxxxxxxxxxxxxxxx"))
+(FBCC fbccl (list "1111001011cccccc" "xxxxxxxxxxxxxxxx" "xxxxxxxxxxxxxxxx"))
+
 (defopcode f_line_trap
   (list 68000 amode_implicit (ends_block next_block_dynamic)
 	(list "1111xxxxxxxxxxxx"))
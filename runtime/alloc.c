@@ -3,11 +3,18 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+/* Running total of xmalloc, xrealloc and xcalloc calls, so benchmarks can
+ * report allocations per operation.
+ */
+unsigned long xalloc_count;
+
+
 void *
 xmalloc (size_t size)
 {
   void *p;
 
+  ++xalloc_count;
   while ((p = malloc (size)) == NULL)
     {
       if (!destroy_any_block ())
@@ -27,6 +34,7 @@ xrealloc (void *old, size_t new_size)
 {
   void *p;
 
+  ++xalloc_count;
   while ((p = realloc (old, new_size)) == NULL && new_size)
     {
       if (!destroy_any_block ())
@@ -45,7 +53,8 @@ void *
 xcalloc (size_t num_elems, size_t byte_size)
 {
   void *p;
-  
+
+  ++xalloc_count;
   while ((p = calloc (num_elems, byte_size)) == NULL)
     {
       if (!destroy_any_block ())
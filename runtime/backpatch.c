@@ -17,7 +17,8 @@ backpatch_apply_and_free (Block *b, backpatch_t *p)
   char *base;
 
   /* Find the backpatch in the block's list and remove it. */
-  for (bp = &b->backpatch, found_p = FALSE; *bp != NULL; bp = &(*bp)->next)
+  for (bp = &BLOCK_COLD (b)->backpatch, found_p = FALSE; *bp != NULL;
+       bp = &(*bp)->next)
     if (*bp == p)
       {
 	*bp = p->next;
@@ -107,7 +108,7 @@ backpatch_add (Block *b, int offset_location, int num_bits, BOOL relative_p,
 #endif
 
   p = (backpatch_t *) xmalloc (sizeof *p);
-  p->next            = b->backpatch;
+  p->next            = BLOCK_COLD (b)->backpatch;
   p->offset_location = offset_location;
   p->num_bits        = num_bits;
   p->relative_p      = relative_p;
@@ -115,5 +116,5 @@ backpatch_add (Block *b, int offset_location, int num_bits, BOOL relative_p,
   p->target          = target;
 
   /* Prepend this guy to the block's list. */
-  b->backpatch = p;
+  BLOCK_COLD (b)->backpatch = p;
 }
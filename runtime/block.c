@@ -11,37 +11,82 @@
 
 static Block *free_blocks = NULL;
 
+/* Tables of chunks of Blocks and of their cold halves, both indexed by
+ * block_index_t.  Chunks never move once allocated, so Block pointers
+ * stay valid; only these small tables of chunk pointers grow.
+ */
+Block **block_chunk;
+BlockCold **block_cold_chunk;
+static block_index_t next_block_index;
+
+/* Total number of Blocks ever handed out by block_new. */
+unsigned long num_blocks_created;
+
 
-/* Returns a new, empty Block.  All fields of the block are initialized to
- * zero.  If DEBUG is #define'd, the magic field will be set to
- * BLOCK_MAGIC_VALUE.
+/* Allocates the first chunk, reserving index 0 as "no block".  Call this
+ * before creating any blocks.
+ */
+void
+block_init ()
+{
+  if (block_chunk != NULL)
+    return;
+  block_chunk = (Block **) xmalloc (sizeof (Block *));
+  block_cold_chunk = (BlockCold **) xmalloc (sizeof (BlockCold *));
+  block_chunk[0] = (Block *) xcalloc (BLOCKS_PER_CHUNK, sizeof (Block));
+  block_cold_chunk[0] = (BlockCold *) xcalloc (BLOCKS_PER_CHUNK,
+					       sizeof (BlockCold));
+  next_block_index = 1;
+}
+
+
+/* Returns a new, empty Block.  All fields of the block and its cold half
+ * are initialized to zero, except for its index.  If DEBUG is #define'd,
+ * the magic field will be set to BLOCK_MAGIC_VALUE.
  */
 Block *
 block_new ()
 {
   Block *b;
+  block_index_t index;
 
   if (free_blocks != NULL)
     {
       b = free_blocks;
       free_blocks = b->child[0];
+      index = b->index;
     }
   else
     {
-#define BLOCK_CHUNK_SIZE (16384 / sizeof (Block))
-      static Block *block_chunk;
-      static int block_chunk_index = BLOCK_CHUNK_SIZE;
+      unsigned long c;
 
-      if (block_chunk_index >= BLOCK_CHUNK_SIZE)
+      index = next_block_index;
+      c = index >> LOG_BLOCKS_PER_CHUNK;
+      if ((index & (BLOCKS_PER_CHUNK - 1)) == 0)
 	{
-	  block_chunk = xmalloc (BLOCK_CHUNK_SIZE * sizeof (Block));
-	  block_chunk_index = 0;
+	  Block *hot = (Block *) xmalloc (BLOCKS_PER_CHUNK * sizeof (Block));
+	  BlockCold *cold = (BlockCold *) xmalloc (BLOCKS_PER_CHUNK
+						   * sizeof (BlockCold));
+	  block_chunk = (Block **) xrealloc (block_chunk,
+					     (c + 1) * sizeof (Block *));
+	  block_cold_chunk = (BlockCold **) xrealloc (block_cold_chunk,
+						      ((c + 1)
+						       * sizeof (BlockCold *)));
+	  block_chunk[c] = hot;
+	  block_cold_chunk[c] = cold;
 	}
 
-      b = &block_chunk[block_chunk_index++];
+      b = &block_chunk[c][index & (BLOCKS_PER_CHUNK - 1)];
+      ++next_block_index;
     }
 
+  ++num_blocks_created;
   memset (b, 0, sizeof *b);
+  b->index = index;
+  memset (BLOCK_COLD (b), 0, sizeof (BlockCold));
+#ifdef CHECKSUM_BLOCKS
+  b->checksum_generation = checksum_generation;
+#endif
 
 #ifdef DEBUG
   b->magic = BLOCK_MAGIC_VALUE;
@@ -175,7 +220,8 @@ block_changed_checksum ()
   unsigned long num_diff;
 
   num_diff = 0;
-  for (b = death_queue_head; b != NULL; b = b->death_queue_next)
+  for (b = death_queue_head; b != NULL;
+       b = BLOCK_FROM_INDEX (b->death_queue_next))
     if (compute_block_checksum (b) != b->checksum)
       {
 	++num_diff;
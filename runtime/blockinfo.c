@@ -1,9 +1,11 @@
 #include "syn68k_private.h"
 #include "block.h"
 #include "mapping.h"
-#include "rangetree.h"
+#include "pagedir.h"
 #include "blockinfo.h"
 #include "alloc.h"
+#include "loopidiom.h"
+#include "idle.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
@@ -58,7 +60,7 @@ compute_block_info (Block *b, const uint16 *code, TempBlockInfo *temp)
 	}
 
       m68k_op = READUW (addr);
-      map = &opcode_map_info[opcode_map_index[m68k_op]];
+      map = OPCODE_MAP_INFO (m68k_op, code);
 
 #if 0
       if (opcode_map_index[m68k_op] == 0)
@@ -116,6 +118,38 @@ compute_block_info (Block *b, const uint16 *code, TempBlockInfo *temp)
       determine_next_block_addresses (old_code, temp, map);
     }
 
+  /* See if this is a two instruction copy, fill or compare loop. */
+  temp->loop_idiom = 0;
+  if (temp->num_68k_instrs == 2 && temp->next_instr_offset[0] == 1
+      && temp->num_child_blocks == 2
+      && temp->child[1] == US_TO_SYN68K (start_code))
+    temp->loop_idiom = loop_idiom_recognize (READUW (US_TO_SYN68K (start_code)),
+					     READUW (US_TO_SYN68K (old_code)));
+
+  /* See if this is an idle loop that only polls memory.  Spins are
+   * counted with the instruction counter, which native code doesn't
+   * maintain.
+   */
+  temp->idle_loop = false;
+#if defined (SYNCHRONOUS_INTERRUPTS) && !defined (GENERATE_NATIVE_CODE)
+  if (!breakpoint && temp->num_child_blocks != 0
+      && temp->child[temp->num_child_blocks - 1] == US_TO_SYN68K (start_code))
+    temp->idle_loop = idle_loop_recognize (start_code,
+					   temp->next_instr_offset);
+#endif
+
+  /* See if this ends by dispatching through a switch's jump table. */
+  temp->jump_table.num_targets = 0;
+#ifndef GENERATE_NATIVE_CODE
+  if (!breakpoint && temp->num_child_blocks == 0)
+    jump_table_recognize (old_code,
+			  ((temp->num_68k_instrs >= 2)
+			   ? (old_code
+			      - temp->next_instr_offset[temp->num_68k_instrs - 2])
+			   : NULL),
+			  &temp->jump_table);
+#endif
+
   /* Record the block information we've computed. */
   b->cc_clobbered       = clobbered;
   b->cc_may_not_set     = may_not_set;
@@ -202,6 +236,24 @@ determine_next_block_addresses (const uint16 *code, TempBlockInfo *temp,
       return;
     }
 
+  /* Is it an fbcc? */
+  if ((m68kop & 0xFF80) == 0xF280)
+    {
+      temp->child[1] = (uint32) US_TO_SYN68K(code + 1);
+      if (m68kop & 0x40)
+	{
+	  temp->child[1] += READSL (US_TO_SYN68K (code + 1));
+	  temp->child[0] = (uint32) US_TO_SYN68K(code + 3);
+	}
+      else
+	{
+	  temp->child[1] += READSW (US_TO_SYN68K (code + 1));
+	  temp->child[0] = (uint32) US_TO_SYN68K(code + 2);
+	}
+      temp->num_child_blocks = 2;
+      return;
+    }
+
   switch (m68kop)
     {
     case 0x4EF8: /* Is it a jmp _abs.w? */
@@ -1,5 +1,5 @@
 #include "callback.h"
-#include "rangetree.h"
+#include "pagedir.h"
 #include "block.h"
 #include "alloc.h"
 #include "hash.h"
@@ -11,14 +11,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-typedef struct {
-  callback_handler_t func;
-  void *arg;
-} CallBackInfo;
-
 CallBackInfo *callback;
-int num_callback_slots;
-int lowest_free_callback_slot;
+static uint32 num_callback_slots;   /* # of slots ever handed out.     */
+static uint32 max_callback_slots;   /* # of slots allocated in array.  */
+static uint32 first_free_callback;  /* Free list head + 1, 0 if none.  */
 
 /* We just use this array to reserve some dereferenceable address
  * space to hold the callbacks, because we need memory locations we
@@ -32,7 +28,8 @@ callback_init (void)
 {
   callback = NULL;
   num_callback_slots = 0;
-  lowest_free_callback_slot = 0;
+  max_callback_slots = 0;
+  first_free_callback = 0;
 }
 
 
@@ -47,34 +44,32 @@ callback_compile (Block *parent, syn68k_addr_t m68k_address, Block **new)
 {
   Block *b;
   uint16 *code;
-  uint32 ix = (m68k_address - CALLBACK_STUB_BASE) / sizeof (uint16);
-  const CallBackInfo *callback_info = &callback[ix];
+  uint32 ix = CALLBACK_SLOT (m68k_address);
 
   /* Make sure a callback is actually installed. */
-  if (ix >= num_callback_slots || callback_info->func == NULL)
+  if (ix >= num_callback_slots || callback[ix].func == NULL)
     {
       *new = NULL;
       return 0;
     }
 
   b = *new = make_artificial_block (parent, m68k_address,
-				    OPCODE_WORDS + PTR_WORDS + PTR_WORDS + 2,
-				    &code);
+				    OPCODE_WORDS + 2, &code);
 
-  /* Create the synthetic code for the callback. */
+  /* Create the synthetic code for the callback.  The opcode finds the
+   * function and argument in the callback table when it runs, so the
+   * block never needs to change.
+   */
 #ifdef USE_DIRECT_DISPATCH
   *(const void **)code = direct_dispatch_table[0xB3]; /* callback opcode. */
 #else
   *(void **)code = (void *)0xB3;  /* Magical callback synthetic opcode. */
 #endif
-  *((callback_handler_t *) (code + OPCODE_WORDS)) = callback_info->func;
-  *(void **)(code + OPCODE_WORDS + PTR_WORDS)     = callback_info->arg;
-  *(syn68k_addr_t *)(code + OPCODE_WORDS + PTR_WORDS + PTR_WORDS)
-    = m68k_address;
+  *(syn68k_addr_t *)(code + OPCODE_WORDS) = m68k_address;
 
   /* Insert block into the universe of blocks. */
   hash_insert (b);
-  range_tree_insert (b);
+  page_dir_insert (b);
 
   /* Add this block to the end of the death queue. */
   death_queue_enqueue (b);
@@ -87,7 +82,9 @@ callback_compile (Block *parent, syn68k_addr_t m68k_address, Block **new)
 
 /* Installs a callback stub in the 68k space and returns the 68k address
  * it chose for this stub.  Any 68k code that hits this stub will call
- * the specified callback function.  func must never be NULL.
+ * the specified callback function.  func must never be NULL.  The stubs
+ * live in a fixed window of MAX_CALLBACKS addresses, so if that many
+ * are already installed this returns 0, which is never a callback.
  */
 syn68k_addr_t
 callback_install (callback_handler_t func, void *arbitrary_argument)
@@ -96,31 +93,38 @@ callback_install (callback_handler_t func, void *arbitrary_argument)
   int old_sigmask;
 
   BLOCK_INTERRUPTS (old_sigmask);
-  slot = lowest_free_callback_slot;
 
-  if (lowest_free_callback_slot >= num_callback_slots)
+  if (first_free_callback != 0)
+    {
+      /* Reuse the most recently freed slot. */
+      slot = first_free_callback - 1;
+      first_free_callback = (uintptr_t) callback[slot].arg;
+    }
+  else
     {
       if (num_callback_slots >= MAX_CALLBACKS)
 	{
-	  fprintf (stderr, "Internal error: syn68k out of callback slots!\n");
-	  abort ();
+	  RESTORE_INTERRUPTS (old_sigmask);
+	  return 0;
 	}
 
-      ++num_callback_slots;
-      callback = (CallBackInfo *) xrealloc (callback, (num_callback_slots
-						       * sizeof callback[0]));
+      if (num_callback_slots >= max_callback_slots)
+	{
+	  max_callback_slots = (max_callback_slots == 0
+				? 64 : max_callback_slots * 2);
+	  if (max_callback_slots > MAX_CALLBACKS)
+	    max_callback_slots = MAX_CALLBACKS;
+	  callback = (CallBackInfo *) xrealloc (callback,
+						(max_callback_slots
+						 * sizeof callback[0]));
+	}
+      slot = num_callback_slots++;
     }
 
   /* Remember the callback they are specifying. */
   callback[slot].func = func;
   callback[slot].arg  = arbitrary_argument;
 
-  /* Move lowest free callback slot to next lowest slot. */
-  for (lowest_free_callback_slot++; ; lowest_free_callback_slot++)
-    if (lowest_free_callback_slot >= num_callback_slots
-	|| callback[lowest_free_callback_slot].func == NULL)
-      break;
-
   /* Reenable interrupts. */
   RESTORE_INTERRUPTS (old_sigmask);
 
@@ -131,9 +135,9 @@ callback_install (callback_handler_t func, void *arbitrary_argument)
 void *
 callback_argument (syn68k_addr_t callback_address)
 {
-  uint32 ix = (callback_address - CALLBACK_STUB_BASE) / sizeof (uint16);
+  uint32 ix = CALLBACK_SLOT (callback_address);
 
-  if (ix >= num_callback_slots)
+  if (ix >= num_callback_slots || callback[ix].func == NULL)
     return NULL;
   return callback[ix].arg;
 }
@@ -142,7 +146,7 @@ callback_argument (syn68k_addr_t callback_address)
 callback_handler_t
 callback_function (syn68k_addr_t callback_address)
 {
-  uint32 ix = (callback_address - CALLBACK_STUB_BASE) / sizeof (uint16);
+  uint32 ix = CALLBACK_SLOT (callback_address);
 
   if (ix >= num_callback_slots)
     return NULL;
@@ -157,6 +161,10 @@ callback_remove (syn68k_addr_t m68k_address)
   Block *b;
   int old_sigmask;
 
+  /* Ignore the 0 a failed callback_install returns. */
+  if (!IS_CALLBACK (m68k_address))
+    return;
+
   BLOCK_INTERRUPTS (old_sigmask);
 
   /* Fetch the block at that address. */
@@ -164,22 +172,13 @@ callback_remove (syn68k_addr_t m68k_address)
   if (b != NULL)
     destroy_block (b);
 
-  ix = (m68k_address - CALLBACK_STUB_BASE) / sizeof (uint16);
-  if (ix < num_callback_slots)
+  ix = CALLBACK_SLOT (m68k_address);
+  if (ix < num_callback_slots && callback[ix].func != NULL)
     {
-      if (ix == num_callback_slots - 1)
-	{
-	  --num_callback_slots;
-	  callback = (CallBackInfo *) xrealloc (callback,
-						(num_callback_slots
-						 * sizeof callback[0]));
-	}
-      else
-	{
-	  callback[ix].func = NULL;
-	  if (ix < lowest_free_callback_slot)
-	    lowest_free_callback_slot = ix;
-	}
+      /* Push the slot onto the free list. */
+      callback[ix].func = NULL;
+      callback[ix].arg  = (void *) (uintptr_t) first_free_callback;
+      first_free_callback = ix + 1;
     }
 
   RESTORE_INTERRUPTS (old_sigmask);
@@ -0,0 +1,376 @@
+/*
+ * callprof.c - A call graph profiler for 68k code; see callprof.h.
+ *
+ *   Costs are counted in 68k instructions, using the count the
+ *   interpreter keeps in cpu_state.instructions_executed while we're
+ *   profiling.  Each shadow frame remembers the count when it was
+ *   entered and how much of that its callees have since used, which
+ *   gives the exclusive cost of the routine and the inclusive cost of
+ *   the call when the frame is popped.
+ *   A root frame at the bottom of the stack collects everything run
+ *   outside any call.  The results are written in callgrind's format,
+ *   so kcachegrind, qcachegrind and friends can browse them.
+ *   Native code returns through host_rts without passing any hook,
+ *   so while profiling we run synthetic code only.  Native builds
+ *   don't count instructions, though, so there the profile has call
+ *   counts but no costs.
+ */
+
+#include "syn68k_private.h"
+#include "callprof.h"
+#include "interrupt.h"
+#include "translate.h"
+#include "destroyblock.h"
+#include "alloc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+BOOL callprof_p = FALSE;
+
+typedef struct callprof_edge callprof_edge_t;
+
+typedef struct callprof_func
+{
+  syn68k_addr_t addr;
+  BOOL root_p;                   /* Pseudo-routine for top level code. */
+  uint64 exclusive;
+  callprof_edge_t *callees;
+  struct callprof_func *next;    /* Next in hash bucket. */
+} callprof_func_t;
+
+struct callprof_edge
+{
+  callprof_func_t *callee;
+  uint64 calls;
+  uint64 inclusive;
+  callprof_edge_t *next;         /* Next callee of the same caller. */
+};
+
+typedef struct
+{
+  callprof_func_t *func;
+  callprof_edge_t *edge;         /* NULL for the root frame. */
+  syn68k_addr_t sp;              /* a7 once this call has returned. */
+  uint64 start;                  /* Instruction count on entry. */
+  uint64 child;                  /* Instructions run by callees. */
+} callprof_frame_t;
+
+#define LOG_CALLPROF_BUCKETS 12
+#define CALLPROF_BUCKETS (1UL << LOG_CALLPROF_BUCKETS)
+#define MAX_CALLPROF_DEPTH 4096
+
+static callprof_func_t **func_hash;
+static callprof_func_t *root_func;
+static callprof_frame_t *frame;
+static int depth;
+static unsigned long calls_too_deep;
+
+#ifdef GENERATE_NATIVE_CODE
+/* native_code_p as it was before profiling turned it off. */
+static int native_code_p_before_callprof;
+#endif
+
+
+static callprof_func_t *
+new_func (syn68k_addr_t addr, BOOL root_p)
+{
+  callprof_func_t *f = (callprof_func_t *) xcalloc (1, sizeof *f);
+  f->addr = addr;
+  f->root_p = root_p;
+  return f;
+}
+
+
+/* Returns the record for the routine at ADDR, creating it if needed. */
+static callprof_func_t *
+lookup_func (syn68k_addr_t addr)
+{
+  callprof_func_t **bucket, *f;
+
+  bucket = &func_hash[(uint32) (addr * 0x9E3779B1U)
+		      >> (32 - LOG_CALLPROF_BUCKETS)];
+  for (f = *bucket; f != NULL; f = f->next)
+    if (f->addr == addr)
+      return f;
+
+  f = new_func (addr, FALSE);
+  f->next = *bucket;
+  *bucket = f;
+  return f;
+}
+
+
+/* Returns the edge from CALLER to CALLEE, creating it if needed. */
+static callprof_edge_t *
+lookup_edge (callprof_func_t *caller, callprof_func_t *callee)
+{
+  callprof_edge_t *e;
+
+  for (e = caller->callees; e != NULL; e = e->next)
+    if (e->callee == callee)
+      return e;
+
+  e = (callprof_edge_t *) xcalloc (1, sizeof *e);
+  e->callee = callee;
+  e->next = caller->callees;
+  caller->callees = e;
+  return e;
+}
+
+
+/* Charges frame N's costs so far to its routine and to the edge from
+ * its caller, as if it returned now.
+ */
+static void
+account_frame (int n, uint64 now)
+{
+  callprof_frame_t *f = &frame[n];
+  uint64 inclusive = now - f->start;
+
+  f->func->exclusive += inclusive - f->child;
+  if (n > 0)
+    {
+      f->edge->inclusive += inclusive;
+      frame[n - 1].child += inclusive;
+    }
+}
+
+
+/* Pops every frame whose caller's stack pointer is at or below SP; such
+ * calls have returned, whether by rts or by unwinding the stack.  The
+ * root frame is never popped.
+ */
+static void
+pop_frames (syn68k_addr_t sp)
+{
+  uint64 now = cpu_state.instructions_executed;
+
+  while (depth > 1 && frame[depth - 1].sp <= sp)
+    {
+      --depth;
+      account_frame (depth, now);
+    }
+}
+
+
+void
+callprof_call (syn68k_addr_t target, syn68k_addr_t sp)
+{
+  callprof_frame_t *f;
+  callprof_func_t *callee;
+
+  /* The caller's stack pointer, once the return address is popped. */
+  sp += 4;
+  pop_frames (sp);
+
+  if (depth >= MAX_CALLPROF_DEPTH)
+    {
+      ++calls_too_deep;
+      return;
+    }
+
+  callee = lookup_func (target);
+  f = &frame[depth];
+  f->func = callee;
+  f->edge = lookup_edge (frame[depth - 1].func, callee);
+  f->sp = sp;
+  f->start = cpu_state.instructions_executed;
+  f->child = 0;
+  ++f->edge->calls;
+  ++depth;
+}
+
+
+void
+callprof_return (syn68k_addr_t sp)
+{
+  pop_frames (sp);
+}
+
+
+static void
+free_profile (void)
+{
+  unsigned long i;
+
+  if (func_hash != NULL)
+    {
+      for (i = 0; i < CALLPROF_BUCKETS; i++)
+	{
+	  callprof_func_t *f, *next_f;
+	  for (f = func_hash[i]; f != NULL; f = next_f)
+	    {
+	      callprof_edge_t *e, *next_e;
+	      for (e = f->callees; e != NULL; e = next_e)
+		{
+		  next_e = e->next;
+		  free (e);
+		}
+	      next_f = f->next;
+	      free (f);
+	    }
+	}
+      free (func_hash);
+      func_hash = NULL;
+    }
+
+  if (root_func != NULL)
+    {
+      callprof_edge_t *e, *next_e;
+      for (e = root_func->callees; e != NULL; e = next_e)
+	{
+	  next_e = e->next;
+	  free (e);
+	}
+      free (root_func);
+      root_func = NULL;
+    }
+
+  free (frame);
+  frame = NULL;
+  depth = 0;
+}
+
+
+/* Starts profiling calls, discarding any profile gathered so far.  The
+ * routine running now is treated as top level code.
+ */
+void
+syn68k_callprof_start (void)
+{
+#ifdef GENERATE_NATIVE_CODE
+  if (!callprof_p)
+    {
+      native_code_p_before_callprof = native_code_p;
+      if (native_code_p)
+	{
+	  native_code_p = FALSE;
+	  destroy_all_blocks ();
+	}
+    }
+#endif
+
+  callprof_p = FALSE;
+  free_profile ();
+
+  func_hash = (callprof_func_t **) xcalloc (CALLPROF_BUCKETS,
+					    sizeof func_hash[0]);
+  frame = (callprof_frame_t *) xmalloc (MAX_CALLPROF_DEPTH
+					* sizeof frame[0]);
+  root_func = new_func (0, TRUE);
+  frame[0].func = root_func;
+  frame[0].edge = NULL;
+  frame[0].sp = (syn68k_addr_t) ~0;
+  frame[0].start = cpu_state.instructions_executed;
+  frame[0].child = 0;
+  depth = 1;
+  calls_too_deep = 0;
+
+  callprof_p = TRUE;
+  block_accounting_enable (BLOCK_ACCOUNTING_CALLPROF);
+}
+
+
+/* Stops profiling calls.  The profile is kept for syn68k_callprof_write,
+ * with calls still in progress counted up to now.
+ */
+void
+syn68k_callprof_stop (void)
+{
+  uint64 now = cpu_state.instructions_executed;
+
+  if (!callprof_p)
+    return;
+  callprof_p = FALSE;
+  block_accounting_disable (BLOCK_ACCOUNTING_CALLPROF);
+
+#ifdef GENERATE_NATIVE_CODE
+  /* Let the blocks be translated natively again. */
+  if (native_code_p_before_callprof)
+    {
+      native_code_p = TRUE;
+      destroy_all_blocks ();
+    }
+#endif
+
+  while (depth > 0)
+    {
+      --depth;
+      account_frame (depth, now);
+    }
+}
+
+
+static void
+write_func_name (FILE *fp, const char *key, const callprof_func_t *f)
+{
+  if (f->root_p)
+    fprintf (fp, "%s=top-level\n", key);
+  else
+    fprintf (fp, "%s=0x%08lX\n", key, (unsigned long) f->addr);
+}
+
+
+static void
+write_func (FILE *fp, const callprof_func_t *f)
+{
+  const callprof_edge_t *e;
+
+  write_func_name (fp, "fn", f);
+  fprintf (fp, "0 %llu\n", (unsigned long long) f->exclusive);
+  for (e = f->callees; e != NULL; e = e->next)
+    {
+      write_func_name (fp, "cfn", e->callee);
+      fprintf (fp, "calls=%llu 0\n0 %llu\n",
+	       (unsigned long long) e->calls,
+	       (unsigned long long) e->inclusive);
+    }
+  fputc ('\n', fp);
+}
+
+
+/* Writes the profile to FP in callgrind format, with one "function" per
+ * 68k routine entry address.  If profiling is still running, calls in
+ * progress are counted up to now and carry on from there.  Returns 0 on
+ * success, -1 on failure.
+ */
+int
+syn68k_callprof_write (FILE *fp)
+{
+  uint64 now = cpu_state.instructions_executed;
+  unsigned long i;
+  int n;
+
+  if (root_func == NULL)
+    return -1;
+
+  /* Charge the open frames up to now, then restart them from here. */
+  if (callprof_p)
+    for (n = depth - 1; n >= 0; n--)
+      {
+	account_frame (n, now);
+	frame[n].start = now;
+	frame[n].child = 0;
+      }
+
+  fprintf (fp, "# callgrind format\n"
+	   "version: 1\n"
+	   "creator: syn68k\n"
+	   "positions: line\n"
+	   "events: Instructions\n");
+  if (calls_too_deep != 0)
+    fprintf (fp, "# %lu calls nested too deeply were ignored.\n",
+	     calls_too_deep);
+  fputc ('\n', fp);
+
+  write_func (fp, root_func);
+  for (i = 0; i < CALLPROF_BUCKETS; i++)
+    {
+      const callprof_func_t *f;
+      for (f = func_hash[i]; f != NULL; f = f->next)
+	write_func (fp, f);
+    }
+
+  return ferror (fp) ? -1 : 0;
+}
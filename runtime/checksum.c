@@ -3,9 +3,24 @@
 
 
 #ifdef CHECKSUM_BLOCKS
+uint32 checksum_generation;
+BOOL defer_checksum_flush_p;
+
+
 uint32
 compute_block_checksum (const Block *b)
 {
   return inline_compute_block_checksum (b);
 }
+
+
+/* When deferred, a full-range destroy_blocks_with_checksum_mismatch just
+ * marks every block as needing verification; each block is actually
+ * checksummed (and destroyed if it changed) only when it is next entered.
+ */
+void
+syn68k_set_checksum_flush_deferred (int deferred_p)
+{
+  defer_checksum_flush_p = deferred_p ? TRUE : FALSE;
+}
 #endif  /* CHECKSUM_BLOCKS */
@@ -8,13 +8,13 @@ Block *death_queue_head = NULL, *death_queue_tail = NULL;
 void
 death_queue_enqueue (Block *b)
 {
-  b->death_queue_prev = death_queue_tail;
-  b->death_queue_next = NULL;
+  b->death_queue_prev = BLOCK_INDEX (death_queue_tail);
+  b->death_queue_next = 0;
 
   if (death_queue_tail == NULL)
     death_queue_head = b;
   else
-    death_queue_tail->death_queue_next = b;
+    death_queue_tail->death_queue_next = b->index;
 
   death_queue_tail = b;
 }
@@ -26,8 +26,8 @@ death_queue_dequeue (Block *b)
 {
   Block *p, *n;
 
-  p = b->death_queue_prev;
-  n = b->death_queue_next;
+  p = BLOCK_FROM_INDEX (b->death_queue_prev);
+  n = BLOCK_FROM_INDEX (b->death_queue_next);
 
   if (p == NULL)
     {
@@ -35,7 +35,7 @@ death_queue_dequeue (Block *b)
 	death_queue_head = n;
     }
   else
-    p->death_queue_next = n;
+    p->death_queue_next = BLOCK_INDEX (n);
 
   if (n == NULL)
     {
@@ -43,7 +43,7 @@ death_queue_dequeue (Block *b)
 	death_queue_tail = p;
     }
   else
-    n->death_queue_prev = p;
+    n->death_queue_prev = BLOCK_INDEX (p);
 
-  b->death_queue_prev = b->death_queue_next = NULL;
+  b->death_queue_prev = b->death_queue_next = 0;
 }
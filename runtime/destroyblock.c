@@ -2,13 +2,19 @@
 #include "deathqueue.h"
 #include "alloc.h"
 #include "hash.h"
-#include "rangetree.h"
+#include "pagedir.h"
+#include "sample.h"
 #include "translate.h"
 #define INLINE_CHECKSUM  /* Get the fast, inline version. */
 #include "checksum.h"
 #include <assert.h>
 #include <signal.h>
+#include <stdlib.h>
 #include <string.h>
+#ifdef PARALLEL_CHECKSUM
+# include <pthread.h>
+# include <unistd.h>
+#endif
 
 
 /* Temp hack */
@@ -17,6 +23,9 @@
 
 static Block *current_block_in_death_queue;
 
+/* Set while destroy_all_blocks is throwing away rom blocks too. */
+static BOOL destroy_rom_p;
+
 
 /* This routine destroys a block and any known parents of this block (and
  * so on recursively).  Returns the total number of blocks actually destroyed.
@@ -35,8 +44,8 @@ destroy_block (Block *b)
   b->immortal = TRUE;
 
   /* Call the user-defined function to let them know we're busy. */
-  if (call_while_busy_func != NULL)
-    call_while_busy_func (1);
+  note_busy (1);
+  SAMPLE_BUSY_BEGIN ();
 
   /* Make sure no children claim us as a parent to prevent bad things
    * happening on recursion.
@@ -55,7 +64,7 @@ destroy_block (Block *b)
       num_destroyed += destroy_block (b->parent[b->num_parents]);
     }
 
-  range_tree_remove (b);
+  page_dir_remove (b);
   hash_remove (b);
 
   /* Maintain current_block_in_death_queue so we can safely traverse the
@@ -63,20 +72,252 @@ destroy_block (Block *b)
    * queue when we destroyed a bunch of blocks.
    */
   if (b == current_block_in_death_queue)
-    current_block_in_death_queue = b->death_queue_next;
+    current_block_in_death_queue = BLOCK_FROM_INDEX (b->death_queue_next);
 
   /* Remove this block from the death queue. */
   assert (death_queue_head != NULL);
   death_queue_dequeue (b);
 
   block_free (b);
+  SAMPLE_BUSY_END ();
   return num_destroyed + 1;  /* Account for the one we just freed. */
 }
 
 
+#ifdef CHECKSUM_BLOCKS
+
+/* Don't bother starting another thread for fewer blocks than this. */
+#define MIN_BLOCKS_PER_CHECKSUM_THREAD 2048
+#define MAX_CHECKSUM_THREADS 16
+
+typedef struct
+{
+  Block **blocks;           /* Blocks to verify.                        */
+  long num_blocks;
+  syn68k_addr_t *mismatch;  /* Start addresses of blocks found stale.   */
+  long num_mismatches;
+} checksum_sweep_t;
+
+
+/* Verifies the checksums of a slice of blocks, recording the start
+ * address of each block whose m68k code has changed.  This modifies
+ * nothing but the sweep record itself, so several slices can be checked
+ * at once by different threads.
+ */
+static void *
+checksum_sweep_slice (void *arg)
+{
+  checksum_sweep_t *s = (checksum_sweep_t *) arg;
+  long i;
+
+  for (i = 0; i < s->num_blocks; i++)
+    {
+      const Block *b = s->blocks[i];
+      if (b->checksum != inline_compute_block_checksum (b))
+	s->mismatch[s->num_mismatches++] = b->m68k_start_address;
+    }
+
+  return NULL;
+}
+
+
+static int
+num_checksum_threads (long num_blocks)
+{
+#ifdef PARALLEL_CHECKSUM
+  long n = sysconf (_SC_NPROCESSORS_ONLN);
+
+  if (n > num_blocks / MIN_BLOCKS_PER_CHECKSUM_THREAD)
+    n = num_blocks / MIN_BLOCKS_PER_CHECKSUM_THREAD;
+  if (n > MAX_CHECKSUM_THREADS)
+    n = MAX_CHECKSUM_THREADS;
+  return (n < 1) ? 1 : n;
+#else  /* !PARALLEL_CHECKSUM */
+  return 1;
+#endif  /* !PARALLEL_CHECKSUM */
+}
+
+
+/* Destroys every block whose checksum no longer matches its m68k code.
+ * Blocks in ROM can't go stale, so they aren't checked.  This is done in
+ * two passes: first every block is verified without
+ * touching any block data structures (fanned out across threads when
+ * PARALLEL_CHECKSUM is defined and there are enough blocks), and then
+ * the stale blocks are destroyed.  Stale blocks are remembered by start
+ * address rather than by pointer, since destroying one block can destroy
+ * others on the list as parents.  Returns the number of blocks destroyed.
+ */
+static unsigned long
+destroy_all_blocks_with_checksum_mismatch (void)
+{
+  checksum_sweep_t sweep[MAX_CHECKSUM_THREADS];
+  Block **blocks, *b;
+  syn68k_addr_t *mismatch;
+  unsigned long total_destroyed;
+  long num_blocks, i, per_thread;
+  int num_threads, t;
+
+  for (num_blocks = 0, b = death_queue_head; b != NULL;
+       b = BLOCK_FROM_INDEX (b->death_queue_next))
+    if (!b->rom)
+      num_blocks++;
+  if (num_blocks == 0)
+    return 0;
+
+  blocks = (Block **) xmalloc (num_blocks * sizeof blocks[0]);
+  mismatch = (syn68k_addr_t *) xmalloc (num_blocks * sizeof mismatch[0]);
+  for (i = 0, b = death_queue_head; b != NULL;
+       b = BLOCK_FROM_INDEX (b->death_queue_next))
+    if (!b->rom)
+      blocks[i++] = b;
+
+  TRACE_BEGIN (TRACE_CHECKSUM_SWEEP, num_blocks, 0);
+
+  num_threads = num_checksum_threads (num_blocks);
+  per_thread = (num_blocks + num_threads - 1) / num_threads;
+  for (t = 0; t < num_threads; t++)
+    {
+      long lo = t * per_thread;
+      long hi = (lo + per_thread < num_blocks) ? lo + per_thread : num_blocks;
+      sweep[t].blocks = &blocks[lo];
+      sweep[t].num_blocks = hi - lo;
+      sweep[t].mismatch = &mismatch[lo];
+      sweep[t].num_mismatches = 0;
+    }
+
+#ifdef PARALLEL_CHECKSUM
+  {
+    pthread_t thread[MAX_CHECKSUM_THREADS];
+    BOOL started[MAX_CHECKSUM_THREADS];
+
+    for (t = 1; t < num_threads; t++)
+      started[t] = (pthread_create (&thread[t], NULL, checksum_sweep_slice,
+				    &sweep[t]) == 0);
+    checksum_sweep_slice (&sweep[0]);
+    for (t = 1; t < num_threads; t++)
+      {
+	/* If we couldn't get a thread, just do the work ourselves. */
+	if (started[t])
+	  pthread_join (thread[t], NULL);
+	else
+	  checksum_sweep_slice (&sweep[t]);
+      }
+  }
+#else  /* !PARALLEL_CHECKSUM */
+  checksum_sweep_slice (&sweep[0]);
+#endif  /* !PARALLEL_CHECKSUM */
+
+  total_destroyed = 0;
+  for (t = 0; t < num_threads; t++)
+    for (i = 0; i < sweep[t].num_mismatches; i++)
+      {
+	b = hash_lookup (sweep[t].mismatch[i]);
+	if (b != NULL)
+	  total_destroyed += destroy_block (b);
+      }
+
+  free (mismatch);
+  free (blocks);
+
+  TRACE_END (TRACE_CHECKSUM_SWEEP, total_destroyed, 0);
+
+  return total_destroyed;
+}
+
+
+
+/* Verifies a block whose checksum_generation is out of date, along with
+ * every out of date block reachable from it through direct child links
+ * (since entering B can run them without another lookup).  Blocks whose
+ * m68k code has changed are destroyed, along with their parents; the rest
+ * are marked current.  B itself may be destroyed, so callers must look
+ * it up again afterwards.  Returns the number of blocks destroyed.
+ */
+unsigned long
+revalidate_block (Block *b)
+{
+  Block **stack;
+  syn68k_addr_t *mismatch;
+  long stack_size, sp, num_mismatches, i;
+  unsigned long total_destroyed;
+  int old_sigmask;
+
+  if (BLOCK_CHECKSUM_CURRENT (b))
+    return 0;
+
+  BLOCK_INTERRUPTS (old_sigmask);
+  TRACE_BEGIN (TRACE_REVALIDATE, b->m68k_start_address, 0);
+
+  stack_size = 64;
+  stack = (Block **) xmalloc (stack_size * sizeof stack[0]);
+  mismatch = NULL;
+  num_mismatches = 0;
+
+  /* Mark blocks current as we push them so each is visited only once. */
+  b->checksum_generation = checksum_generation;
+  stack[0] = b;
+  for (sp = 1; sp > 0; )
+    {
+      b = stack[--sp];
+
+      /* ROM blocks can't be stale, but may still link to RAM blocks. */
+      if (!b->immortal && !b->rom
+	  && b->checksum != inline_compute_block_checksum (b))
+	{
+	  mismatch = (syn68k_addr_t *) xrealloc (mismatch,
+						 ((num_mismatches + 1)
+						  * sizeof mismatch[0]));
+	  mismatch[num_mismatches++] = b->m68k_start_address;
+	}
+
+      for (i = b->num_children - 1; i >= 0; i--)
+	{
+	  Block *c = b->child[i];
+	  if (c != NULL && !BLOCK_CHECKSUM_CURRENT (c))
+	    {
+	      c->checksum_generation = checksum_generation;
+	      if (sp >= stack_size)
+		{
+		  stack_size *= 2;
+		  stack = (Block **) xrealloc (stack,
+					       stack_size * sizeof stack[0]);
+		}
+	      stack[sp++] = c;
+	    }
+	}
+    }
+
+  total_destroyed = 0;
+  for (i = 0; i < num_mismatches; i++)
+    {
+      b = hash_lookup (mismatch[i]);
+      if (b != NULL)
+	total_destroyed += destroy_block (b);
+    }
+
+  free (mismatch);
+  free (stack);
+
+  if (total_destroyed > 0)
+    memset (&cpu_state.jsr_stack, -1, sizeof cpu_state.jsr_stack);
+
+  TRACE_END (TRACE_REVALIDATE, num_mismatches, total_destroyed);
+  RESTORE_INTERRUPTS (old_sigmask);
+
+  /* Call the user-defined function to let them know we're not busy. */
+  if (total_destroyed > 0)
+    note_busy (0);
+
+  return total_destroyed;
+}
+
+#endif  /* CHECKSUM_BLOCKS */
+
+
 /* This routine calls destroy_block() for all blocks which came from m68k
- * code intersecting the specified range of addresses.  Returns the total
- * number of blocks destroyed.
+ * code intersecting the specified range of addresses, except for blocks
+ * in ROM (unless destroy_rom_p is set).  ROM blocks still die along with
+ * any block they link to.  Returns the total number of blocks destroyed.
  */
 #ifdef CHECKSUM_BLOCKS
 static unsigned long
@@ -91,7 +332,12 @@ destroy_blocks (syn68k_addr_t low_m68k_address, uint32 num_bytes)
   int old_sigmask;
   unsigned long total_destroyed;
 
+  /* An empty range would otherwise wrap around to cover everything. */
+  if (num_bytes == 0)
+    return 0;
+
   BLOCK_INTERRUPTS (old_sigmask);
+  TRACE_BEGIN (TRACE_DESTROY, low_m68k_address, num_bytes);
 
   total_destroyed = 0;
 
@@ -104,49 +350,52 @@ destroy_blocks (syn68k_addr_t low_m68k_address, uint32 num_bytes)
 	    {
 	      unsigned long ndest;
 	      current_block_in_death_queue = b;
-	      ndest = destroy_block (b);
+	      ndest = (b->rom && !destroy_rom_p) ? 0 : destroy_block (b);
 	      if (ndest != 0)
 		{
 		  total_destroyed += ndest;
 		  b = current_block_in_death_queue;  /* Has advanced. */
 		}
 	      else
-		b = b->death_queue_next;
+		b = BLOCK_FROM_INDEX (b->death_queue_next);
 	    }
 	}
-      else
+#ifdef CHECKSUM_BLOCKS
+      else if (defer_checksum_flush_p)
 	{
-	  for (b = death_queue_head; b != NULL; )
-	    {
-	      if (b->checksum != inline_compute_block_checksum (b))
-		{
-		  unsigned long ndest;
-		  current_block_in_death_queue = b;
-		  ndest = destroy_block (b);
-		  if (ndest != 0)
-		    {
-		      total_destroyed += ndest;
-		      b = current_block_in_death_queue;  /* Has advanced. */
-		    }
-		  else
-		    b = b->death_queue_next;
-		}
-	      else
-		b = b->death_queue_next;
-	    }
+	  /* Every block is now suspect, but we don't check them until
+	   * they are entered.  The jsr stack caches code pointers that
+	   * bypass that check, so it must go.
+	   */
+	  ++checksum_generation;
+	  TRACE_INSTANT (TRACE_CHECKSUM_DEFER, checksum_generation, 0);
+	  memset (&cpu_state.jsr_stack, -1, sizeof cpu_state.jsr_stack);
+	  jump_cache_flush ();
 	}
+      else
+	total_destroyed = destroy_all_blocks_with_checksum_mismatch ();
+#endif  /* CHECKSUM_BLOCKS */
     }
   else  /* Destroy only selected range. */
     {
       syn68k_addr_t end = low_m68k_address + num_bytes - 1;
-      syn68k_addr_t next_addr;
-
-      /* Loop over blocks in the specified range and destroy them. */
-      for (b = range_tree_first_to_intersect (low_m68k_address, end);
-	   b != NULL && b->m68k_start_address <= end;
-	   b = range_tree_find_first_at_or_after (next_addr))
+      syn68k_addr_t *addrs;
+      unsigned long i, n;
+
+      /* Clip ranges running off the top of the address space. */
+      if (end < low_m68k_address)
+	end = ~(syn68k_addr_t) 0;
+
+      /* Gather the blocks in the specified range, then destroy them.
+       * Destroying a block also destroys its parents, so look each one
+       * up again to see if it's still around.
+       */
+      n = page_dir_find_intersecting (low_m68k_address, end, &addrs);
+      for (i = 0; i < n; i++)
 	{
-	  next_addr = b->m68k_start_address + 1;
+	  b = hash_lookup (addrs[i]);
+	  if (b == NULL || (b->rom && !destroy_rom_p))
+	    continue;
 
 #ifdef CHECKSUM_BLOCKS
 	  if (!checksum_blocks
@@ -156,6 +405,7 @@ destroy_blocks (syn68k_addr_t low_m68k_address, uint32 num_bytes)
 	      total_destroyed += destroy_block (b);
 	    }
 	}
+      free (addrs);
     }
 
   /* Smash the jsr stack if we destroyed any blocks. */
@@ -165,8 +415,9 @@ destroy_blocks (syn68k_addr_t low_m68k_address, uint32 num_bytes)
   RESTORE_INTERRUPTS (old_sigmask);
 
   /* Call the user-defined function to let them know we're not busy. */
-  if (call_while_busy_func != NULL)
-    call_while_busy_func (0);
+  note_busy (0);
+
+  TRACE_END (TRACE_DESTROY, total_destroyed, 0);
 
   return total_destroyed;
 }
@@ -190,6 +441,22 @@ destroy_blocks_with_checksum_mismatch (syn68k_addr_t low_m68k_address,
 #endif  /* CHECKSUM_BLOCKS */
 
 
+/* Destroys every block, including those in ROM.  For when the way code
+ * is translated changes, rather than the code itself.
+ */
+unsigned long
+destroy_all_blocks (void)
+{
+  unsigned long total_destroyed;
+
+  destroy_rom_p = TRUE;
+  total_destroyed = destroy_blocks (0, ~0);
+  destroy_rom_p = FALSE;
+
+  return total_destroyed;
+}
+
+
 static BOOL
 immortal_self_or_ancestor_aux (Block *b)
 {
@@ -197,7 +464,7 @@ immortal_self_or_ancestor_aux (Block *b)
 
   if (!b->recursive_mark)
     {
-      if (b->immortal)
+      if (b->immortal || b->rom)
 	return TRUE;
       b->recursive_mark = TRUE;
       for (i = b->num_parents - 1; i >= 0; i--)
@@ -234,7 +501,7 @@ immortal_self_or_ancestor (Block *b)
 /* Call this only when you are out of memory.  This routine selects
  * one or more blocks to destroy and destroys them, freeing up their
  * memory.  Returns the number of blocks actually freed.  Can only
- * destroy blocks that are not immortal and have no immortal
+ * destroy blocks that are neither immortal nor in ROM and have no such
  * ancestors, and will destroy the oldest such block (and all of its
  * ancestors) that it finds.
  */
@@ -244,7 +511,8 @@ destroy_any_block ()
   Block *kill;
 
   /* Find a block to slaughter.  Prefer someone with no parents*/
-  for (kill = death_queue_head; kill != NULL; kill = kill->death_queue_next)
+  for (kill = death_queue_head; kill != NULL;
+       kill = BLOCK_FROM_INDEX (kill->death_queue_next))
     if (!immortal_self_or_ancestor (kill))
       break;
 
@@ -258,8 +526,7 @@ destroy_any_block ()
       memset (&cpu_state.jsr_stack, -1, sizeof cpu_state.jsr_stack);
 
       /* Call the user-defined function to let them know we're not busy. */
-      if (call_while_busy_func != NULL)
-	call_while_busy_func (0);
+      note_busy (0);
 
       return num_destroyed;
     }
@@ -52,7 +52,8 @@ m68kaddr (const uint16 *pc)
 
   best_error = 0xFFFFFFFF;
   best_block = NULL;
-  for (b = death_queue_head; b != NULL; b = b->death_queue_next)
+  for (b = death_queue_head; b != NULL;
+       b = BLOCK_FROM_INDEX (b->death_queue_next))
     {
       if (b->compiled_code <= pc)
 	{
@@ -0,0 +1,751 @@
+/*
+ * fpu.c - Inline emulation of the common 68881/68882 instructions; see
+ *         fpu.h.
+ *
+ *   Values are kept as host doubles, so results are rounded to double
+ *   rather than extended precision, and extended operands too large or
+ *   too small for a double become infinities or zeroes on the way in.
+ *   The FPCR rounding mode is only honoured where the 68k converts to an
+ *   integer (fint and moves to integer formats); arithmetic always
+ *   rounds to nearest.  Single rounding precision is honoured.  No FPU
+ *   exceptions are ever taken, and of the FPSR only the condition codes
+ *   and the quotient byte are kept up to date.
+ */
+
+#include "syn68k_private.h"
+#include "fpu.h"
+#include "destroyblock.h"
+#include <math.h>
+#include <string.h>
+
+BOOL fpu_emulation_p = FALSE;
+
+/* Operand formats, from bits 12-10 of the extension word. */
+#define FMT_L 0   /* Long integer.                       */
+#define FMT_S 1   /* Single.                             */
+#define FMT_X 2   /* Extended.                           */
+#define FMT_P 3   /* Packed decimal, static k-factor.    */
+#define FMT_W 4   /* Word integer.                       */
+#define FMT_D 5   /* Double.                             */
+#define FMT_B 6   /* Byte integer.                       */
+#define FMT_K 7   /* Packed, dynamic k; fmovecr on input. */
+
+static const int32 format_size[8] = { 4, 4, 12, 12, 2, 8, 1, 12 };
+
+#define FPCR_PRECISION(fpcr) (((fpcr) >> 6) & 3)
+#define FPCR_ROUNDING(fpcr)  (((fpcr) >> 4) & 3)
+
+#define PRECISION_SINGLE 1
+
+#define ROUND_NEAREST 0
+#define ROUND_ZERO    1
+#define ROUND_MINUS   2
+#define ROUND_PLUS    3
+
+/* Writable bits of each control register. */
+#define FPCR_MASK 0x0000FFF0
+#define FPSR_MASK 0x0FFFFFF8
+
+#define FPSR_QUOTIENT 0x00FF0000
+
+
+/* Turns inline FPU emulation on or off.  Code translated already is
+ * thrown away so that it gets retranslated the new way, so don't call
+ * this from inside a callback.
+ */
+void
+syn68k_set_fpu_emulation (int enable_p)
+{
+  if (!enable_p == !fpu_emulation_p)
+    return;
+
+  fpu_emulation_p = (enable_p != 0);
+  destroy_all_blocks ();
+}
+
+
+/* Stores fmovecr constant OFFSET in *D, if we know it and it fits in a
+ * double.  Returns FALSE otherwise, and those take the F-line trap.
+ */
+static BOOL
+fmovecr_constant (int offset, double *d)
+{
+  static const double powers_of_ten[] =
+    { 1e0, 1e1, 1e2, 1e4, 1e8, 1e16, 1e32, 1e64, 1e128, 1e256 };
+
+  switch (offset)
+    {
+    case 0x00: *d = 3.14159265358979323846; break;   /* pi       */
+    case 0x0B: *d = 0.30102999566398119521; break;   /* log10(2) */
+    case 0x0C: *d = 2.71828182845904523536; break;   /* e        */
+    case 0x0D: *d = 1.44269504088896340736; break;   /* log2(e)  */
+    case 0x0E: *d = 0.43429448190325182765; break;   /* log10(e) */
+    case 0x0F: *d = 0.0; break;
+    case 0x30: *d = 0.69314718055994530942; break;   /* ln(2)    */
+    case 0x31: *d = 2.30258509299404568402; break;   /* ln(10)   */
+    default:
+      if (offset < 0x32 || offset > 0x3B)
+	return FALSE;
+      *d = powers_of_ten[offset - 0x32];
+      break;
+    }
+
+  return TRUE;
+}
+
+
+/* Maps the 68040 fs... and fd... opmodes (which round to single and
+ * double respectively) to the opmode of the same operation, or -1.
+ */
+static int
+base_opmode (int opmode)
+{
+  switch (opmode & ~4)
+    {
+    case 0x40: return 0x00;    /* fmove */
+    case 0x41: return 0x04;    /* fsqrt */
+    case 0x58: return 0x18;    /* fabs  */
+    case 0x5A: return 0x1A;    /* fneg  */
+    case 0x60: return 0x20;    /* fdiv  */
+    case 0x62: return 0x22;    /* fadd  */
+    case 0x63: return 0x23;    /* fmul  */
+    case 0x68: return 0x28;    /* fsub  */
+    default:   return -1;
+    }
+}
+
+
+static BOOL
+opmode_supported_p (int opmode)
+{
+  if (opmode & 0x40)
+    opmode = base_opmode (opmode);
+
+  if (opmode >= 0x30 && opmode <= 0x37)   /* fsincos */
+    return TRUE;
+
+  switch (opmode)
+    {
+    case 0x00: case 0x01: case 0x02: case 0x03: case 0x04: case 0x06:
+    case 0x08: case 0x09: case 0x0A: case 0x0C: case 0x0D: case 0x0E:
+    case 0x0F: case 0x10: case 0x11: case 0x12: case 0x14: case 0x15:
+    case 0x16: case 0x18: case 0x19: case 0x1A: case 0x1C: case 0x1D:
+    case 0x1E: case 0x1F: case 0x20: case 0x21: case 0x22: case 0x23:
+    case 0x24: case 0x25: case 0x26: case 0x27: case 0x28: case 0x38:
+    case 0x3A:
+      return TRUE;
+    default:
+      return FALSE;
+    }
+}
+
+
+/* Returns TRUE iff we can move a FORMAT operand to or from the
+ * effective address with mode MODE and register REG.
+ */
+static BOOL
+operand_supported_p (int format, int mode, int reg)
+{
+  if (mode == 0)
+    return (format == FMT_L || format == FMT_S || format == FMT_W
+	    || format == FMT_B);
+
+  /* a7 moves by 2 for byte operands, and the defopcodes don't know. */
+  if (format == FMT_B && (mode == 3 || mode == 4) && reg == 7)
+    return FALSE;
+
+  return format != FMT_P && format != FMT_K;
+}
+
+
+/* Returns TRUE iff the FPU instruction at CODE (which must have a first
+ * word of the form 0xF2xx) should be translated with the FPU
+ * defopcodes in 68k.scm rather than take the F-line trap.  All that
+ * depends on is the instruction itself, so we can decide once, when
+ * it's translated, and the defopcodes never have to bail out.
+ */
+BOOL
+fpu_translatable_p (const uint16 *code)
+{
+  uint16 op, ext;
+  int mode, reg, format, list;
+  double d;
+
+  if (!fpu_emulation_p)
+    return FALSE;
+
+  op = READUW (US_TO_SYN68K (code));
+  if ((op & 0xFF80) == 0xF280)   /* fbcc; the top 32 predicates are bogus. */
+    return (op & 0x20) == 0;
+  if ((op & 0xFFC0) != 0xF200)   /* fscc, fdbcc, ftrapcc, ... */
+    return FALSE;
+
+  /* There are no defopcodes for address register direct or immediate
+   * operands.
+   */
+  mode = (op >> 3) & 7;
+  reg = op & 7;
+  if (mode == 1 || (mode == 7 && reg > 3))
+    return FALSE;
+
+  ext = READUW (US_TO_SYN68K (code + 1));
+  format = (ext >> 10) & 7;
+
+  switch (ext >> 13)
+    {
+    case 0:     /* FPm,FPn.  The effective address is unused. */
+      return mode == 0 && opmode_supported_p (ext & 0x7F);
+
+    case 2:     /* <ea>,FPn */
+      if (format == FMT_K)
+	return mode == 0 && fmovecr_constant (ext & 0x7F, &d);
+      return (opmode_supported_p (ext & 0x7F)
+	      && operand_supported_p (format, mode, reg));
+
+    case 3:     /* fmove FPn,<ea> */
+      return (operand_supported_p (format, mode, reg)
+	      && !(mode == 7 && reg >= 2));
+
+    case 4:     /* fmovem <ea>,control registers */
+    case 5:     /* fmovem control registers,<ea> */
+      list = (ext >> 10) & 7;
+      if (list == 0 || (ext & 0x3FF) != 0)
+	return FALSE;
+      if (mode == 0)
+	return (list & (list - 1)) == 0;
+      return !((ext & 0x2000) && mode == 7 && reg >= 2);
+
+    case 6:     /* fmovem <ea>,FP registers */
+    case 7:     /* fmovem FP registers,<ea> */
+      if (mode == 0 || (ext & 0x0700) != 0)
+	return FALSE;
+      /* Predecrement lists go with -(An), and only for stores. */
+      if ((mode == 4) != !(ext & 0x1000))
+	return FALSE;
+      if (ext & 0x2000)
+	return mode != 3 && !(mode == 7 && reg >= 2);
+      return mode != 4;
+
+    default:
+      return FALSE;
+    }
+}
+
+
+static void
+set_cc (double d)
+{
+  uint32 cc = 0;
+
+  if (isnan (d))
+    cc = FPSR_CC_NAN;
+  else if (d == 0)
+    cc = FPSR_CC_Z;
+  else if (isinf (d))
+    cc = FPSR_CC_I;
+  if (signbit (d))
+    cc |= FPSR_CC_N;
+
+  cpu_state.fpsr = (cpu_state.fpsr & ~FPSR_CC) | cc;
+}
+
+
+/* Sets the FPSR quotient byte from the quotient Q of fmod or frem. */
+static void
+set_quotient (double q)
+{
+  uint32 bits = 0;
+
+  if (!isnan (q))
+    bits = (uint32) fmod (fabs (q), 128.0);
+  if (signbit (q))
+    bits |= 0x80;
+
+  cpu_state.fpsr = (cpu_state.fpsr & ~FPSR_QUOTIENT) | (bits << 16);
+}
+
+
+/* Rounds D to an integer the way the FPCR says to. */
+static double
+round_to_integer (double d)
+{
+  switch (FPCR_ROUNDING (cpu_state.fpcr))
+    {
+    case ROUND_ZERO:  return trunc (d);
+    case ROUND_MINUS: return floor (d);
+    case ROUND_PLUS:  return ceil (d);
+    default:          return nearbyint (d);
+    }
+}
+
+
+/* Converts D to an integer between MIN and MAX, saturating like the
+ * 68881 does when the operand error exception is disabled.
+ */
+static int32
+to_integer (double d, int32 min, int32 max)
+{
+  if (isnan (d))
+    return max;
+  d = round_to_integer (d);
+  if (d <= min)
+    return min;
+  if (d >= max)
+    return max;
+  return (int32) d;
+}
+
+
+static double
+single_to_double (uint32 bits)
+{
+  float f;
+  memcpy (&f, &bits, sizeof f);
+  return f;
+}
+
+
+static uint32
+double_to_single (double d)
+{
+  float f = (float) d;
+  uint32 bits;
+  memcpy (&bits, &f, sizeof bits);
+  return bits;
+}
+
+
+/* Reads the 96 bit extended precision value at ADDR. */
+static double
+load_extended (syn68k_addr_t addr)
+{
+  uint16 se = READUW (addr);
+  uint64 mant = ((uint64) READUL (addr + 4) << 32) | READUL (addr + 8);
+  int exp = se & 0x7FFF;
+  double d;
+
+  if (exp == 0x7FFF)
+    d = (mant << 1) ? NAN : INFINITY;   /* The integer bit doesn't count. */
+  else if (mant == 0)
+    d = 0.0;
+  else   /* Denormals have an exponent of 0 but scale like 1. */
+    d = ldexp ((double) mant, (exp ? exp : 1) - 16383 - 63);
+
+  return (se & 0x8000) ? -d : d;
+}
+
+
+static void
+store_extended (syn68k_addr_t addr, double d)
+{
+  uint16 se = signbit (d) ? 0x8000 : 0;
+  uint64 mant;
+
+  if (isnan (d))
+    {
+      uint64 bits;
+      memcpy (&bits, &d, sizeof bits);
+      se |= 0x7FFF;
+      mant = ((uint64) 1 << 63) | (bits << 11);
+    }
+  else if (isinf (d))
+    {
+      se |= 0x7FFF;
+      mant = 0;
+    }
+  else if (d == 0)
+    mant = 0;
+  else
+    {
+      int exp;
+      mant = (uint64) ldexp (frexp (fabs (d), &exp), 64);
+      se |= exp - 1 + 16383;
+    }
+
+  WRITEUW (addr, se);
+  WRITEUW (addr + 2, 0);
+  WRITEUL (addr + 4, (uint32) (mant >> 32));
+  WRITEUL (addr + 8, (uint32) mant);
+}
+
+
+static double
+read_operand (int format, syn68k_addr_t addr)
+{
+  uint64 bits;
+  double d;
+
+  switch (format)
+    {
+    case FMT_L:
+      return READSL (addr);
+    case FMT_S:
+      return single_to_double (READUL (addr));
+    case FMT_W:
+      return READSW (addr);
+    case FMT_B:
+      return READSB (addr);
+    case FMT_D:
+      bits = ((uint64) READUL (addr) << 32) | READUL (addr + 4);
+      memcpy (&d, &bits, sizeof d);
+      return d;
+    default:
+      return load_extended (addr);
+    }
+}
+
+
+static void
+write_operand (int format, syn68k_addr_t addr, double d)
+{
+  uint64 bits;
+
+  switch (format)
+    {
+    case FMT_L:
+      WRITESL (addr, to_integer (d, -0x7FFFFFFF - 1, 0x7FFFFFFF));
+      break;
+    case FMT_S:
+      WRITEUL (addr, double_to_single (d));
+      break;
+    case FMT_W:
+      WRITESW (addr, to_integer (d, -0x8000, 0x7FFF));
+      break;
+    case FMT_B:
+      WRITESB (addr, to_integer (d, -0x80, 0x7F));
+      break;
+    case FMT_D:
+      memcpy (&bits, &d, sizeof bits);
+      WRITEUL (addr, (uint32) (bits >> 32));
+      WRITEUL (addr + 4, (uint32) bits);
+      break;
+    default:
+      store_extended (addr, d);
+      break;
+    }
+}
+
+
+static double
+get_exponent (double d)
+{
+  if (d == 0 || isnan (d))
+    return d;
+  if (isinf (d))
+    return NAN;
+  return ilogb (d);
+}
+
+
+static double
+get_mantissa (double d)
+{
+  int exp;
+
+  if (d == 0 || isnan (d))
+    return d;
+  if (isinf (d))
+    return NAN;
+  return 2 * frexp (d, &exp);
+}
+
+
+static void
+compare (double dst, double src)
+{
+  uint32 cc;
+
+  if (isnan (dst) || isnan (src))
+    cc = FPSR_CC_NAN;
+  else if (dst == src)  /* The sign of dst - src, as the 68881 works it out. */
+    cc = FPSR_CC_Z | ((isinf (dst) ? signbit (dst)
+		       : signbit (dst) && !signbit (src)) ? FPSR_CC_N : 0);
+  else
+    cc = (dst < src) ? FPSR_CC_N : 0;
+
+  cpu_state.fpsr = (cpu_state.fpsr & ~FPSR_CC) | cc;
+}
+
+
+/* Performs the operation whose opmode is in the low 7 bits of EXT on
+ * SRC and the register named by bits 9-7, and sets the condition codes.
+ */
+static void
+arith (uint16 ext, double src)
+{
+  int n = (ext >> 7) & 7;
+  int opmode = ext & 0x7F;
+  double dst = FPREG (n), r;
+  BOOL single_p = FALSE;
+
+  if (opmode & 0x40)
+    {
+      single_p = !(opmode & 4);
+      opmode = base_opmode (opmode);
+    }
+
+  switch (opmode)
+    {
+    case 0x00: r = src; break;                       /* fmove   */
+    case 0x01: r = round_to_integer (src); break;    /* fint    */
+    case 0x02: r = sinh (src); break;
+    case 0x03: r = trunc (src); break;               /* fintrz  */
+    case 0x04: r = sqrt (src); break;
+    case 0x06: r = log1p (src); break;               /* flognp1 */
+    case 0x08: r = expm1 (src); break;               /* fetoxm1 */
+    case 0x09: r = tanh (src); break;
+    case 0x0A: r = atan (src); break;
+    case 0x0C: r = asin (src); break;
+    case 0x0D: r = atanh (src); break;
+    case 0x0E: r = sin (src); break;
+    case 0x0F: r = tan (src); break;
+    case 0x10: r = exp (src); break;                 /* fetox   */
+    case 0x11: r = exp2 (src); break;                /* ftwotox */
+    case 0x12: r = pow (10.0, src); break;           /* ftentox */
+    case 0x14: r = log (src); break;                 /* flogn   */
+    case 0x15: r = log10 (src); break;
+    case 0x16: r = log2 (src); break;
+    case 0x18: r = fabs (src); break;
+    case 0x19: r = cosh (src); break;
+    case 0x1A: r = -src; break;                      /* fneg    */
+    case 0x1C: r = acos (src); break;
+    case 0x1D: r = cos (src); break;
+    case 0x1E: r = get_exponent (src); break;
+    case 0x1F: r = get_mantissa (src); break;
+    case 0x20: r = dst / src; break;
+    case 0x21:                                       /* fmod    */
+      r = fmod (dst, src);
+      set_quotient (trunc (dst / src));
+      break;
+    case 0x22: r = dst + src; break;
+    case 0x23: r = dst * src; break;
+    case 0x24:                                       /* fsgldiv */
+      r = dst / src;
+      single_p = TRUE;
+      break;
+    case 0x25:                                       /* frem    */
+      r = remainder (dst, src);
+      set_quotient (nearbyint (dst / src));
+      break;
+    case 0x26:                                       /* fscale  */
+      if (isnan (src))
+	r = src;
+      else
+	r = ldexp (dst, (int) fmax (fmin (trunc (src), 20000), -20000));
+      break;
+    case 0x27:                                       /* fsglmul */
+      r = dst * src;
+      single_p = TRUE;
+      break;
+    case 0x28: r = dst - src; break;
+    case 0x30: case 0x31: case 0x32: case 0x33:      /* fsincos */
+    case 0x34: case 0x35: case 0x36: case 0x37:
+      FPREG (ext & 7) = cos (src);
+      r = sin (src);
+      break;
+    case 0x38:                                       /* fcmp    */
+      compare (dst, src);
+      return;
+    case 0x3A:                                       /* ftst    */
+      set_cc (src);
+      return;
+    default:
+      return;
+    }
+
+  if (single_p || FPCR_PRECISION (cpu_state.fpcr) == PRECISION_SINGLE)
+    r = (float) r;
+  FPREG (n) = r;
+  set_cc (r);
+}
+
+
+static uint32 *
+control_register (int bit)
+{
+  switch (bit)
+    {
+    case 12: return &cpu_state.fpcr;
+    case 11: return &cpu_state.fpsr;
+    default: return &cpu_state.fpiar;
+    }
+}
+
+
+static void
+set_control_register (int bit, uint32 value)
+{
+  switch (bit)
+    {
+    case 12: cpu_state.fpcr = value & FPCR_MASK; break;
+    case 11: cpu_state.fpsr = value & FPSR_MASK; break;
+    default: cpu_state.fpiar = value; break;
+    }
+}
+
+
+/* Executes an FPU instruction with a data register as its effective
+ * address (or none at all).  EXT is the extension word and DREG the
+ * data register's number.
+ */
+void
+fpu_op_dreg (uint16 ext, int dreg)
+{
+  M68kReg *r = &cpu_state.regs[dreg];
+  int format = (ext >> 10) & 7;
+  double d;
+
+  switch (ext >> 13)
+    {
+    case 0:
+      arith (ext, FPREG (format));
+      break;
+
+    case 2:
+      switch (format)
+	{
+	case FMT_L: arith (ext, r->sl.n); break;
+	case FMT_S: arith (ext, single_to_double (r->ul.n)); break;
+	case FMT_W: arith (ext, r->sw.n); break;
+	case FMT_B: arith (ext, r->sb.n); break;
+	case FMT_K:     /* fmovecr */
+	  if (fmovecr_constant (ext & 0x7F, &d))
+	    {
+	      FPREG ((ext >> 7) & 7) = d;
+	      set_cc (d);
+	    }
+	  break;
+	}
+      break;
+
+    case 3:
+      d = FPREG ((ext >> 7) & 7);
+      switch (format)
+	{
+	case FMT_L:
+	  r->sl.n = to_integer (d, -0x7FFFFFFF - 1, 0x7FFFFFFF);
+	  break;
+	case FMT_S: r->ul.n = double_to_single (d); break;
+	case FMT_W: r->sw.n = to_integer (d, -0x8000, 0x7FFF); break;
+	case FMT_B: r->sb.n = to_integer (d, -0x80, 0x7F); break;
+	}
+      break;
+
+    case 4:
+      set_control_register (format == 4 ? 12 : format == 2 ? 11 : 10,
+			    r->ul.n);
+      break;
+
+    case 5:
+      r->ul.n = *control_register (format == 4 ? 12 : format == 2 ? 11 : 10);
+      break;
+    }
+}
+
+
+/* Moves the control registers in EXT's list to or from ADDR, in FPCR,
+ * FPSR, FPIAR order.
+ */
+static void
+move_control (uint16 ext, syn68k_addr_t addr)
+{
+  int bit;
+
+  for (bit = 12; bit >= 10; bit--)
+    if (ext & (1 << bit))
+      {
+	if (ext & 0x2000)
+	  WRITEUL (addr, *control_register (bit));
+	else
+	  set_control_register (bit, READUL (addr));
+	addr += 4;
+      }
+}
+
+
+/* Moves the FP registers in MASK, where bit n stands for fpn, to or
+ * from ADDR, lowest numbered register first.
+ */
+static void
+move_multiple (uint16 ext, unsigned mask, syn68k_addr_t addr)
+{
+  int i;
+
+  for (i = 0; i < 8; i++)
+    if (mask & (1 << i))
+      {
+	if (ext & 0x2000)
+	  store_extended (addr, FPREG (i));
+	else
+	  FPREG (i) = load_extended (addr);
+	addr += 12;
+      }
+}
+
+
+/* Executes an FPU instruction with a memory effective address.  EXT is
+ * the extension word, ADDR the effective address (for -(An), the
+ * address register before it's decremented) and EA_KIND says which
+ * kind of addressing mode it came from.  Returns the number of bytes
+ * transferred, by which (An)+ and -(An) should be adjusted.
+ */
+int32
+fpu_op_mem (uint16 ext, syn68k_addr_t addr, int ea_kind)
+{
+  int format = (ext >> 10) & 7;
+  unsigned mask;
+  int32 size;
+  int i;
+
+  switch (ext >> 13)
+    {
+    case 2:
+      size = format_size[format];
+      if (ea_kind == FPU_EA_PREDEC)
+	addr -= size;
+      arith (ext, read_operand (format, addr));
+      return size;
+
+    case 3:
+      size = format_size[format];
+      if (ea_kind == FPU_EA_PREDEC)
+	addr -= size;
+      write_operand (format, addr, FPREG ((ext >> 7) & 7));
+      return size;
+
+    case 4:
+    case 5:
+      size = 4 * (((ext >> 12) & 1) + ((ext >> 11) & 1) + ((ext >> 10) & 1));
+      if (ea_kind == FPU_EA_PREDEC)
+	addr -= size;
+      move_control (ext, addr);
+      return size;
+
+    case 6:
+    case 7:
+      if (ext & 0x0800)   /* Dynamic list. */
+	mask = cpu_state.regs[(ext >> 4) & 7].ub.n;
+      else
+	mask = ext & 0xFF;
+
+      /* Predecrement lists have fp7 in bit 7, the others fp0. */
+      if (ext & 0x1000)
+	{
+	  unsigned m = mask;
+	  for (mask = 0, i = 0; i < 8; i++)
+	    if (m & (1 << i))
+	      mask |= 0x80 >> i;
+	}
+
+      for (size = 0, i = 0; i < 8; i++)
+	if (mask & (1 << i))
+	  size += 12;
+      if (ea_kind == FPU_EA_PREDEC)
+	addr -= size;
+      move_multiple (ext, mask, addr);
+      return size;
+
+    default:
+      return 0;
+    }
+}
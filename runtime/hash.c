@@ -1,7 +1,7 @@
 /*
  * hash.c - Routines for manipulating a hash table that maps 68k addresses
  *          to the basic block that begins at that address.  This exists
- *          in addition to the range tree because runtime lookups are much
+ *          in addition to the page directory because runtime lookups are much
  *          faster.
  */
 
@@ -12,10 +12,27 @@
 #include "hash.h"
 #include "alloc.h"
 #include "translate.h"
+#include "checksum.h"
+#include "destroyblock.h"
 
 
 /* Fixed size hash table, indexed by BLOCK_HASH (block->m68k_start_address). */
-Block *block_hash_table[NUM_HASH_BUCKETS];
+block_index_t block_hash_table[NUM_HASH_BUCKETS];
+
+/* Direct-mapped cache in front of the hash table; see hash.h. */
+JumpCacheEntry jump_cache[JUMP_CACHE_SIZE];
+uint32 jump_cache_generation;
+
+
+void
+jump_cache_flush ()
+{
+  int i;
+
+  for (i = 0; i < JUMP_CACHE_SIZE; i++)
+    jump_cache[i].m68k_address = JUMP_CACHE_EMPTY;
+  ++jump_cache_generation;
+}
 
 
 /* Initializes the hash table.  Call this before calling any other hash
@@ -25,6 +42,7 @@ void
 hash_init ()
 {
   memset (block_hash_table, 0, sizeof block_hash_table);
+  jump_cache_flush ();
 }
 
 
@@ -39,13 +57,14 @@ hash_destroy ()
 
   /* Remove all Blocks from the hash table. */
   for (i = 0; i < NUM_HASH_BUCKETS; i++)
-    for (b = block_hash_table[i]; b != NULL; b = next)
+    for (b = BLOCK_FROM_INDEX (block_hash_table[i]); b != NULL; b = next)
       {
-	next = b->next_in_hash_bucket;
-	b->next_in_hash_bucket = NULL;
+	next = BLOCK_FROM_INDEX (b->next_in_hash_bucket);
+	b->next_in_hash_bucket = 0;
       }
 
   memset (block_hash_table, 0, sizeof block_hash_table);
+  jump_cache_flush ();
 }
 
 
@@ -55,14 +74,15 @@ hash_destroy ()
  * compiled code but not at the beginning; this routine will not detect that
  * situation.  If you want to know what block contains a given address when
  * that address may not refer to the first byte of a block, call the slower
- * range_tree_lookup (addr) function found in rangetree.c
+ * page_dir_lookup (addr) function found in pagedir.c
  */
 Block *
 hash_lookup (syn68k_addr_t addr)
 {
-  Block *bucket = block_hash_table[BLOCK_HASH (addr)];
+  Block *bucket = BLOCK_FROM_INDEX (block_hash_table[BLOCK_HASH (addr)]);
 
-  for (; bucket != NULL; bucket = bucket->next_in_hash_bucket)
+  for (; bucket != NULL;
+       bucket = BLOCK_FROM_INDEX (bucket->next_in_hash_bucket))
     if (bucket->m68k_start_address == addr)
       return bucket;
 
@@ -79,11 +99,13 @@ hash_lookup (syn68k_addr_t addr)
 const uint16 *
 hash_lookup_code_and_create_if_needed (syn68k_addr_t addr)
 {
-  Block *b, *bucket, **bucket_ptr;
+  Block *b, *bucket;
+  block_index_t *bucket_ptr;
   int old_sigmask;
 
   bucket_ptr = &block_hash_table[BLOCK_HASH (addr)];
-  bucket = *bucket_ptr;
+  bucket = BLOCK_FROM_INDEX (*bucket_ptr);
+  b = NULL;
 
   /* If there's anything in this bucket, check for a match. */
   if (bucket != NULL)
@@ -92,34 +114,55 @@ hash_lookup_code_and_create_if_needed (syn68k_addr_t addr)
 
       /* See if we get a match in the first element. */
       if (bucket->m68k_start_address == addr)
-	return bucket->compiled_code;
+	{
+	  if (BLOCK_CHECKSUM_CURRENT (bucket))
+	    return bucket->compiled_code;
+	  b = bucket;
+	}
 
       /* See if we get a match in a later element.  If we do, move it
        * to the head of the list, since it is likely to be referenced
        * again.
        */
-      for (prev = bucket; (next = prev->next_in_hash_bucket) != NULL;
-	   prev = next)
-	{
-	  if (next->m68k_start_address == addr)
-	    {
-	      BLOCK_INTERRUPTS (old_sigmask);
-	      prev->next_in_hash_bucket = next->next_in_hash_bucket;
-	      next->next_in_hash_bucket = bucket;
-	      *bucket_ptr = next;
-	      RESTORE_INTERRUPTS (old_sigmask);
-	      return next->compiled_code;
-	    }
-	}
+      else
+	for (prev = bucket;
+	     (next = BLOCK_FROM_INDEX (prev->next_in_hash_bucket)) != NULL;
+	     prev = next)
+	  {
+	    if (next->m68k_start_address == addr)
+	      {
+		BLOCK_INTERRUPTS (old_sigmask);
+		prev->next_in_hash_bucket = next->next_in_hash_bucket;
+		next->next_in_hash_bucket = bucket->index;
+		*bucket_ptr = next->index;
+		RESTORE_INTERRUPTS (old_sigmask);
+		if (BLOCK_CHECKSUM_CURRENT (next))
+		  return next->compiled_code;
+		b = next;
+		break;
+	      }
+	  }
     }
 
+#ifdef CHECKSUM_BLOCKS
+  /* We found a block that hasn't been verified since the last deferred
+   * checksum flush.  Check it now, and recompile it if it changed.
+   */
+  if (b != NULL)
+    {
+      revalidate_block (b);
+      b = hash_lookup (addr);
+      if (b != NULL)
+	return b->compiled_code;
+    }
+#endif  /* CHECKSUM_BLOCKS */
+
   BLOCK_INTERRUPTS (old_sigmask);
   generate_block (NULL, addr, &b, FALSE);
   RESTORE_INTERRUPTS (old_sigmask);
 
   /* Call the user-defined function to let them know we're done. */
-  if (call_while_busy_func != NULL)
-    call_while_busy_func (0);
+  note_busy (0);
 
   return b->compiled_code;
 }
@@ -132,11 +175,11 @@ void
 hash_insert (Block *b)
 {
   uint32 addr = b->m68k_start_address;
-  Block **bucket = &block_hash_table[BLOCK_HASH (addr)];
+  block_index_t *bucket = &block_hash_table[BLOCK_HASH (addr)];
 
   /* Prepend this block to the beginning of the list. */
   b->next_in_hash_bucket = *bucket;
-  *bucket = b;
+  *bucket = b->index;
 }
 
 
@@ -146,10 +189,17 @@ hash_insert (Block *b)
 void
 hash_remove (Block *b)
 {
-  Block **bucket = &block_hash_table[BLOCK_HASH (b->m68k_start_address)];
-  
-  for (; *bucket != NULL; bucket = &(*bucket)->next_in_hash_bucket)
-    if (*bucket == b)
+  block_index_t *bucket;
+  JumpCacheEntry *e = &jump_cache[JUMP_CACHE_INDEX (b->m68k_start_address)];
+
+  if (e->m68k_address == b->m68k_start_address)
+    e->m68k_address = JUMP_CACHE_EMPTY;
+  ++jump_cache_generation;
+
+  bucket = &block_hash_table[BLOCK_HASH (b->m68k_start_address)];
+  for (; *bucket != 0;
+       bucket = &BLOCK_FROM_INDEX (*bucket)->next_in_hash_bucket)
+    if (*bucket == b->index)
       {
 	*bucket = b->next_in_hash_bucket;
 	break;
@@ -171,7 +221,8 @@ hash_verify ()
   Block *b, *b2;
 
   for (i = 0; i < NUM_HASH_BUCKETS; i++)
-    for (b = block_hash_table[i]; b != NULL; b = b->next_in_hash_bucket)
+    for (b = BLOCK_FROM_INDEX (block_hash_table[i]); b != NULL;
+	 b = BLOCK_FROM_INDEX (b->next_in_hash_bucket))
       {
 	if (!block_verify (b))
 	  ok = NO;
@@ -185,7 +236,8 @@ hash_verify ()
 	    ok = NO;
 	  }
 
-	for (b2 = b->next_in_hash_bucket; b2; b2 = b2->next_in_hash_bucket)
+	for (b2 = BLOCK_FROM_INDEX (b->next_in_hash_bucket); b2;
+	     b2 = BLOCK_FROM_INDEX (b2->next_in_hash_bucket))
 	  if (b->m68k_start_address == b2->m68k_start_address)
 	    {
 	      fprintf (stderr, "Internal inconsistency: More than one block "
@@ -212,8 +264,8 @@ hash_stats ()
       int n;
       Block *b;
 
-      for (n = 0, b = block_hash_table[i]; b != NULL; n++,
-	   b = b->next_in_hash_bucket);
+      for (n = 0, b = BLOCK_FROM_INDEX (block_hash_table[i]); b != NULL; n++,
+	   b = BLOCK_FROM_INDEX (b->next_in_hash_bucket));
       if (n > max)
 	max = n;
       sum += n;
@@ -0,0 +1,152 @@
+#include "syn68k_private.h"
+#include "idle.h"
+#include "block.h"
+#include "interrupt.h"
+#include "trace.h"
+
+/* This file detects guest idle loops and parks the host while the
+ * guest spins in them; see idle.h.
+ */
+
+uint32 idle_spin_threshold = 0;
+static int32 idle_park_msecs = 10;
+
+
+/* Makes the emulator park after SPINS consecutive trips around an idle
+ * loop, for at most PARK_MSECS milliseconds at a time (negative means
+ * until an interrupt is posted or syn68k_interrupt_wake is called).
+ * SPINS == 0 turns parking off, which is the default.
+ */
+void
+syn68k_idle_loop_set_threshold (uint32 spins, int32 park_msecs)
+{
+  idle_spin_threshold = spins;
+  idle_park_msecs = park_msecs;
+
+  /* idle_loop_spin tells spins apart using the instruction count. */
+  if (spins != 0)
+    block_accounting_enable (BLOCK_ACCOUNTING_IDLE);
+  else
+    block_accounting_disable (BLOCK_ACCOUNTING_IDLE);
+}
+
+
+/* Returns TRUE iff the source operand AMODE (mode and register, as in
+ * the low 6 bits of an opcode) can be read with no side effects and
+ * always refers to the same place.
+ */
+static BOOL
+pure_amode_p (int amode, BOOL immediate_ok)
+{
+  switch (amode >> 3)
+    {
+    case 0:  /* Dn */
+    case 1:  /* An */
+    case 2:  /* (An) */
+    case 5:  /* d16(An) */
+      return TRUE;
+    case 7:
+      switch (amode & 7)
+	{
+	case 0:  /* abs.w */
+	case 1:  /* abs.l */
+	case 2:  /* d16(PC) */
+	  return TRUE;
+	case 4:  /* #imm */
+	  return immediate_ok;
+	}
+      return FALSE;
+    default:
+      return FALSE;
+    }
+}
+
+
+/* Returns TRUE iff M68KOP is an instruction we know only reads memory
+ * and sets cc bits or a data register.
+ */
+static BOOL
+pure_instruction_p (uint16 m68kop)
+{
+  int amode = m68kop & 0x3F;
+
+  if ((m68kop & 0xF100) == 0x7000)			/* moveq */
+    return TRUE;
+  if ((m68kop >> 12) >= 1 && (m68kop >> 12) <= 3	/* move <ea>,Dn */
+      && ((m68kop >> 6) & 7) == 0)
+    return pure_amode_p (amode, TRUE);
+  if ((m68kop & 0xFF00) == 0x4A00 && (m68kop & 0xC0) != 0xC0)	/* tst */
+    return pure_amode_p (amode, FALSE);
+  if ((m68kop & 0xF000) == 0xB000)			/* cmp, cmpa */
+    {
+      int opmode = (m68kop >> 6) & 7;
+      if (opmode <= 3 || opmode == 7)
+	return pure_amode_p (amode, TRUE);
+      return FALSE;
+    }
+  if ((m68kop & 0xFF00) == 0x0C00 && (m68kop & 0xC0) != 0xC0)	/* cmpi */
+    return pure_amode_p (amode, FALSE);
+  if ((m68kop & 0xFFC0) == 0x0800)			/* btst #n,<ea> */
+    return pure_amode_p (amode, FALSE);
+  if ((m68kop & 0xF1C0) == 0x0100 && (amode >> 3) != 1)	/* btst Dn,<ea> */
+    return pure_amode_p (amode, TRUE);
+  return FALSE;
+}
+
+
+/* Returns TRUE iff the block starting at CODE, whose instruction
+ * lengths are given by NEXT_INSTR_OFFSET (0 terminated) and whose last
+ * instruction is a branch back to CODE, is an idle loop.
+ */
+BOOL
+idle_loop_recognize (const uint16 *code, const int8 *next_instr_offset)
+{
+  int i;
+
+  for (i = 0; next_instr_offset[i + 1] != 0; i++)
+    {
+      if (!pure_instruction_p (READUW (US_TO_SYN68K (code))))
+	return FALSE;
+      code += next_instr_offset[i];
+    }
+
+  /* The last instruction must be a bra or Bcc, not bsr or dbcc. */
+  return ((READUW (US_TO_SYN68K (code)) >> 12) == 6
+	  && (READUW (US_TO_SYN68K (code)) >> 8) != 0x61);
+}
+
+
+/* Called each time the idle loop block B is entered.  The loop has
+ * spun again iff no other guest instructions have run since we were
+ * last here, which we can tell from the instruction counter.
+ */
+#ifdef SYNCHRONOUS_INTERRUPTS
+void
+idle_loop_spin (const Block *b)
+{
+  static const Block *last_block;
+  static uint64 last_instructions_executed;
+  static uint32 spins;
+  uint64 now = cpu_state.instructions_executed;
+
+  if (b == last_block
+      && (now - last_instructions_executed
+	  == BLOCK_NUM_INSTRS (b->compiled_code)))
+    {
+      if (++spins >= idle_spin_threshold)
+	{
+	  TRACE_BEGIN (TRACE_IDLE_PARK, b->m68k_start_address, 0);
+	  syn68k_interrupt_wait (idle_park_msecs);
+	  TRACE_END (TRACE_IDLE_PARK, 0, 0);
+	  spins = 0;
+	}
+    }
+  else
+    {
+      last_block = b;
+      spins = 1;
+    }
+
+  last_instructions_executed = now;
+}
+#endif  /* SYNCHRONOUS_INTERRUPTS */
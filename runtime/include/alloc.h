@@ -3,6 +3,7 @@
 
 #include <stddef.h>    /* typedef size_t */
 
+extern unsigned long xalloc_count;
 extern void *xmalloc (size_t size);
 extern void *xrealloc (void *old, size_t new_size);
 extern void *xcalloc (size_t num_elems, size_t byte_size);
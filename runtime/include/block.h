@@ -6,46 +6,105 @@
 #include "syn68k_private.h"    /* To typedef uint16 and uint32. */
 #include "backpatch.h"
 
+/* Blocks live in chunked tables and refer to each other through 32-bit
+ * indices wherever the link is only walked, never dereferenced from
+ * compiled code.  Index 0 is never handed out and means "no block".
+ */
+typedef uint32 block_index_t;
+
+/* The fields touched on every lookup and every block dispatch come
+ * first, so a hash probe or hot-counter bump stays within one cache
+ * line.  Everything else follows, and data only needed while
+ * (re)translating lives in the parallel BlockCold table (see BLOCK_COLD
+ * below).
+ */
 struct _Block {
-  struct _Block *next_in_hash_bucket;   /* Next Block in this hash bucket.   */
   const uint16 *compiled_code;      /* Memory containing compiled code.      */
-#ifdef GENERATE_NATIVE_CODE
-  uint32 num_times_called;          /* # of times nonnative code called.     */
-#endif
-  struct _Block *death_queue_prev;  /* Prev block to be nuked if mem needed. */
-  struct _Block *death_queue_next;  /* Next block to be nuked if mem needed. */
-  struct _Block *range_tree_left;   /* Left child in range tree.             */
-  struct _Block *range_tree_right;  /* Right " " " "  (see rangetree.c)      */
-  struct _Block *range_tree_parent; /* Parent in r-tree  (see rangetree.c)   */
-  struct _Block **parent;           /* Array of ptrs to parent blocks.       */
-  struct _Block *child[2];          /* Array of ptrs to child blocks.        */
   syn68k_addr_t m68k_start_address; /* Starting address of 68k code.         */
+  block_index_t next_in_hash_bucket;/* Next Block in this hash bucket.       */
 #ifdef CHECKSUM_BLOCKS
+  uint32 checksum_generation;       /* checksum_generation when last valid.  */
   uint32 checksum;                  /* Checksum of m68k code for this block. */
 #endif
   uint32 m68k_code_length;          /* Length of 68k code, in _bytes_.       */
-  uint32 range_tree_color  :1;      /* Either RED or BLACK.                  */
+  uint32 num_times_called;          /* # of times nonnative code called.     */
+  struct _Block **parent;           /* Array of ptrs to parent blocks.       */
+  struct _Block *child[2];          /* Array of ptrs to child blocks.        */
+  block_index_t death_queue_prev;   /* Prev block to be nuked if mem needed. */
+  block_index_t death_queue_next;   /* Next block to be nuked if mem needed. */
+  block_index_t index;              /* This block's own index.               */
   uint32 cc_clobbered      :5;      /* CC bits modified before use.          */
   uint32 cc_may_not_set    :5;      /* CC bits that may be changed.          */
   uint32 cc_needed         :5;      /* CC bits whose values we need.         */
   uint32 num_children      :2;      /* # of blocks that this feeds to.       */
   uint32 immortal          :1;      /* Can't be freed to save space.         */
   uint32 recursive_mark    :1;      /* 1 means hit during this recursion.    */
+  uint32 cc_provisional    :1;      /* Translated with worst case cc bits.   */
+  uint32 alias             :1;      /* Code just enters child[0] mid-way.    */
+  uint32 rom               :1;      /* 68k code lies in a ROM region.        */
 #ifdef GENERATE_NATIVE_CODE
   uint32 recompile_me      :1;      /* Recompile me as native (temp. flag).  */
 #endif  /* GENERATE_NATIVE_CODE */
   uint16 malloc_code_offset:3;      /* Pass compiled_code - this to free().  */
   uint16 num_parents       :13;     /* # of blocks that feed into this one.  */
-  backpatch_t *backpatch;           /* Linked list of backpatches to apply.  */
-#ifdef DEBUG                        /*  to ptr to the specified child block. */
+#ifdef DEBUG
   uint32 magic;
 #endif
 };
 
 typedef struct _Block Block;
 
+/* Where each 68k instruction of a block starts, in the 68k code and in
+ * the compiled code, so other entry points can share the block's code.
+ * The table lives just past the compiled code, with BLOCK_NUM_INSTRS
+ * entries.
+ */
+typedef struct {
+  uint16 m68k_offset;               /* Bytes past m68k_start_address.        */
+  uint16 code_offset;               /* Words past compiled_code.             */
+} BlockEntryPoint;
+
+typedef struct {
+  backpatch_t *backpatch;           /* Linked list of backpatches to apply.  */
+  const BlockEntryPoint *entry_point; /* One per instruction, or NULL.       */
+#ifdef GENERATE_NATIVE_CODE
+  uint32 ntos_transitions;          /* Native->synthetic, when counted.      */
+  uint32 ston_transitions;          /* Synthetic->native, when counted.      */
+#endif
+} BlockCold;
+
+#define LOG_BLOCKS_PER_CHUNK 8
+#define BLOCKS_PER_CHUNK (1UL << LOG_BLOCKS_PER_CHUNK)
+
+extern Block **block_chunk;
+extern BlockCold **block_cold_chunk;
+extern unsigned long num_blocks_created;
+
+#define BLOCK_FROM_INDEX(i)						\
+  ((i) == 0 ? (Block *) NULL						\
+   : &block_chunk[(i) >> LOG_BLOCKS_PER_CHUNK][(i) & (BLOCKS_PER_CHUNK - 1)])
+#define BLOCK_INDEX(b) ((b) == NULL ? 0 : (b)->index)
+#define BLOCK_COLD(b)							\
+  (&block_cold_chunk[(b)->index >> LOG_BLOCKS_PER_CHUNK]		\
+                    [(b)->index & (BLOCKS_PER_CHUNK - 1)])
+
+/* Compiled code for each block is preceded by a small header holding
+ * the big endian 68k start address in the PTR_WORDS just before the
+ * code, and the number of 68k instructions in the block as a native
+ * uint32 before that.  On 64-bit hosts both fit in PTR_BYTES.
+ */
+#if SIZEOF_CHAR_P == 8
+# define BLOCK_HEADER_BYTES PTR_BYTES
+# define BLOCK_NUM_INSTRS(code) (((uint32 *) (code))[-1])
+#else
+# define BLOCK_HEADER_BYTES (2 * PTR_BYTES)
+# define BLOCK_NUM_INSTRS(code) (((uint32 *) (code))[-2])
+#endif
+#define BLOCK_HEADER_WORDS (BLOCK_HEADER_BYTES / sizeof (uint16))
+
 
 /* Function prototypes. */
+extern void block_init (void);
 extern Block *block_new (void);
 extern void block_free (Block *b);
 extern void block_add_parent (Block *b, Block *parent);
@@ -2,6 +2,7 @@
 #define _blockinfo_h_
 
 #include "block.h"
+#include "jumptable.h"
 #include <stdbool.h>
 
 typedef struct {
@@ -10,6 +11,9 @@ typedef struct {
   uint16 num_68k_instrs;
   int8 *next_instr_offset; /* word offset to next instr; 0 iff last instr.  */
   bool break_at_end;
+  uint32 loop_idiom;      /* Bulk copy/fill loop descriptor; see loopidiom.h */
+  bool idle_loop;         /* Side-effect free self loop; see idle.h.         */
+  JumpTableInfo jump_table; /* Slots for a final indexed jmp; jumptable.h */
 } TempBlockInfo;
 
 extern void compute_block_info (Block *b, const uint16 *code,
@@ -4,13 +4,30 @@
 #include "syn68k_private.h"
 #include "block.h"
 
-#define MAX_CALLBACKS 4352  /* Arbitrary...4096 plus some slop. */
+/* Size of the reserved window of magic callback addresses.  The table
+ * of installed callbacks grows as needed up to this many entries, after
+ * which callback_install fails.  The window itself is never touched, so
+ * making it big costs only address space, but it can't grow at run time
+ * because hosts map its address into 68k space.
+ */
+#ifndef MAX_CALLBACKS
+#define MAX_CALLBACKS 65536
+#endif
+
+typedef struct {
+  callback_handler_t func;  /* NULL iff this slot is free.              */
+  void *arg;                /* For free slots, next free slot index + 1. */
+} CallBackInfo;
+
+extern CallBackInfo *callback;
 
 #define CALLBACK_STUB_BASE   (MAGIC_ADDRESS_BASE + 128)
 #define CALLBACK_STUB_LENGTH (MAX_CALLBACKS * sizeof (uint16))
 
 #define IS_CALLBACK(n) (((syn68k_addr_t) (n)) - CALLBACK_STUB_BASE \
 			< CALLBACK_STUB_LENGTH)
+#define CALLBACK_SLOT(n) \
+  ((((syn68k_addr_t) (n)) - CALLBACK_STUB_BASE) / sizeof (uint16))
 
 extern void callback_init (void);
 extern syn68k_addr_t callback_install (callback_handler_t func,
@@ -0,0 +1,31 @@
+#ifndef _callprof_h_
+#define _callprof_h_
+
+#include "syn68k_private.h"
+
+/* The call graph profiler keeps a shadow of the 68k call stack, pushed
+ * by jsr/bsr and popped by rts/rtd/rtr, and charges the 68k
+ * instructions run to each routine and to each caller/callee edge.
+ * Frames are matched up by stack pointer rather than by return address,
+ * so routines that unwind the stack themselves (longjmp and friends)
+ * don't confuse it.  While profiling is off, each hook costs a single
+ * test of callprof_p.
+ */
+extern BOOL callprof_p;
+
+extern void callprof_call (syn68k_addr_t target, syn68k_addr_t sp);
+extern void callprof_return (syn68k_addr_t sp);
+
+/* TARGET is the routine being called and SP the stack pointer just
+ * after the return address has been pushed.
+ */
+#define CALLPROF_CALL(target, sp) \
+  (callprof_p ? callprof_call ((target), (sp)) : (void) 0)
+
+/* SP is the stack pointer just after the return address has been
+ * popped.
+ */
+#define CALLPROF_RETURN(sp) \
+  (callprof_p ? callprof_return (sp) : (void) 0)
+
+#endif  /* Not _callprof_h_ */
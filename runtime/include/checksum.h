@@ -9,60 +9,72 @@
 
 extern uint32 compute_block_checksum (const Block *b);
 
+/* Bumped by a deferred full checksum flush.  A block whose
+ * checksum_generation doesn't match must have its checksum verified
+ * (see revalidate_block) before it can be entered again.
+ */
+extern uint32 checksum_generation;
+extern BOOL defer_checksum_flush_p;
+
+#define BLOCK_CHECKSUM_CURRENT(b) \
+  ((b)->checksum_generation == checksum_generation)
+
 #ifdef INLINE_CHECKSUM
 #include "callback.h"
 
+/* Number of independent accumulators; 8 x 32 bits fills a 256-bit vector. */
+#define CHECKSUM_LANES 8
+#define CHECKSUM_MULTIPLIER 0x01000193  /* 32-bit FNV prime. */
+
 static uint32
 inline_compute_block_checksum (const Block *b)
 {
   const uint16 *code;
+  uint32 lane[CHECKSUM_LANES];
   uint32 sum;
-  long n;
+  long n, i;
+  int j;
   syn68k_addr_t start;
 
-  /* Don't actually checksum the bytes at a callback! */
+  /* Don't actually checksum the bytes at a callback!  Callback blocks
+   * look up their function when they run, so they never go stale.
+   */
   start = b->m68k_start_address;
   if (IS_CALLBACK (start))
-    return (start
-	    + (uintptr_t) callback_argument (start)
-	    + (uintptr_t) callback_function (start));
+    return start;
   else if (start >= MAGIC_ADDRESS_BASE
 	   && start < CALLBACK_STUB_BASE)
     return 0;
 
   code = SYN68K_TO_US (start);
-  for (sum = 0, n = b->m68k_code_length / sizeof (uint16); --n >= 0; )
-    {
-      /* Bizarre but fast checksum.  A good checksum like CRC is
-       * probably too slow.
-       */
-#if defined (__GNUC__) && defined(i386)
-      uint32 tmp1, tmp2;
-
-      /* This is taking lots of CPU time for HyperCard, and gcc was generating
-       * lousy code, so I've hand-coded and hand-scheduled this for the
-       * Pentium.  This should do the same thing as the C code below.
-       */
-      asm ("movl %0,%2\n\t"
-	   "movl %0,%1\n\t"
-	   "sall $5,%2\n\t"
-	   "shrl $14,%1\n\t"
-	   "addl %0,%2\n\t"
-	   "xorl %2,%1\n\t"
-	   "xorw (%4,%5,2),%w0\n\t"
-	   "xorl %1,%0"
-	   : "=r" (sum), "=&r" (tmp1), "=&r" (tmp2)
-	   : "0" (sum), "r" (code), "r" (n)
-	   : "cc");
-#else   /* !__GNUC__ || !i386 */
-      sum = (sum >> 14) ^ (sum * 33) ^ code[n];
-#endif  /* !__GNUC__ || !i386 */
-    }
+  n = b->m68k_code_length / sizeof (uint16);
+
+  /* Full checksum sweeps spend nearly all their time here, so we
+   * avoid a serial recurrence.  CHECKSUM_LANES independent multiply-xor
+   * accumulators run over interleaved words, which the compiler turns
+   * into SIMD code, and are folded together at the end.  Each step is a
+   * bijection of the lane value, so any single changed word still
+   * changes the result.
+   */
+  for (j = 0; j < CHECKSUM_LANES; j++)
+    lane[j] = j + 1;
+  for (i = 0; i + CHECKSUM_LANES <= n; i += CHECKSUM_LANES)
+    for (j = 0; j < CHECKSUM_LANES; j++)
+      lane[j] = (lane[j] ^ code[i + j]) * CHECKSUM_MULTIPLIER;
+  for (j = 0; i < n; i++, j++)
+    lane[j] = (lane[j] ^ code[i]) * CHECKSUM_MULTIPLIER;
+
+  for (sum = n, j = 0; j < CHECKSUM_LANES; j++)
+    sum = (sum ^ lane[j]) * 0x9E3779B1;
 
   return sum;
 }
 #endif  /* INLINE_CHECKSUM */
 
-#endif  /* CHECKSUM_BLOCKS */
+#else  /* !CHECKSUM_BLOCKS */
+
+#define BLOCK_CHECKSUM_CURRENT(b) TRUE
+
+#endif  /* !CHECKSUM_BLOCKS */
 
 #endif  /* Not _checksum_h_ */
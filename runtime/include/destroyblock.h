@@ -6,5 +6,9 @@
 extern unsigned long destroy_block (Block *b);
 extern unsigned long destroy_blocks (syn68k_addr_t low_m68k_address, uint32 num_bytes);
 extern unsigned long destroy_any_block (void);
+extern unsigned long destroy_all_blocks (void);
+#ifdef CHECKSUM_BLOCKS
+extern unsigned long revalidate_block (Block *b);
+#endif
 
 #endif  /* Not _destroyblock_h_ */
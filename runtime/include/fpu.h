@@ -0,0 +1,69 @@
+#ifndef _fpu_h_
+#define _fpu_h_
+
+#include "syn68k_private.h"
+
+/* FPU emulation runs the common 68881/68882 instructions as synthetic
+ * code, on host doubles kept in cpu_state.fpreg.  It's off by default,
+ * because hosts that emulate the FPU themselves keep its state
+ * elsewhere.  While it's on, translation decides instruction by
+ * instruction (see fpu_translatable_p) whether a form is handled here;
+ * anything else, such as packed decimal operands, fsave/frestore and
+ * fscc/fdbcc/ftrapcc, still takes the F-line trap, and that handler
+ * must use the registers in cpu_state.
+ */
+extern BOOL fpu_emulation_p;
+
+/* Effective address kinds for fpu_op_mem. */
+#define FPU_EA_CONTROL  0
+#define FPU_EA_POSTINC  1
+#define FPU_EA_PREDEC   2
+
+/* FPSR condition code bits. */
+#define FPSR_CC_N   0x08000000
+#define FPSR_CC_Z   0x04000000
+#define FPSR_CC_I   0x02000000
+#define FPSR_CC_NAN 0x01000000
+#define FPSR_CC     0x0F000000
+
+#define FPREG(n) (cpu_state.fpreg[n])
+
+extern BOOL fpu_translatable_p (const uint16 *code);
+extern void fpu_op_dreg (uint16 ext, int dreg);
+extern int32 fpu_op_mem (uint16 ext, syn68k_addr_t addr, int ea_kind);
+
+
+/* Returns TRUE iff FPU conditional predicate COND (the low 6 bits of
+ * an fbcc) holds.  The IEEE-aware and signalling predicates only
+ * differ in whether they raise BSUN, which we don't emulate.
+ */
+static inline BOOL
+fpu_condition (int cond)
+{
+  uint32 cc = cpu_state.fpsr;
+  BOOL n = (cc & FPSR_CC_N) != 0;
+  BOOL z = (cc & FPSR_CC_Z) != 0;
+  BOOL nan = (cc & FPSR_CC_NAN) != 0;
+
+  switch (cond & 0xF)
+    {
+    case 0x0: return FALSE;                   /* f    */
+    case 0x1: return z;                       /* eq   */
+    case 0x2: return !(nan || z || n);        /* ogt  */
+    case 0x3: return z || !(nan || n);        /* oge  */
+    case 0x4: return n && !(nan || z);        /* olt  */
+    case 0x5: return z || (n && !nan);        /* ole  */
+    case 0x6: return !(nan || z);             /* ogl  */
+    case 0x7: return !nan;                    /* or   */
+    case 0x8: return nan;                     /* un   */
+    case 0x9: return nan || z;                /* ueq  */
+    case 0xA: return nan || !(n || z);        /* ugt  */
+    case 0xB: return nan || z || !n;          /* uge  */
+    case 0xC: return nan || (n && !z);        /* ult  */
+    case 0xD: return nan || z || n;           /* ule  */
+    case 0xE: return !z;                      /* ne   */
+    default:  return TRUE;                    /* t    */
+    }
+}
+
+#endif  /* Not _fpu_h_ */
@@ -10,7 +10,33 @@
 #define BLOCK_HASH(x) ((unsigned)((((x) ^ ((x) >> LOG_NUM_BUCKETS)) >> 1) \
 				  % NUM_HASH_BUCKETS))
 
-extern Block *block_hash_table[NUM_HASH_BUCKETS];
+/* Each bucket holds the index of the first Block in its chain, or 0. */
+extern block_index_t block_hash_table[NUM_HASH_BUCKETS];
+
+/* A small direct-mapped cache of (68k address, compiled code) pairs sits
+ * in front of the hash table, so most lookups for dynamic jumps cost
+ * one load and compare.  An entry is dropped whenever its block leaves
+ * the hash table, and the whole cache is flushed whenever blocks may
+ * need revalidating.  Odd addresses are never code, so
+ * JUMP_CACHE_EMPTY marks unused entries.
+ */
+#define LOG_JUMP_CACHE_SIZE 10
+#define JUMP_CACHE_SIZE (1UL << LOG_JUMP_CACHE_SIZE)
+#define JUMP_CACHE_INDEX(x) (((x) >> 1) & (JUMP_CACHE_SIZE - 1))
+#define JUMP_CACHE_EMPTY 1
+
+typedef struct {
+  syn68k_addr_t m68k_address;
+  const uint16 *compiled_code;
+} JumpCacheEntry;
+
+extern JumpCacheEntry jump_cache[JUMP_CACHE_SIZE];
+extern void jump_cache_flush (void);
+
+/* Changes whenever an entry is dropped from the jump cache, so that
+ * copies of entries kept elsewhere know they may be stale.
+ */
+extern uint32 jump_cache_generation;
 
 extern void hash_init (void);
 extern void hash_destroy (void);
@@ -0,0 +1,22 @@
+#ifndef _idle_h_
+#define _idle_h_
+
+#include "syn68k_private.h"
+#include "block.h"
+
+/* An idle loop is a block that branches back to its own start and
+ * does nothing but read memory and registers: tst, cmp, cmpi, btst
+ * and moves into data registers, using addressing modes with no side
+ * effects.  Such a block can only leave the loop if an interrupt or
+ * the host changes something, so once it has spun enough times in a
+ * row we park the host thread in syn68k_interrupt_wait.  The translator
+ * puts a synthetic opcode at the start of these blocks to count the
+ * spins.
+ */
+extern uint32 idle_spin_threshold;  /* 0 means never park. */
+
+extern BOOL idle_loop_recognize (const uint16 *code,
+				 const int8 *next_instr_offset);
+extern void idle_loop_spin (const Block *b);
+
+#endif  /* Not _idle_h_ */
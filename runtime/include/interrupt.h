@@ -5,4 +5,45 @@
 
 /* Everything that would normally be here is in syn68k_public.h */
 
+/* Atomic accessors for the interrupt mailbox, which is written by
+ * other threads and signal handlers.  Without compiler support we fall
+ * back on the old volatile accesses, which is what we always had.
+ */
+#if defined (__GNUC__)
+# define INTERRUPT_ATOMIC_LOAD(p) __atomic_load_n ((p), __ATOMIC_ACQUIRE)
+# define INTERRUPT_ATOMIC_EXCHANGE(p, v) \
+   __atomic_exchange_n ((p), (v), __ATOMIC_SEQ_CST)
+# define INTERRUPT_ATOMIC_ADD(p, n) \
+   __atomic_add_fetch ((p), (n), __ATOMIC_SEQ_CST)
+#else
+# define INTERRUPT_ATOMIC_LOAD(p) (*(p))
+# define INTERRUPT_ATOMIC_EXCHANGE(p, v) _interrupt_exchange_uint8 ((p), (v))
+# define INTERRUPT_ATOMIC_ADD(p, n) (*(p) += (n))
+static inline uint8
+_interrupt_exchange_uint8 (volatile uint8 *p, uint8 v)
+{
+  uint8 old = *p;
+  *p = v;
+  return old;
+}
+#endif
+
+#ifdef SYNCHRONOUS_INTERRUPTS
+extern void interrupt_forget_waiters (void);
+#endif
+
+/* Reasons to do some bookkeeping (see CHARGE_BLOCK) every time a block
+ * is entered.  The interrupt poll tests block_accounting on its fast
+ * path, so with no reasons set the bookkeeping costs one test per
+ * block transition.  Native code doesn't poll between blocks it chains
+ * together, so none of this happens in native builds.
+ */
+#define BLOCK_ACCOUNTING_BUDGET   0x1  /* A slice has a finite budget.   */
+#define BLOCK_ACCOUNTING_CALLPROF 0x4  /* The call graph profiler is on. */
+#define BLOCK_ACCOUNTING_IDLE     0x8  /* Idle loops may park the host.  */
+
+extern volatile uint32 block_accounting;
+extern void block_accounting_enable (uint32 reasons);
+extern void block_accounting_disable (uint32 reasons);
+
 #endif  /* Not _interrupt_h_ */
@@ -0,0 +1,59 @@
+#ifndef _jumptable_h_
+#define _jumptable_h_
+
+#include "syn68k_private.h"
+#include "hash.h"
+#include <stddef.h>
+
+/* Switch statements compile to an indexed jmp (d8,PC,Xn), either
+ * straight into a table of branches or through word offsets fetched
+ * from a table by the instruction just before it:
+ *
+ *     move.w  (table,PC,d0.w),d0
+ *     jmp     (table,PC,d0.w)
+ *
+ * When compute_block_info can see where such a table ends, it sizes a
+ * small table of (m68k address, compiled code) slots so that every
+ * target the jmp can reach gets its own slot, and the jmp becomes
+ * opcode 0xBA.  The slots start out empty; the first dispatch to each
+ * target goes through code_lookup and fills its slot, so only targets
+ * that actually run are ever translated.  A target missing from the
+ * table (the table was modified, or we misjudged its extent) just
+ * shares a slot.  Slots are copies of jump cache entries, so they are
+ * all dropped whenever jump_cache_generation changes.
+ */
+#define MAX_JUMP_TABLE_TARGETS 256
+#define MAX_JUMP_TABLE_SLOTS   1024
+
+/* What compute_block_info found out about a jump table. */
+typedef struct
+{
+  uint16 num_targets;      /* Distinct m68k targets, or 0 if none.     */
+  uint16 shift;            /* See JUMP_TABLE_SLOT.                     */
+  uint32 mask;
+} JumpTableInfo;
+
+/* Operands of opcode 0xBA. */
+typedef struct
+{
+  syn68k_addr_t base;      /* PC plus the jmp's displacement.          */
+  uint32 index;            /* Index register, size and scale, laid out
+			    * as in the extension word.                */
+  uint32 shift;
+  uint32 mask;
+  uint32 generation;       /* jump_cache_generation the slots are for. */
+  JumpCacheEntry slot[1];  /* mask + 1 of them.                        */
+} JumpTable;
+
+#define JUMP_TABLE_SLOT(target, base, shift, mask) \
+  ((((target) - (base)) >> (shift)) & (mask))
+
+#define JUMP_TABLE_BYTES(mask) \
+  (offsetof (JumpTable, slot) + ((mask) + 1) * sizeof (JumpCacheEntry))
+
+extern BOOL jump_table_recognize (const uint16 *jmp_code,
+				  const uint16 *prev_code,
+				  JumpTableInfo *jt);
+extern void jump_table_clear (JumpTable *t);
+
+#endif  /* Not _jumptable_h_ */
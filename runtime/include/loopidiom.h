@@ -0,0 +1,37 @@
+#ifndef _loopidiom_h_
+#define _loopidiom_h_
+
+#include "syn68k_private.h"
+
+/* A loop idiom descriptor describes a two instruction block that loops
+ * back to itself with a dbcc, where the first instruction is one of:
+ *
+ *     move.{b,w,l} (Ay)+,(Ax)+      with dbf     (copy)
+ *     clr.{b,w,l}  (Ax)+            with dbf     (clear)
+ *     move.{b,w,l} Dk,(Ax)+         with dbf     (fill)
+ *     cmpm.{b,w,l} (Ay)+,(Ax)+      with dbne    (compare)
+ *
+ * Such blocks get a synthetic opcode at their start which performs all
+ * but the final iteration in one step.  The final iteration runs as
+ * normal synthetic code, so the cc bits end up exactly right.  A
+ * descriptor of 0 means "no idiom".
+ */
+#define LOOP_IDIOM_COPY    1
+#define LOOP_IDIOM_CLEAR   2
+#define LOOP_IDIOM_FILL    3
+#define LOOP_IDIOM_COMPARE 4
+
+#define LOOP_IDIOM(kind, size, counter, ax, ay, dk) \
+  ((kind) | ((size) << 4) | ((counter) << 8) | ((ax) << 12) \
+   | ((ay) << 16) | ((dk) << 20))
+#define LOOP_IDIOM_KIND(d)    ((d) & 0xF)
+#define LOOP_IDIOM_SIZE(d)    (((d) >> 4) & 0x7)
+#define LOOP_IDIOM_COUNTER(d) (((d) >> 8) & 0x7)
+#define LOOP_IDIOM_AX(d)      (((d) >> 12) & 0x7)
+#define LOOP_IDIOM_AY(d)      (((d) >> 16) & 0x7)
+#define LOOP_IDIOM_DK(d)      (((d) >> 20) & 0x7)
+
+extern uint32 loop_idiom_recognize (uint16 m68kop, uint16 dbcc_op);
+extern void loop_idiom_execute (uint32 descriptor);
+
+#endif  /* Not _loopidiom_h_ */
@@ -2,8 +2,20 @@
 #define _mapping_h_
 
 #include "syn68k_private.h"
+#include "fpu.h"
 
 extern const uint16 opcode_map_index[];
 extern const OpcodeMappingInfo opcode_map_info[];
 
+/* The opcode_map_info sequence to translate the 68k instruction at CODE
+ * (whose first word is M68KOP) with.  FPU instructions we can't emulate,
+ * which while FPU emulation is off means all of them, are translated
+ * like 0xF000, which nothing but the F-line trap claims.
+ */
+#define OPCODE_MAP_INFO(m68kop, code)					\
+  (&opcode_map_info[(((m68kop) & 0xFF00) == 0xF200			\
+		     && !fpu_translatable_p (code))			\
+		    ? opcode_map_index[0xF000]				\
+		    : opcode_map_index[m68kop]])
+
 #endif  /* Not _mapping_h_ */
@@ -0,0 +1,30 @@
+#ifndef _nativecov_h_
+#define _nativecov_h_
+
+#include "syn68k_private.h"
+
+/* Native coverage statistics tell us which 68k opcodes the native code
+ * generator can't handle and how much that costs at run time.  While
+ * native_coverage_p is set, translate_instruction notes how each 68k
+ * opcode it sees was compiled, and generate_code plants a counting
+ * opcode (0xB9) at each native->synthetic and synthetic->native
+ * transition it emits.
+ */
+extern BOOL native_coverage_p;
+
+#ifdef GENERATE_NATIVE_CODE
+
+typedef enum
+{
+  NATIVE_COVERAGE_NATIVE,        /* Compiled to native code.             */
+  NATIVE_COVERAGE_NO_TEMPLATE,   /* No guest_code_descriptor at all.     */
+  NATIVE_COVERAGE_REJECTED,      /* Descriptor didn't fit the operands.  */
+  NUM_NATIVE_COVERAGE_KINDS
+} native_coverage_kind_t;
+
+extern void native_coverage_note (uint16 m68kop, native_coverage_kind_t kind);
+extern uint32 *native_coverage_fallback_counter (uint16 m68kop);
+
+#endif  /* GENERATE_NATIVE_CODE */
+
+#endif  /* Not _nativecov_h_ */
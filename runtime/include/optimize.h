@@ -0,0 +1,32 @@
+#ifndef _optimize_h_
+#define _optimize_h_
+
+#include "block.h"
+
+/* When a block is translated as part of a loop, the cc bits its
+ * successors need aren't known yet, so the translator assumes the
+ * worst and the loop computes cc bits nobody reads.  Blocks translated
+ * that way are marked cc_provisional.  Once one of them has been
+ * entered OPTIMIZE_CUTOFF times, we solve cc bit liveness exactly over
+ * the region of blocks reachable from it and translate the region
+ * again, feeding the results to generate_block as hints.  Native
+ * recompiles get the same hints.  While retranslating a region, the
+ * translator also propagates constants loaded into address registers
+ * into the amodes that use them.
+ */
+#ifndef OPTIMIZE_CUTOFF
+#define OPTIMIZE_CUTOFF 5000
+#endif
+
+/* Most blocks to analyze at once; successors beyond this are assumed
+ * to need every cc bit.
+ */
+#define MAX_OPTIMIZE_REGION_BLOCKS 256
+
+extern void optimize_hot_region (Block *b);
+extern void optimize_compute_cc_hints (syn68k_addr_t *addrs,
+				       unsigned long num_addrs);
+extern void optimize_discard_cc_hints (void);
+extern int optimize_cc_hint (syn68k_addr_t addr);
+
+#endif  /* Not _optimize_h_ */
@@ -0,0 +1,32 @@
+#ifndef _pagedir_h_
+#define _pagedir_h_
+
+#include "syn68k_private.h"
+#include "block.h"
+
+/* The page directory maps each 68k page to the Blocks whose code overlaps
+ * it.  It is a two level table indexed by page number, so finding the
+ * blocks touching a range costs time proportional to the pages and
+ * blocks involved rather than to the total number of blocks.
+ */
+#define LOG_PAGE_DIR_PAGE_BYTES 12
+#define LOG_PAGE_DIR_LEAF_PAGES 10
+#define PAGE_DIR_LEAF_PAGES (1UL << LOG_PAGE_DIR_LEAF_PAGES)
+#define PAGE_DIR_ROOT_ENTRIES \
+  (1UL << (32 - LOG_PAGE_DIR_PAGE_BYTES - LOG_PAGE_DIR_LEAF_PAGES))
+
+#define PAGE_DIR_PAGE(addr) ((uint32) (addr) >> LOG_PAGE_DIR_PAGE_BYTES)
+
+extern void page_dir_init (void);
+extern void page_dir_destroy (void);
+extern void page_dir_insert (Block *b);
+extern void page_dir_remove (Block *b);
+extern Block *page_dir_lookup (syn68k_addr_t addr);
+extern unsigned long page_dir_find_intersecting (syn68k_addr_t low,
+						 syn68k_addr_t high,
+						 syn68k_addr_t **addrs);
+#ifdef DEBUG
+extern BOOL page_dir_verify (void);
+#endif
+
+#endif  /* Not _pagedir_h_ */
@@ -0,0 +1,15 @@
+#ifndef _rom_h_
+#define _rom_h_
+
+#include "syn68k_private.h"
+
+/* ROM regions are ranges of 68k memory the host promises never to
+ * change.  Blocks whose code lies entirely within one are marked rom:
+ * they are never checksummed, never evicted to save space, and survive
+ * destroy_blocks, except when a block they link to is destroyed.  The
+ * translator may also read ROM data at translation time and bake the
+ * values into the compiled code.
+ */
+extern BOOL rom_range_p (syn68k_addr_t addr, uint32 num_bytes);
+
+#endif  /* Not _rom_h_ */
@@ -0,0 +1,28 @@
+#ifndef _sample_h_
+#define _sample_h_
+
+#include "syn68k_private.h"
+#include <signal.h>
+
+/* The sampling profiler charges each SIGPROF tick to whatever the
+ * emulator is doing at the time.  The signal handler counts ticks that
+ * land while the runtime is busy (sample_busy_depth != 0) or outside
+ * the emulator itself.  For any other tick it only bumps
+ * sample_ticks_pending and asks for an interrupt check, and the next
+ * block transition hands the ticks to sample_charge along with the
+ * address of the block being entered.  So between ticks, block
+ * transitions stay on the fast path, at the price of charging each
+ * tick to the block after the one that was running.
+ */
+extern volatile sig_atomic_t sample_busy_depth;
+extern volatile sig_atomic_t sample_ticks_pending;
+extern void sample_charge (syn68k_addr_t addr);
+
+/* Bracket work that ticks should be charged to the runtime for.  Unlike
+ * note_busy, these nest, so destroying blocks in the middle of a
+ * translation doesn't cut the translation's busy time short.
+ */
+#define SAMPLE_BUSY_BEGIN() ((void) ++sample_busy_depth)
+#define SAMPLE_BUSY_END()   ((void) --sample_busy_depth)
+
+#endif  /* Not _sample_h_ */
@@ -0,0 +1,57 @@
+#ifndef _trace_h_
+#define _trace_h_
+
+#include "syn68k_private.h"
+
+/* The runtime can log what it is doing (translating, invalidating,
+ * checksumming, taking interrupts...) as timestamped events in a fixed
+ * size ring buffer, which syn68k_trace_write dumps as Chrome trace JSON
+ * for chrome://tracing or Perfetto.  While tracing is off, each trace
+ * point costs a single test of trace_events.
+ */
+typedef enum
+{
+  TRACE_GENERATE,         /* Outermost generate_block call.            */
+  TRACE_DESTROY,          /* destroy_blocks and friends.               */
+  TRACE_CHECKSUM_SWEEP,   /* Checksum of every block.                  */
+  TRACE_CHECKSUM_DEFER,   /* Full flush deferred to block entry.       */
+  TRACE_REVALIDATE,       /* Checksum of one block and its children.   */
+  TRACE_RECOMPILE_NATIVE, /* recompile_block_as_native.                */
+  TRACE_OPTIMIZE,         /* Hot region retranslation.                 */
+  TRACE_INTERRUPT,        /* Interrupt taken.                          */
+  TRACE_BUSY,             /* call_while_busy_func told we're busy.     */
+  TRACE_IDLE_PARK,        /* Host parked in a guest idle loop.         */
+  NUM_TRACE_EVENT_TYPES
+} trace_event_type_t;
+
+typedef struct
+{
+  uint64 time_ns;
+  uint32 arg[2];   /* Meaning depends on type and phase; see trace.c. */
+  uint8 type;      /* A trace_event_type_t.                           */
+  char phase;      /* 'B'egin, 'E'nd or 'i'nstant, as in Chrome.     */
+} trace_event_t;
+
+extern trace_event_t *trace_events;  /* NULL iff tracing is off. */
+
+extern void trace_record (trace_event_type_t type, char phase,
+			  uint32 arg0, uint32 arg1);
+extern void trace_note_busy (int busy_p);
+
+#define TRACE_EVENT(type, phase, arg0, arg1)				\
+do {									\
+  if (trace_events != NULL)						\
+    trace_record ((type), (phase), (arg0), (arg1));			\
+} while (0)
+
+#define TRACE_BEGIN(type, arg0, arg1)   TRACE_EVENT (type, 'B', arg0, arg1)
+#define TRACE_END(type, arg0, arg1)     TRACE_EVENT (type, 'E', arg0, arg1)
+#define TRACE_INSTANT(type, arg0, arg1) TRACE_EVENT (type, 'i', arg0, arg1)
+
+#define TRACE_BUSY(busy_p)			\
+do {						\
+  if (trace_events != NULL)			\
+    trace_note_busy (busy_p);			\
+} while (0)
+
+#endif  /* Not _trace_h_ */
@@ -2,9 +2,21 @@
 #define _translate_h_
 
 #include "block.h"
+#include "trace.h"
 
 extern void (*call_while_busy_func)(int);
 
+/* Lets the user-defined busy function (and the trace) know whether we
+ * are busy.  These calls don't nest; see SAMPLE_BUSY_BEGIN for that.
+ */
+static inline void
+note_busy (int busy_p)
+{
+  TRACE_BUSY (busy_p);
+  if (call_while_busy_func != NULL)
+    call_while_busy_func (busy_p);
+}
+
 typedef struct {
   BOOL valid;
   BOOL reversed;
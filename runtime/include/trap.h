@@ -7,6 +7,7 @@ extern syn68k_addr_t trap_direct (uint32 trap_number,
 				  syn68k_addr_t exception_pc,
 				  syn68k_addr_t exception_address);
 extern uint32 trap_forwarded (syn68k_addr_t m68k_address, void *arg);
+extern syn68k_addr_t a_line_trap_dispatch (syn68k_addr_t trap_pc);
 extern void trap_init (void);
 extern void trap_install_handler (unsigned trap_number,
 				  callback_handler_t func,
@@ -1,6 +1,6 @@
 #include "syn68k_private.h"
 #include "hash.h"
-#include "rangetree.h"
+#include "pagedir.h"
 #include "callback.h"
 #include "trap.h"
 #include "alloc.h"
@@ -80,8 +80,9 @@ initialize_68k_emulator (void (*while_busy)(int), int native_p,
 #endif
 
   /* Call various initialization routines. */
+  block_init ();
   hash_init ();
-  range_tree_init ();
+  page_dir_init ();
   callback_init ();
   trap_init ();
 
@@ -103,7 +104,7 @@ initialize_68k_emulator (void (*while_busy)(int), int native_p,
 #endif
 
   hash_insert (b);
-  range_tree_insert (b);
+  page_dir_insert (b);
 
   /* Create the magical block that contains an RTE. */
   b = NULL;
@@ -121,14 +122,14 @@ initialize_68k_emulator (void (*while_busy)(int), int native_p,
 #endif
   assert (b != NULL);
   hash_remove (b);
-  range_tree_remove (b);
+  page_dir_remove (b);
   death_queue_dequeue (b);
   b->m68k_start_address = MAGIC_RTE_ADDRESS;
   b->m68k_code_length   = 1;
   b->checksum = compute_block_checksum (b);
   b->immortal = TRUE;
   hash_insert (b);
-  range_tree_insert (b);
+  page_dir_insert (b);
 }
 
 #if SIZEOF_CHAR_P > 4 || defined(TWENTYFOUR_BIT_ADDRESSING)
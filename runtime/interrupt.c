@@ -1,21 +1,185 @@
 #include "interrupt.h"
 
+volatile uint32 block_accounting;
+
+
+/* Starts doing the per-block bookkeeping for REASONS, a mask of
+ * BLOCK_ACCOUNTING_* bits.  Call this from the thread running the
+ * emulator.
+ */
+void
+block_accounting_enable (uint32 reasons)
+{
+  block_accounting |= reasons;
+}
+
+
+/* Stops doing the per-block bookkeeping for REASONS. */
+void
+block_accounting_disable (uint32 reasons)
+{
+  block_accounting &= ~reasons;
+}
+
+
 #ifdef SYNCHRONOUS_INTERRUPTS
 
 #include "trap.h"
+#include "trace.h"
+#include "sample.h"
+
+#if defined (__linux__)
+# include <linux/futex.h>
+# include <sys/syscall.h>
+# include <time.h>
+# include <unistd.h>
+#elif defined (_WIN32)
+# include <windows.h>
+#else
+# include <time.h>
+#endif
+
+
+/* Bumped by every post, so syn68k_interrupt_wait can sleep on it
+ * without missing a wakeup.  interrupt_waiters lets posters skip the wakeup
+ * system call when nobody is asleep.
+ */
+static volatile uint32 interrupt_sequence;
+static volatile uint32 interrupt_waiters;
+
+
+static void
+wake_interrupt_waiters (void)
+{
+#if defined (__linux__)
+  syscall (SYS_futex, &interrupt_sequence, FUTEX_WAKE_PRIVATE, INT32_MAX,
+	   NULL, NULL, 0);
+#endif
+  /* Elsewhere waiters poll interrupt_sequence. */
+}
 
 
+/* Sleeps until interrupt_sequence is no longer SEQ, TIMEOUT_MSECS
+ * elapse (negative means forever), or something else wakes us up.
+ */
+static void
+wait_for_interrupt_sequence (uint32 seq, int32 timeout_msecs)
+{
+#if defined (__linux__)
+  struct timespec ts, *tsp;
+
+  if (timeout_msecs < 0)
+    tsp = NULL;
+  else
+    {
+      ts.tv_sec  = timeout_msecs / 1000;
+      ts.tv_nsec = (timeout_msecs % 1000) * 1000000L;
+      tsp = &ts;
+    }
+  syscall (SYS_futex, &interrupt_sequence, FUTEX_WAIT_PRIVATE, seq, tsp,
+	   NULL, 0);
+#else
+  while (INTERRUPT_ATOMIC_LOAD (&interrupt_sequence) == seq
+	 && timeout_msecs != 0)
+    {
+# if defined (_WIN32)
+      Sleep (1);
+# else
+      struct timespec ts = { 0, 1000000L };
+      nanosleep (&ts, NULL);
+# endif
+      if (timeout_msecs > 0)
+	--timeout_msecs;
+    }
+#endif
+}
 
+
+/* Posts an interrupt at PRIORITY.  This may be called from any thread
+ * or from a signal handler.  Posting a priority that is already
+ * pending and not yet noticed by the emulator is coalesced into the
+ * earlier post, but still wakes up syn68k_interrupt_wait; the interrupt
+ * status may be "changed" for other reasons, so it says nothing about
+ * whether a waiter has seen this post.
+ */
 void
 interrupt_generate (unsigned priority)
 {
   /* Calling this with a weird priority will just note that an interrupt
    * should be checked for.
    */
-  if (priority >= 1 && priority <= 7)
-    cpu_state.interrupt_pending[priority] = TRUE;
+  if (priority < 1 || priority > 7
+      || !INTERRUPT_ATOMIC_EXCHANGE (&cpu_state.interrupt_pending[priority],
+				     TRUE)
+      || !INTERRUPT_PENDING ())
+    SET_INTERRUPT_STATUS (INTERRUPT_STATUS_CHANGED);
+
+  syn68k_interrupt_wake ();
+}
 
-  SET_INTERRUPT_STATUS (INTERRUPT_STATUS_CHANGED);
+
+/* Wakes up anyone in syn68k_interrupt_wait without posting an
+ * interrupt.  Hosts call this after changing guest memory that an idle
+ * guest may be polling.  Like interrupt_generate, this is safe from any
+ * thread or signal handler.
+ */
+void
+syn68k_interrupt_wake (void)
+{
+  INTERRUPT_ATOMIC_ADD (&interrupt_sequence, 1);
+  if (INTERRUPT_ATOMIC_LOAD (&interrupt_waiters) != 0)
+    wake_interrupt_waiters ();
+}
+
+
+/* Forgets about threads sleeping in syn68k_interrupt_wait, which don't
+ * exist in a child after fork ().
+ */
+void
+interrupt_forget_waiters (void)
+{
+  interrupt_waiters = 0;
+}
+
+
+/* Returns TRUE iff the emulator has an interrupt to look at.  The
+ * interrupt status also gets "changed" for other reasons (the sampling
+ * profiler, say), so look for a posted interrupt the CPU would take.
+ */
+static BOOL
+interrupt_posted_p (void)
+{
+  int priority, cpu_priority;
+
+  /* Priority 7 interrupt cannot be masked. */
+  cpu_priority = (cpu_state.sr >> 8) & 7;
+  if (cpu_priority == 7)
+    cpu_priority = 6;
+  for (priority = 7; priority > cpu_priority; priority--)
+    if (INTERRUPT_ATOMIC_LOAD (&cpu_state.interrupt_pending[priority]))
+      return TRUE;
+  return FALSE;
+}
+
+
+/* Blocks the calling thread until an interrupt is posted, someone
+ * calls syn68k_interrupt_wake, or TIMEOUT_MSECS milliseconds pass
+ * (negative means no timeout).  This may return early, so callers
+ * should treat it as a hint.  Returns nonzero iff the emulator has an
+ * interrupt to look at.
+ */
+int
+syn68k_interrupt_wait (int32 timeout_msecs)
+{
+  uint32 seq;
+
+  INTERRUPT_ATOMIC_ADD (&interrupt_waiters, 1);
+  seq = INTERRUPT_ATOMIC_LOAD (&interrupt_sequence);
+  if (!interrupt_posted_p () && timeout_msecs != 0)
+    wait_for_interrupt_sequence (seq, timeout_msecs);
+  INTERRUPT_ATOMIC_ADD (&interrupt_waiters, -1);
+
+  return interrupt_posted_p ();
 }
 
 
@@ -28,7 +192,7 @@ interrupt_note_if_present ()
   int i;
 
   for (i = 1; i <= 7; i++)
-    if (cpu_state.interrupt_pending[i])
+    if (INTERRUPT_ATOMIC_LOAD (&cpu_state.interrupt_pending[i]))
       {
 	SET_INTERRUPT_STATUS (INTERRUPT_STATUS_CHANGED);
 	break;
@@ -57,14 +221,18 @@ interrupt_process_any_pending (syn68k_addr_t interrupt_pc)
    */
   SET_INTERRUPT_STATUS (INTERRUPT_STATUS_UNCHANGED);
 
+  /* The sampling profiler asks for a poll to find out where we are. */
+  if (sample_ticks_pending != 0)
+    sample_charge (interrupt_pc);
+
   /* Determine if any interrupt with high enough priority is pending. */
   cpu_priority = (cpu_state.sr >> 8) & 7;
-  if (cpu_state.interrupt_pending[7])
+  if (INTERRUPT_ATOMIC_LOAD (&cpu_state.interrupt_pending[7]))
     priority = 7;  /* Priority 7 interrupt cannot be masked. */
   else
     {
       for (priority = 6; priority > cpu_priority; priority--)
-	if (cpu_state.interrupt_pending[priority])
+	if (INTERRUPT_ATOMIC_LOAD (&cpu_state.interrupt_pending[priority]))
 	  break;
       if (priority <= cpu_priority)
 	priority = -1;
@@ -75,7 +243,9 @@ interrupt_process_any_pending (syn68k_addr_t interrupt_pc)
   if (priority != -1)
     {
       /* Process the interrupt. */
-      cpu_state.interrupt_pending[priority] = 0;
+      TRACE_INSTANT (TRACE_INTERRUPT, interrupt_pc, priority);
+      INTERRUPT_ATOMIC_EXCHANGE (&cpu_state.interrupt_pending[priority],
+				 FALSE);
       continuation_pc =  trap_direct (24 + priority, interrupt_pc, 0);
     }
   else
@@ -0,0 +1,206 @@
+/*
+ * jumptable.c - Recognizes switch statement jump tables; see jumptable.h.
+ *
+ *   A table's length isn't written down anywhere, so we guess it from
+ *   the code around it.  A word offset table ends where the nearest case
+ *   after it begins, which is how compilers lay them out; if the cases
+ *   all come first, we can't tell, and give up.  A branch table ends at
+ *   the first entry that isn't a bra of the same size as the first.
+ *   Either way, a bad guess only costs a slot table that fits the real
+ *   targets less well, since nothing is translated until it runs.
+ */
+
+#include "syn68k_private.h"
+#include "jumptable.h"
+#include <string.h>
+
+
+/* Adds TARGET to the N targets in TARGET_LIST unless it's already
+ * there.  Returns the new number of targets.
+ */
+static int
+add_target (uint32 *target_list, int n, syn68k_addr_t target)
+{
+  int i;
+
+  for (i = 0; i < n; i++)
+    if (target_list[i] == target)
+      return n;
+  target_list[n] = target;
+  return n + 1;
+}
+
+
+/* Finds the targets of a jmp (BASE,PC,Dm.w) where Dm was just loaded
+ * from the word offset table at TABLE.  Returns how many there are, or
+ * 0 if we can't tell where the table ends.
+ */
+static int
+offset_table_targets (syn68k_addr_t table, syn68k_addr_t base,
+		      uint32 *target_list)
+{
+  syn68k_addr_t entry, end, target;
+  int i, n;
+
+  end = ~0;
+  for (i = n = 0, entry = table; entry < end; i++, entry += 2)
+    {
+      if (i == MAX_JUMP_TABLE_TARGETS)
+	return 0;
+
+      target = base + READSW (entry);
+      if (target & 1)
+	return 0;
+      if (target >= table && target < entry + 2)
+	return 0;     /* Into the entries we've seen; not a table. */
+      if (target > entry && target < end)
+	end = target;
+
+      n = add_target (target_list, n, target);
+    }
+
+  return n;
+}
+
+
+/* Finds the bra instructions in the branch table at TABLE.  Returns how
+ * many there are, or 0 if there are fewer than two.
+ */
+static int
+branch_table_targets (syn68k_addr_t table, uint32 *target_list)
+{
+  syn68k_addr_t entry, end, dest;
+  int n, size, stride;
+  uint16 op;
+
+  end = ~0;
+  stride = 0;
+  for (n = 0, entry = table; entry < end && n < MAX_JUMP_TABLE_TARGETS;
+       n++, entry += stride)
+    {
+      op = READUW (entry);
+      if ((op >> 8) != 0x60 || (op & 0xFF) == 0xFF)
+	break;
+      if ((op & 0xFF) == 0)   /* bra.w */
+	{
+	  size = 4;
+	  dest = entry + 2 + READSW (entry + 2);
+	}
+      else                    /* bra.s */
+	{
+	  size = 2;
+	  dest = entry + 2 + (int8) op;
+	}
+
+      if (stride == 0)
+	stride = size;
+      else if (size != stride)
+	break;
+      if (dest > entry && dest < end)
+	end = dest;
+
+      target_list[n] = entry;
+    }
+
+  return (n >= 2) ? n : 0;
+}
+
+
+/* Picks the smallest slot table, and a shift, for which the
+ * JT->num_targets targets in TARGET_LIST all get different slots.
+ * Returns FALSE if there's no such table of reasonable size.
+ */
+static BOOL
+choose_slots (JumpTableInfo *jt, const uint32 *target_list,
+	      syn68k_addr_t base)
+{
+  uint8 used[MAX_JUMP_TABLE_SLOTS];
+  uint32 num_slots, slot;
+  int shift, i;
+
+  for (num_slots = 1; num_slots < jt->num_targets; num_slots *= 2)
+    ;
+  for (; num_slots <= MAX_JUMP_TABLE_SLOTS; num_slots *= 2)
+    for (shift = 1; shift <= 4; shift++)
+      {
+	memset (used, 0, num_slots);
+	for (i = 0; i < jt->num_targets; i++)
+	  {
+	    slot = JUMP_TABLE_SLOT (target_list[i], base, shift,
+				    num_slots - 1);
+	    if (used[slot])
+	      break;
+	    used[slot] = 1;
+	  }
+
+	if (i == jt->num_targets)
+	  {
+	    jt->shift = shift;
+	    jt->mask = num_slots - 1;
+	    return TRUE;
+	  }
+      }
+
+  return FALSE;
+}
+
+
+/* Looks for a jump table dispatched through the jmp at JMP_CODE, the
+ * last instruction of a block; PREV_CODE is the instruction before it
+ * in the same block, or NULL.  On success, fills in JT and returns TRUE.
+ */
+BOOL
+jump_table_recognize (const uint16 *jmp_code, const uint16 *prev_code,
+		      JumpTableInfo *jt)
+{
+  uint32 target_list[MAX_JUMP_TABLE_TARGETS];
+  syn68k_addr_t base;
+  uint16 ext, prev_ext;
+  int n;
+
+  jt->num_targets = 0;
+
+  /* jmp (d8,PC,Xn) with a brief extension word. */
+  if (READUW (US_TO_SYN68K (jmp_code)) != 0x4EFB)
+    return FALSE;
+  ext = READUW (US_TO_SYN68K (jmp_code + 1));
+  if (ext & 0x100)
+    return FALSE;
+  base = US_TO_SYN68K (jmp_code + 1) + (int8) ext;
+
+  /* Is Dm.w, unscaled, loaded by move.w (d8,PC,Xn),Dm just before? */
+  if (prev_code != NULL && (ext & 0x8E00) == 0
+      && (READUW (US_TO_SYN68K (prev_code))
+	  == (0x303B | (((ext >> 12) & 7) << 9)))
+      && !((prev_ext = READUW (US_TO_SYN68K (prev_code + 1))) & 0x100))
+    n = offset_table_targets (US_TO_SYN68K (prev_code + 1) + (int8) prev_ext,
+			      base, target_list);
+  else
+    n = branch_table_targets (base, target_list);
+
+  if (n == 0)
+    return FALSE;
+
+  jt->num_targets = n;
+  if (!choose_slots (jt, target_list, base))
+    {
+      jt->num_targets = 0;
+      return FALSE;
+    }
+  return TRUE;
+}
+
+
+/* Empties every slot of T, and marks it current. */
+void
+jump_table_clear (JumpTable *t)
+{
+  uint32 i;
+
+  for (i = 0; i <= t->mask; i++)
+    {
+      t->slot[i].m68k_address  = JUMP_CACHE_EMPTY;
+      t->slot[i].compiled_code = NULL;
+    }
+  t->generation = jump_cache_generation;
+}
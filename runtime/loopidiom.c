@@ -0,0 +1,181 @@
+#include "syn68k_private.h"
+#include "loopidiom.h"
+#include <string.h>
+
+/* This file recognizes and executes simple memory copy, fill and compare
+ * loops; see loopidiom.h.  The m68k code for such a loop is
+ * translated as usual, but the synthetic code gets a bulk opcode in
+ * front which uses host memmove/memset/memcmp for all but the last
+ * iteration and leaves the counter and address registers exactly as
+ * the skipped iterations would have.
+ */
+
+
+/* Returns a loop idiom descriptor for a block whose first instruction is
+ * M68KOP and whose second (and last) instruction is the dbcc DBCC_OP
+ * branching back to the start of the block, or 0 if it isn't a loop
+ * we handle.
+ */
+uint32
+loop_idiom_recognize (uint16 m68kop, uint16 dbcc_op)
+{
+  static const int move_size[4] = { 0, 1, 4, 2 };
+  int counter = dbcc_op & 7;
+  int ax = (m68kop >> 9) & 7, ay = m68kop & 7;
+  int size;
+
+  /* Byte-sized (a7)+ bumps a7 by 2, so leave those loops alone. */
+  if ((dbcc_op & 0xFFF8) == 0x51C8)  /* dbf */
+    {
+      if ((m68kop & 0xC1F8) == 0x00D8)  /* move.x (Ay)+,(Ax)+ */
+	{
+	  size = move_size[m68kop >> 12];
+	  if (size != 0 && ax != ay && (size != 1 || (ax != 7 && ay != 7)))
+	    return LOOP_IDIOM (LOOP_IDIOM_COPY, size, counter, ax, ay, 0);
+	}
+      else if ((m68kop & 0xC1F8) == 0x00C0)  /* move.x Dk,(Ax)+ */
+	{
+	  size = move_size[m68kop >> 12];
+	  if (size != 0 && ay != counter && (size != 1 || ax != 7))
+	    return LOOP_IDIOM (LOOP_IDIOM_FILL, size, counter, ax, 0, ay);
+	}
+      else if ((m68kop & 0xFF38) == 0x4218 && (m68kop & 0xC0) != 0xC0)
+	{
+	  /* clr.x (Ay)+ */
+	  size = 1 << ((m68kop >> 6) & 3);
+	  if (size != 1 || ay != 7)
+	    return LOOP_IDIOM (LOOP_IDIOM_CLEAR, size, counter, ay, 0, 0);
+	}
+    }
+  else if ((dbcc_op & 0xFFF8) == 0x56C8)  /* dbne */
+    {
+      if ((m68kop & 0xF138) == 0xB108 && (m68kop & 0xC0) != 0xC0)
+	{
+	  /* cmpm.x (Ay)+,(Ax)+ */
+	  size = 1 << ((m68kop >> 6) & 3);
+	  if (ax != ay && (size != 1 || (ax != 7 && ay != 7)))
+	    return LOOP_IDIOM (LOOP_IDIOM_COMPARE, size, counter, ax, ay, 0);
+	}
+    }
+
+  return 0;
+}
+
+
+/* Returns TRUE iff the NUM_BYTES of 68k memory at ADDR map to
+ * contiguous host memory.
+ */
+static BOOL
+contiguous_p (syn68k_addr_t addr, uint32 num_bytes)
+{
+  syn68k_addr_t last = addr + num_bytes - 1;
+
+  if (last < addr)
+    return FALSE;
+#if SIZEOF_CHAR_P == 8 || defined (TWENTYFOUR_BIT_ADDRESSING)
+  if ((last & ADDRESS_MASK) < (addr & ADDRESS_MASK)
+      || (((addr & ADDRESS_MASK) >> (ADDRESS_BITS - OFFSET_TABLE_BITS))
+	  != ((last & ADDRESS_MASK) >> (ADDRESS_BITS - OFFSET_TABLE_BITS))))
+    return FALSE;
+#endif
+  return TRUE;
+}
+
+
+/* Performs all but the last iteration of the loop described by
+ * DESCRIPTOR on the current cpu_state.  If the memory involved isn't
+ * simple enough, does nothing and lets the loop run normally.
+ */
+void
+loop_idiom_execute (uint32 descriptor)
+{
+  int size = LOOP_IDIOM_SIZE (descriptor);
+  uint32 *counter = &EM_DREG (LOOP_IDIOM_COUNTER (descriptor));
+  uint32 *ax = &EM_AREG (LOOP_IDIOM_AX (descriptor));
+  uint32 *ay = &EM_AREG (LOOP_IDIOM_AY (descriptor));
+  uint32 n, num_bytes, i;
+  uint8 *dst;
+  const uint8 *src;
+
+  /* The dbcc leaves the loop after COUNTER.w + 1 iterations. */
+  n = *counter & 0xFFFF;
+  if (n == 0)
+    return;
+  num_bytes = n * size;
+  if (!contiguous_p (*ax, num_bytes))
+    return;
+  dst = (uint8 *) SYN68K_TO_US (CLEAN (*ax));
+
+  switch (LOOP_IDIOM_KIND (descriptor))
+    {
+    case LOOP_IDIOM_COPY:
+      if (!contiguous_p (*ay, num_bytes))
+	return;
+      src = (const uint8 *) SYN68K_TO_US (CLEAN (*ay));
+      if (dst <= src || dst >= src + num_bytes)
+	memmove (dst, src, num_bytes);
+      else
+	{
+	  /* Overlapping forward copy; replicate the m68k's element at
+	   * a time semantics.
+	   */
+	  for (i = 0; i < num_bytes; i += size)
+	    {
+	      uint32 tmp;
+	      memcpy (&tmp, src + i, size);
+	      memcpy (dst + i, &tmp, size);
+	    }
+	}
+      *ay += num_bytes;
+      break;
+
+    case LOOP_IDIOM_CLEAR:
+      memset (dst, 0, num_bytes);
+      break;
+
+    case LOOP_IDIOM_FILL:
+      {
+	uint32 val = EM_DREG (LOOP_IDIOM_DK (descriptor));
+
+	if (size == 1)
+	  memset (dst, val & 0xFF, num_bytes);
+	else if (size == 2)
+	  {
+	    uint16 v = SWAPUW_IFLE (val);
+	    for (i = 0; i < num_bytes; i += 2)
+	      memcpy (dst + i, &v, 2);
+	  }
+	else
+	  {
+	    uint32 v = SWAPUL_IFLE (val);
+	    for (i = 0; i < num_bytes; i += 4)
+	      memcpy (dst + i, &v, 4);
+	  }
+      }
+      break;
+
+    case LOOP_IDIOM_COMPARE:
+      if (!contiguous_p (*ay, num_bytes))
+	return;
+      src = (const uint8 *) SYN68K_TO_US (CLEAN (*ay));
+
+      /* Find the first unequal element; the final iteration will
+       * compare it (or the last element) and set the cc bits.
+       */
+      if (memcmp (dst, src, num_bytes) != 0)
+	{
+	  for (i = 0; dst[i] == src[i]; i++)
+	    ;
+	  n = i / size;
+	  num_bytes = n * size;
+	}
+      *ay += num_bytes;
+      break;
+
+    default:
+      return;
+    }
+
+  *ax += num_bytes;
+  *counter -= n;  /* Only the low word can change, since n <= counter.w. */
+}
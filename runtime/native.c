@@ -298,8 +298,8 @@ generate_native_code (const guest_code_descriptor_t *first_desc,
   /* Save these away in case we realize a mistake and we have to start over. */
   orig_code = *code;
   orig_cache_info = *cache_info;
-  orig_backpatch = block->backpatch;
-  block->backpatch = NULL;
+  orig_backpatch = BLOCK_COLD (block)->backpatch;
+  BLOCK_COLD (block)->backpatch = NULL;
 
 #ifdef DEBUG
       verify_cache_consistency (cache_info);
@@ -576,9 +576,10 @@ generate_native_code (const guest_code_descriptor_t *first_desc,
 	   * by the last function call.
 	   */
 	  offset = ((char *)code_start - (char *)orig_code) * 8;
-	  for (bp = block->backpatch; bp != old_first_backpatch; bp = bp->next)
+	  for (bp = BLOCK_COLD (block)->backpatch; bp != old_first_backpatch;
+	       bp = bp->next)
 	    bp->offset_location += offset;
-	  old_first_backpatch = block->backpatch;
+	  old_first_backpatch = BLOCK_COLD (block)->backpatch;
 	}
       
       /* Update the cache_info to reflect the new cached register status. */
@@ -627,13 +628,13 @@ generate_native_code (const guest_code_descriptor_t *first_desc,
 #endif
 
       /* Prepend all new backpatches to the final list. */
-      for (bp = block->backpatch; bp != NULL; bp = bp_next)
+      for (bp = BLOCK_COLD (block)->backpatch; bp != NULL; bp = bp_next)
 	{
 	  bp_next = bp->next;
 	  bp->next = orig_backpatch;
 	  orig_backpatch = bp;
 	}
-      block->backpatch = orig_backpatch;
+      BLOCK_COLD (block)->backpatch = orig_backpatch;
 
       /* Success! */
       return TRUE;
@@ -647,12 +648,12 @@ generate_native_code (const guest_code_descriptor_t *first_desc,
       *code = orig_code;
       *cache_info = orig_cache_info;
     failure_no_copy:
-      for (bp = block->backpatch; bp != NULL; bp = bp_next)
+      for (bp = BLOCK_COLD (block)->backpatch; bp != NULL; bp = bp_next)
 	{
 	  bp_next = bp->next;
 	  free (bp);
 	}
-      block->backpatch = NULL;
+      BLOCK_COLD (block)->backpatch = NULL;
     }
 
   
@@ -661,7 +662,7 @@ generate_native_code (const guest_code_descriptor_t *first_desc,
 #endif
 
   /* We failed to generate the desired native code. */
-  block->backpatch = orig_backpatch;
+  BLOCK_COLD (block)->backpatch = orig_backpatch;
   return FALSE;
 }
 
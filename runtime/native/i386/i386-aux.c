@@ -3000,6 +3000,291 @@ host_divsw_imm_reg (COMMON_ARGS, int32 val)
 }
 
 
+/* 32x32->32 bit mulsl/mulul with a data register source.  KIND is the
+ * size and signedness field of the extension word; 64 bit products are
+ * left to the synthetic code.  The signed case gets V straight from
+ * imull's overflow flag.  The unsigned case can only use imull if nobody
+ * cares about V, which depends on the high half of the product;
+ * otherwise we fail and let host_mulul_reg_reg do it with mull.
+ */
+int
+host_mull_reg_reg (COMMON_ARGS, int32 src, int32 dst, int32 kind)
+{
+  switch (kind)
+    {
+    case 0:  /* mulul */
+      if (cc_to_compute & M68K_CCV)
+	return 1;
+      i386_imull_reg_reg (c, codep, cc_spill_if_changed, M68K_CC_NONE,
+			  scratch_reg, src, dst);
+      break;
+    case 2:  /* mulsl */
+      i386_imull_reg_reg (c, codep, cc_spill_if_changed, M68K_CC_NONE,
+			  scratch_reg, src, dst);
+      if (cc_to_compute & M68K_CCV)
+	{
+	  i386_seto_indoff (c, codep, cc_spill_if_changed, M68K_CC_NONE,
+			    scratch_reg, offsetof (CPUState, ccv), REG_EBP);
+	  c->cached_cc &= ~M68K_CCV;
+	  c->dirty_cc  &= ~M68K_CCV;
+	  cc_to_compute &= ~M68K_CCV;
+	}
+      break;
+    default:
+      return 1;
+    }
+
+  if (cc_to_compute)
+    i386_testl_reg_reg (COMMON_ARG_NAMES, dst, dst);
+  return 0;
+}
+
+
+/* Unsigned 32x32->32 bit mulul with a data register source, computing
+ * V.  scratch_reg must be %eax, and we grab %edx for the high half of
+ * the product.
+ */
+int
+host_mulul_reg_reg (COMMON_ARGS, int32 src, int32 dst, int32 kind)
+{
+  if (kind != 0)
+    return 1;
+
+  assert (scratch_reg == REG_EAX && src != REG_EDX && dst != REG_EDX);
+
+  if (host_alloc_reg (c, codep, cc_spill_if_changed, 1L << REG_EDX)
+      != REG_EDX)
+    return 3;
+
+  i386_movl_reg_reg (c, codep, cc_spill_if_changed, M68K_CC_NONE,
+		     scratch_reg, dst, REG_EAX);
+  i386_mull (c, codep, cc_spill_if_changed, M68K_CC_NONE, scratch_reg, src);
+  i386_movl_reg_reg (c, codep, cc_spill_if_changed, M68K_CC_NONE,
+		     scratch_reg, REG_EAX, dst);
+
+  if (cc_to_compute & M68K_CCV)
+    {
+      i386_testl_reg_reg (c, codep, cc_spill_if_changed, M68K_CC_NONE,
+			  scratch_reg, REG_EDX, REG_EDX);
+      i386_setnz_indoff (c, codep, cc_spill_if_changed, M68K_CC_NONE,
+			 scratch_reg, offsetof (CPUState, ccv), REG_EBP);
+      c->cached_cc &= ~M68K_CCV;
+      c->dirty_cc  &= ~M68K_CCV;
+      cc_to_compute &= ~M68K_CCV;
+    }
+
+  if (cc_to_compute)
+    i386_testl_reg_reg (COMMON_ARG_NAMES, dst, dst);
+  return 0;
+}
+
+
+/* Decodes the offset and width fields of a bit field extension word into
+ * OFFSETP and WIDTHP.  Returns FALSE if either one comes from a data
+ * register, since then we don't know it until run time.
+ */
+static BOOL
+bf_static_field (int32 offset_field, int32 width_field,
+		 int32 *offsetp, int32 *widthp)
+{
+  if ((offset_field | width_field) & 0x20)
+    return FALSE;
+  *offsetp = offset_field & 31;
+  *widthp = ((width_field - 1) & 31) + 1;
+  return TRUE;
+}
+
+
+/* Returns a mask of the top WIDTH bits of a long. */
+static inline uint32
+bf_top_mask (int32 width)
+{
+  return 0xFFFFFFFFUL << (32 - width);
+}
+
+
+/* Returns a mask of the bits a register bit field at OFFSET of WIDTH
+ * bits occupies.  Fields wrap around from bit 0 to bit 31.
+ */
+static inline uint32
+bf_reg_mask (int32 offset, int32 width)
+{
+  uint32 mask = bf_top_mask (width);
+  return offset ? (mask >> offset) | (mask << (32 - offset)) : mask;
+}
+
+
+/* Sets the cc bits for the register bit field at OFFSET of WIDTH bits,
+ * given a copy of the register in REG, which gets clobbered.  Rotating
+ * the field to the top of REG puts its high bit where N wants it.
+ */
+static void
+bf_test_reg_copy (COMMON_ARGS, int32 reg, int32 offset, int32 width)
+{
+  if (offset != 0)
+    i386_roll_imm_reg (c, codep, cc_spill_if_changed, M68K_CC_NONE,
+		       scratch_reg, offset, reg);
+  if (width == 32)
+    i386_testl_reg_reg (COMMON_ARG_NAMES, reg, reg);
+  else
+    i386_andl_imm_reg (COMMON_ARG_NAMES, bf_top_mask (width), reg);
+}
+
+
+int
+host_bftst_reg (COMMON_ARGS, int32 reg, int32 offset_field,
+		int32 width_field)
+{
+  int32 offset, width;
+
+  if (!bf_static_field (offset_field, width_field, &offset, &width))
+    return 1;
+
+  if (cc_to_compute)
+    {
+      i386_movl_reg_reg (c, codep, cc_spill_if_changed, M68K_CC_NONE,
+			 scratch_reg, reg, scratch_reg);
+      bf_test_reg_copy (COMMON_ARG_NAMES, scratch_reg, offset, width);
+    }
+  return 0;
+}
+
+
+/* bfchg, bfset and bfclr test the field before they change it, so we
+ * keep a copy of the register to compute the cc bits from.
+ */
+#define HOST_BF_CHANGE_REG(name, op, mask)				\
+int									\
+host_ ## name ## _reg (COMMON_ARGS, int32 reg, int32 offset_field,	\
+		       int32 width_field)				\
+{									\
+  int32 offset, width;							\
+									\
+  if (!bf_static_field (offset_field, width_field, &offset, &width))	\
+    return 1;								\
+									\
+  if (cc_to_compute)							\
+    i386_movl_reg_reg (c, codep, cc_spill_if_changed, M68K_CC_NONE,	\
+		       scratch_reg, reg, scratch_reg);			\
+  i386_ ## op ## l_imm_reg (c, codep, cc_spill_if_changed, M68K_CC_NONE, \
+			    scratch_reg, mask, reg);			\
+  if (cc_to_compute)							\
+    bf_test_reg_copy (COMMON_ARG_NAMES, scratch_reg, offset, width);	\
+  return 0;								\
+}
+
+HOST_BF_CHANGE_REG (bfchg, xor,  bf_reg_mask (offset, width))
+HOST_BF_CHANGE_REG (bfset, or,   bf_reg_mask (offset, width))
+HOST_BF_CHANGE_REG (bfclr, and, ~bf_reg_mask (offset, width))
+
+
+/* bfextu and bfexts rotate the field to the top of a copy of SRC and
+ * shift it down into DST.
+ */
+#define HOST_BFEXT_REG(name, shift)					      \
+int									      \
+host_ ## name ## _reg_reg (COMMON_ARGS, int32 src, int32 dst,		      \
+			   int32 offset_field, int32 width_field)	      \
+{									      \
+  int32 offset, width;							      \
+									      \
+  if (!bf_static_field (offset_field, width_field, &offset, &width))	      \
+    return 1;								      \
+									      \
+  i386_movl_reg_reg (c, codep, cc_spill_if_changed, M68K_CC_NONE,	      \
+		     scratch_reg, src, scratch_reg);			      \
+  if (offset != 0)							      \
+    i386_roll_imm_reg (c, codep, cc_spill_if_changed, M68K_CC_NONE,	      \
+		       scratch_reg, offset, scratch_reg);		      \
+  i386_movl_reg_reg (c, codep, cc_spill_if_changed, M68K_CC_NONE,	      \
+		     scratch_reg, scratch_reg, dst);			      \
+  if (width != 32)							      \
+    i386_ ## shift ## l_imm_reg (c, codep, cc_spill_if_changed,	      \
+				 M68K_CC_NONE, scratch_reg, 32 - width, dst); \
+  if (cc_to_compute)							      \
+    bf_test_reg_copy (COMMON_ARG_NAMES, scratch_reg, 0, width);	      \
+  return 0;								      \
+}
+
+HOST_BFEXT_REG (bfextu, shr)
+HOST_BFEXT_REG (bfexts, sar)
+
+
+int
+host_bfins_reg_reg (COMMON_ARGS, int32 src, int32 dst, int32 offset_field,
+		    int32 width_field)
+{
+  int32 offset, width;
+
+  if (!bf_static_field (offset_field, width_field, &offset, &width))
+    return 1;
+
+  /* Line the low WIDTH bits of src up with the field, with zeros
+   * everywhere else, then merge them into dst.
+   */
+  i386_movl_reg_reg (c, codep, cc_spill_if_changed, M68K_CC_NONE,
+		     scratch_reg, src, scratch_reg);
+  if (width != 32)
+    i386_shll_imm_reg (c, codep, cc_spill_if_changed, M68K_CC_NONE,
+		       scratch_reg, 32 - width, scratch_reg);
+  if (offset != 0)
+    i386_rorl_imm_reg (c, codep, cc_spill_if_changed, M68K_CC_NONE,
+		       scratch_reg, offset, scratch_reg);
+  i386_andl_imm_reg (c, codep, cc_spill_if_changed, M68K_CC_NONE,
+		     scratch_reg, ~bf_reg_mask (offset, width), dst);
+  i386_orl_reg_reg (c, codep, cc_spill_if_changed, M68K_CC_NONE,
+		    scratch_reg, scratch_reg, dst);
+
+  if (cc_to_compute)
+    bf_test_reg_copy (COMMON_ARG_NAMES, scratch_reg, offset, 32);
+  return 0;
+}
+
+
+int
+host_bfffo_reg_reg (COMMON_ARGS, int32 src, int32 dst, int32 offset_field,
+		    int32 width_field)
+{
+  host_code_t *br_end;
+  int32 offset, width;
+
+  if (!bf_static_field (offset_field, width_field, &offset, &width))
+    return 1;
+
+  /* Isolate the field at the top of scratch_reg. */
+  i386_movl_reg_reg (c, codep, cc_spill_if_changed, M68K_CC_NONE,
+		     scratch_reg, src, scratch_reg);
+  if (offset != 0)
+    i386_roll_imm_reg (c, codep, cc_spill_if_changed, M68K_CC_NONE,
+		       scratch_reg, offset, scratch_reg);
+  if (width == 32)
+    i386_testl_reg_reg (c, codep, cc_spill_if_changed, M68K_CC_NONE,
+			scratch_reg, scratch_reg, scratch_reg);
+  else
+    i386_andl_imm_reg (c, codep, cc_spill_if_changed, M68K_CC_NONE,
+		       scratch_reg, bf_top_mask (width), scratch_reg);
+
+  /* If the field is empty the answer is offset + width; otherwise it's
+   * offset plus the number of leading zeros, 31 - bsr.
+   */
+  i386_movl_imm_reg (c, codep, cc_spill_if_changed, M68K_CC_NONE,
+		     scratch_reg, offset + width, dst);
+  i386_jz (c, codep, cc_spill_if_changed, M68K_CC_NONE, scratch_reg, 5);
+  br_end = *codep;
+  i386_bsrl_reg_reg (c, codep, cc_spill_if_changed, M68K_CC_NONE,
+		     scratch_reg, scratch_reg, dst);
+  i386_negl_reg (c, codep, cc_spill_if_changed, M68K_CC_NONE,
+		 scratch_reg, dst);
+  i386_addl_imm_reg (c, codep, cc_spill_if_changed, M68K_CC_NONE,
+		     scratch_reg, offset + 31, dst);
+  br_end[-1] = *codep - br_end;
+
+  if (cc_to_compute)
+    i386_testl_reg_reg (COMMON_ARG_NAMES, scratch_reg, scratch_reg);
+  return 0;
+}
+
+
 int
 host_negb_abs (COMMON_ARGS, int32 dst_addr)
 {
@@ -606,6 +606,27 @@ extern int host_divsw (COMMON_ARGS, uint16 *m68k_addr, uint16 *next_addr,
 		       Block *b, int32 might_overflow_i386_p);
 extern int host_divsw_imm_reg (COMMON_ARGS, int32 val);
 
+extern int host_mull_reg_reg (COMMON_ARGS, int32 src, int32 dst, int32 kind);
+extern int host_mulul_reg_reg (COMMON_ARGS, int32 src, int32 dst,
+			       int32 kind);
+
+extern int host_bftst_reg (COMMON_ARGS, int32 reg, int32 offset_field,
+			   int32 width_field);
+extern int host_bfchg_reg (COMMON_ARGS, int32 reg, int32 offset_field,
+			   int32 width_field);
+extern int host_bfset_reg (COMMON_ARGS, int32 reg, int32 offset_field,
+			   int32 width_field);
+extern int host_bfclr_reg (COMMON_ARGS, int32 reg, int32 offset_field,
+			   int32 width_field);
+extern int host_bfextu_reg_reg (COMMON_ARGS, int32 src, int32 dst,
+				int32 offset_field, int32 width_field);
+extern int host_bfexts_reg_reg (COMMON_ARGS, int32 src, int32 dst,
+				int32 offset_field, int32 width_field);
+extern int host_bfins_reg_reg (COMMON_ARGS, int32 src, int32 dst,
+			       int32 offset_field, int32 width_field);
+extern int host_bfffo_reg_reg (COMMON_ARGS, int32 src, int32 dst,
+			       int32 offset_field, int32 width_field);
+
 extern int host_andb_reg_abs (COMMON_ARGS, int32 src, int32 dst_addr);
 extern int host_andw_reg_abs (COMMON_ARGS, int32 src, int32 dst_addr);
 extern int host_andl_reg_abs (COMMON_ARGS, int32 src, int32 dst_addr);
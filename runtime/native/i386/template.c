@@ -625,6 +625,12 @@ const template_t template[] =
       { "dst_reg" },
       { { SIZE_32, REGISTER, INOUT } } },
 
+  /* The destination is undefined if the source is zero. */
+  { "i386_bsrl_reg_reg", "", "acopsz", "", "", "-",
+      "bsrl %0,%1",
+      { "src", "dst" },
+      { { SIZE_32, REGISTER, IN }, { SIZE_32, REGISTER, OUT } } },
+
   { "i386_call_abs", "", "", "", "volatile", "v",
       "call L%P0",
       { "addr" },
@@ -1412,6 +1418,10 @@ const template_t template[] =
       "imull %0,%1",
       { "src", "dst" },
       { { SIZE_32, REGISTER, IN }, { SIZE_32, REGISTER, INOUT } } },
+  { "i386_mull", "", "acopsz", "(reg32 EAX)", "(reg32 EAX EDX)", "-",
+      "mull %0",  /* EAX * src -> EDX:EAX */
+      { "src" },
+      { { SIZE_32, REGISTER, IN } } },
 
   { "i386_popw", "", "", "(reg32 ESP) memory", "(reg32 ESP)", "u",
       "popw %0",
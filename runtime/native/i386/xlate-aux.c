@@ -1694,4 +1694,101 @@ const guest_code_descriptor_t xlate_addxl_reg_reg_1_0 =
 };
 
 
+static const guest_code_descriptor_t xlate_mull_reg_reg_0_1_V =
+{
+  {
+    { TRUE, FALSE, 0, MAP_NATIVE_MASK, REQUEST_REG, ROS_UNTOUCHED,
+	REGSET_BYTE & ~((1L << REG_EAX) | (1L << REG_EDX)) },
+    { TRUE, FALSE, 1, MAP_NATIVE_MASK, REQUEST_REG, ROS_NATIVE_DIRTY,
+	REGSET_BYTE & ~((1L << REG_EAX) | (1L << REG_EDX)) },
+    { FALSE },
+  },
+  M68K_CC_NONE, M68K_CC_CNVZ, 1L << REG_EAX,
+  {
+    { host_mulul_reg_reg, {{ 0, 1, 2 }} },
+  },
+  NULL
+};
+
+
+const guest_code_descriptor_t xlate_mull_reg_reg_0_1 =
+{
+  {
+    { TRUE, FALSE, 0, MAP_NATIVE_MASK, REQUEST_REG, ROS_UNTOUCHED,
+	REGSET_BYTE },
+    { TRUE, FALSE, 1, MAP_NATIVE_MASK, REQUEST_REG, ROS_NATIVE_DIRTY,
+	REGSET_BYTE },
+    { FALSE },
+  },
+  M68K_CC_NONE, M68K_CC_CNVZ, 0,
+  {
+    { host_mull_reg_reg, {{ 0, 1, 2 }} },
+  },
+  &xlate_mull_reg_reg_0_1_V
+};
+
+
+const guest_code_descriptor_t xlate_bftst_reg_0 =
+{
+  {
+    { TRUE, FALSE, 0, MAP_NATIVE_MASK, REQUEST_REG, ROS_UNTOUCHED,
+	REGSET_BYTE },
+    { FALSE },
+  },
+  M68K_CC_NONE, M68K_CC_CNVZ, REGSET_ALL,
+  {
+    { host_bftst_reg, {{ 0, 1, 2 }} },
+  },
+  NULL
+};
+
+
+#define BF_CHANGE_REG(name)					\
+const guest_code_descriptor_t xlate_ ## name ## _reg_0 =	\
+{								\
+  {								\
+    { TRUE, FALSE, 0, MAP_NATIVE_MASK, REQUEST_REG,		\
+	ROS_NATIVE_DIRTY, REGSET_BYTE },			\
+    { FALSE },							\
+  },								\
+  M68K_CC_NONE, M68K_CC_CNVZ, REGSET_ALL,			\
+  {								\
+    { host_ ## name ## _reg, {{ 0, 1, 2 }} },			\
+  },								\
+  NULL								\
+};
+
+BF_CHANGE_REG (bfchg)
+BF_CHANGE_REG (bfset)
+BF_CHANGE_REG (bfclr)
+
+
+/* Bit field instructions whose extension word names a second data
+ * register: SRC and DST are the operand numbers of the source and
+ * destination registers, and DST_REQUEST says whether the old value
+ * of the destination matters.
+ */
+#define BF_REG_REG(name, src, dst, dst_request)				\
+const guest_code_descriptor_t xlate_ ## name ## _reg_reg_ ## src ## _ ## dst = \
+{									\
+  {									\
+    { TRUE, FALSE, src, MAP_NATIVE_MASK, REQUEST_REG, ROS_UNTOUCHED,	\
+	REGSET_BYTE },							\
+    { TRUE, FALSE, dst, MAP_NATIVE_MASK, dst_request, ROS_NATIVE_DIRTY,	\
+	REGSET_BYTE },							\
+    { FALSE },								\
+  },									\
+  M68K_CC_NONE, M68K_CC_CNVZ, REGSET_ALL,				\
+  {									\
+    { host_ ## name ## _reg_reg, {{ src, dst, 2, 3 }} },		\
+  },									\
+  NULL									\
+};
+
+BF_REG_REG (bfextu, 0, 1, REQUEST_SPARE_REG)
+BF_REG_REG (bfexts, 0, 1, REQUEST_SPARE_REG)
+BF_REG_REG (bfffo,  0, 1, REQUEST_SPARE_REG)
+BF_REG_REG (bfins,  1, 0, REQUEST_REG)
+
+
 #endif  /* GENERATE_NATIVE_CODE */
@@ -133,6 +133,17 @@ extern const guest_code_descriptor_t xlate_addxb_reg_reg_1_0;
 extern const guest_code_descriptor_t xlate_addxw_reg_reg_1_0;
 extern const guest_code_descriptor_t xlate_addxl_reg_reg_1_0;
 
+extern const guest_code_descriptor_t xlate_mull_reg_reg_0_1;
+
+extern const guest_code_descriptor_t xlate_bftst_reg_0;
+extern const guest_code_descriptor_t xlate_bfchg_reg_0;
+extern const guest_code_descriptor_t xlate_bfset_reg_0;
+extern const guest_code_descriptor_t xlate_bfclr_reg_0;
+extern const guest_code_descriptor_t xlate_bfextu_reg_reg_0_1;
+extern const guest_code_descriptor_t xlate_bfexts_reg_reg_0_1;
+extern const guest_code_descriptor_t xlate_bfins_reg_reg_1_0;
+extern const guest_code_descriptor_t xlate_bfffo_reg_reg_0_1;
+
 #endif  /* GENERATE_NATIVE_CODE */
 
 #endif  /* !_xlate_aux_h_ */
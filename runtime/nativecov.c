@@ -0,0 +1,214 @@
+/*
+ * nativecov.c - Native code coverage statistics; see nativecov.h.
+ *
+ *   For each 68k opcode word we count how often it was compiled to
+ *   native code, how often it fell back to synthetic code because it
+ *   has no native template, and how often because its template turned
+ *   down the operands.  At run time, every native->synthetic transition
+ *   is charged to the opcode that forced it, and both directions are
+ *   counted per block.  The report ranks the opcodes that fall back by
+ *   how many transitions they caused, which is roughly what adding a
+ *   native template for them would save.
+ */
+
+#include "syn68k_private.h"
+#include "nativecov.h"
+#include "block.h"
+#include "mapping.h"
+#include "deathqueue.h"
+#include "destroyblock.h"
+#include "alloc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+BOOL native_coverage_p = FALSE;
+
+#ifdef GENERATE_NATIVE_CODE
+
+typedef struct
+{
+  uint32 emitted[NUM_NATIVE_COVERAGE_KINDS];
+  uint32 fallbacks;      /* Native->synthetic transitions it caused. */
+} native_coverage_t;
+
+#define MAX_COVERAGE_BLOCKS 50
+
+static native_coverage_t *coverage;
+
+
+void
+native_coverage_note (uint16 m68kop, native_coverage_kind_t kind)
+{
+  ++coverage[m68kop].emitted[kind];
+}
+
+
+/* Returns the counter the 0xB9 opcode at a native->synthetic transition
+ * forced by M68KOP should bump.
+ */
+uint32 *
+native_coverage_fallback_counter (uint16 m68kop)
+{
+  return &coverage[m68kop].fallbacks;
+}
+
+
+static uint32
+num_synthetic (const native_coverage_t *c)
+{
+  return (c->emitted[NATIVE_COVERAGE_NO_TEMPLATE]
+	  + c->emitted[NATIVE_COVERAGE_REJECTED]);
+}
+
+
+/* Sorts opcode words by fallbacks, then by synthetic translations,
+ * most first.
+ */
+static int
+compare_opcodes (const void *p1, const void *p2)
+{
+  const native_coverage_t *c1 = &coverage[*(const uint16 *) p1];
+  const native_coverage_t *c2 = &coverage[*(const uint16 *) p2];
+
+  if (c1->fallbacks != c2->fallbacks)
+    return (c1->fallbacks > c2->fallbacks) ? -1 : 1;
+  if (num_synthetic (c1) != num_synthetic (c2))
+    return (num_synthetic (c1) > num_synthetic (c2)) ? -1 : 1;
+  return (*(const uint16 *) p1 > *(const uint16 *) p2) ? 1 : -1;
+}
+
+
+static uint32
+num_transitions (const Block *b)
+{
+  return BLOCK_COLD (b)->ntos_transitions + BLOCK_COLD (b)->ston_transitions;
+}
+
+
+static int
+compare_blocks (const void *p1, const void *p2)
+{
+  const Block *b1 = *(const Block * const *) p1;
+  const Block *b2 = *(const Block * const *) p2;
+
+  if (num_transitions (b1) != num_transitions (b2))
+    return (num_transitions (b1) > num_transitions (b2)) ? -1 : 1;
+  return (b1->m68k_start_address < b2->m68k_start_address) ? -1 : 1;
+}
+
+#endif  /* GENERATE_NATIVE_CODE */
+
+
+/* Starts gathering native coverage statistics, discarding any gathered
+ * so far.  All translated code is thrown away so that it gets
+ * retranslated with the transition counters in place, so don't call
+ * this from inside a callback.  Returns 0 on success, or -1 if this
+ * build doesn't generate native code.
+ */
+int
+syn68k_native_coverage_start (void)
+{
+#ifdef GENERATE_NATIVE_CODE
+  if (coverage == NULL)
+    coverage = (native_coverage_t *) xmalloc (65536 * sizeof coverage[0]);
+  memset (coverage, 0, 65536 * sizeof coverage[0]);
+
+  native_coverage_p = TRUE;
+  destroy_all_blocks ();
+  return 0;
+#else  /* !GENERATE_NATIVE_CODE */
+  return -1;
+#endif  /* !GENERATE_NATIVE_CODE */
+}
+
+
+/* Stops noting how code is translated.  Blocks translated while it was
+ * on go on counting transitions until they are retranslated.
+ */
+void
+syn68k_native_coverage_stop (void)
+{
+  native_coverage_p = FALSE;
+}
+
+
+/* Writes the statistics gathered so far to FP: totals, then every 68k
+ * opcode word that was ever compiled to synthetic code, ranked by the
+ * native->synthetic transitions it caused, then the blocks with the
+ * most transitions.  The "map" column is the opcode's index into
+ * opcode_map_info, whose entries are named in the generated mapinfo.c.
+ * Returns 0 on success, -1 on failure.
+ */
+int
+syn68k_native_coverage_write (FILE *fp)
+{
+#ifdef GENERATE_NATIVE_CODE
+  uint64 totals[NUM_NATIVE_COVERAGE_KINDS], total_fallbacks;
+  uint16 *ops;
+  Block **blocks, *b;
+  unsigned long i, j, num_ops, num_blocks;
+
+  if (coverage == NULL)
+    return -1;
+
+  memset (totals, 0, sizeof totals);
+  total_fallbacks = 0;
+  ops = (uint16 *) xmalloc (65536 * sizeof ops[0]);
+  for (i = num_ops = 0; i < 65536; i++)
+    {
+      const native_coverage_t *c = &coverage[i];
+      for (j = 0; j < NUM_NATIVE_COVERAGE_KINDS; j++)
+	totals[j] += c->emitted[j];
+      total_fallbacks += c->fallbacks;
+      if (num_synthetic (c) != 0 || c->fallbacks != 0)
+	ops[num_ops++] = i;
+    }
+  qsort (ops, num_ops, sizeof ops[0], compare_opcodes);
+
+  fprintf (fp, "# syn68k native coverage\n"
+	   "# %llu native, %llu without template, %llu rejected, "
+	   "%llu fallbacks\n",
+	   (unsigned long long) totals[NATIVE_COVERAGE_NATIVE],
+	   (unsigned long long) totals[NATIVE_COVERAGE_NO_TEMPLATE],
+	   (unsigned long long) totals[NATIVE_COVERAGE_REJECTED],
+	   (unsigned long long) total_fallbacks);
+
+  fputs ("\n# opcode  map     fallbacks  no_template   rejected     native\n",
+	 fp);
+  for (i = 0; i < num_ops; i++)
+    {
+      const native_coverage_t *c = &coverage[ops[i]];
+      fprintf (fp, "0x%04X    0x%04X %10lu %12lu %10lu %10lu\n",
+	       (unsigned) ops[i], (unsigned) opcode_map_index[ops[i]],
+	       (unsigned long) c->fallbacks,
+	       (unsigned long) c->emitted[NATIVE_COVERAGE_NO_TEMPLATE],
+	       (unsigned long) c->emitted[NATIVE_COVERAGE_REJECTED],
+	       (unsigned long) c->emitted[NATIVE_COVERAGE_NATIVE]);
+    }
+  free (ops);
+
+  for (num_blocks = 0, b = death_queue_head; b != NULL;
+       b = BLOCK_FROM_INDEX (b->death_queue_next))
+    num_blocks++;
+  blocks = (Block **) xmalloc ((num_blocks + 1) * sizeof blocks[0]);
+  for (i = 0, b = death_queue_head; b != NULL;
+       b = BLOCK_FROM_INDEX (b->death_queue_next))
+    if (num_transitions (b) != 0)
+      blocks[i++] = b;
+  num_blocks = i;
+  qsort (blocks, num_blocks, sizeof blocks[0], compare_blocks);
+
+  fputs ("\n# block        ntos       ston\n", fp);
+  for (i = 0; i < num_blocks && i < MAX_COVERAGE_BLOCKS; i++)
+    fprintf (fp, "0x%08lX %10lu %10lu\n",
+	     (unsigned long) blocks[i]->m68k_start_address,
+	     (unsigned long) BLOCK_COLD (blocks[i])->ntos_transitions,
+	     (unsigned long) BLOCK_COLD (blocks[i])->ston_transitions);
+  free (blocks);
+
+  return ferror (fp) ? -1 : 0;
+#else  /* !GENERATE_NATIVE_CODE */
+  return -1;
+#endif  /* !GENERATE_NATIVE_CODE */
+}
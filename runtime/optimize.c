@@ -0,0 +1,254 @@
+/*
+ * optimize.c - Routines for retranslating hot regions of code with
+ *              exact cc bit liveness; see optimize.h.
+ *
+ * The analysis works on a small graph built straight from the m68k
+ * code: one node per block, holding the cc bits the block reads
+ * before setting them, the cc bits it may leave alone, and the indices
+ * of its successors in the region.  Liveness is then the least fixed
+ * point of
+ *
+ *     live_in (b) = needed (b) | (live_out (b) & may_not_set (b))
+ *
+ * where live_out (b) is the union of live_in over b's successors,
+ * taking every cc bit as live past a dynamic jump or the edge of the
+ * region.
+ */
+
+#include "syn68k_private.h"
+#include "optimize.h"
+#include "blockinfo.h"
+#include "translate.h"
+#include "destroyblock.h"
+#include "hash.h"
+#include "alloc.h"
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+  syn68k_addr_t addr;
+  uint8 needed, may_not_set, live_in;
+  int8 num_children;
+  int child[2];              /* Index into the region, or -1 if outside. */
+} RegionNode;
+
+/* Sorted by address while a region is being retranslated, else NULL. */
+static RegionNode *cc_hint;
+static unsigned long num_cc_hints;
+
+
+static int
+compare_nodes (const void *p1, const void *p2)
+{
+  syn68k_addr_t a1 = ((const RegionNode *) p1)->addr;
+  syn68k_addr_t a2 = ((const RegionNode *) p2)->addr;
+  return (a1 > a2) - (a1 < a2);
+}
+
+
+static long
+find_node (syn68k_addr_t addr)
+{
+  RegionNode key, *n;
+
+  if (cc_hint == NULL)
+    return -1;
+  key.addr = addr;
+  n = (RegionNode *) bsearch (&key, cc_hint, num_cc_hints, sizeof key,
+			      compare_nodes);
+  return (n == NULL) ? -1 : n - cc_hint;
+}
+
+
+/* Returns the cc bits generate_block should assume the block at ADDR
+ * needs while it is still being translated, or -1 if we don't know.
+ */
+int
+optimize_cc_hint (syn68k_addr_t addr)
+{
+  long i = find_node (addr);
+  return (i < 0) ? -1 : cc_hint[i].live_in;
+}
+
+
+/* Computes exact cc bit liveness for the NUM_ADDRS blocks whose m68k
+ * code starts at ADDRS, and makes the results available through
+ * optimize_cc_hint until optimize_discard_cc_hints is called.  ADDRS
+ * is sorted as a side effect.
+ */
+void
+optimize_compute_cc_hints (syn68k_addr_t *addrs, unsigned long num_addrs)
+{
+  unsigned long i;
+  BOOL changed;
+  int j;
+
+  optimize_discard_cc_hints ();
+  cc_hint = (RegionNode *) xmalloc ((num_addrs + 1) * sizeof cc_hint[0]);
+  num_cc_hints = num_addrs;
+
+  for (i = 0; i < num_addrs; i++)
+    cc_hint[i].addr = addrs[i];
+  qsort (cc_hint, num_addrs, sizeof cc_hint[0], compare_nodes);
+  for (i = 0; i < num_addrs; i++)
+    addrs[i] = cc_hint[i].addr;
+
+  /* Build the graph. */
+  for (i = 0; i < num_addrs; i++)
+    {
+      RegionNode *n = &cc_hint[i];
+      TempBlockInfo tbi;
+      Block scratch;
+
+      memset (&scratch, 0, sizeof scratch);
+      compute_block_info (&scratch, SYN68K_TO_US (n->addr), &tbi);
+      free (tbi.next_instr_offset);
+
+      n->needed = scratch.cc_needed;
+      n->may_not_set = scratch.cc_may_not_set;
+      n->live_in = 0;
+      n->num_children = tbi.num_child_blocks;
+      for (j = 0; j < n->num_children; j++)
+	n->child[j] = find_node (tbi.child[j]);
+    }
+
+  /* Iterate to the least fixed point.  Everything only grows, so this
+   * terminates after at most five passes per node.
+   */
+  do
+    {
+      changed = FALSE;
+      for (i = num_addrs; i-- > 0; )
+	{
+	  RegionNode *n = &cc_hint[i];
+	  int live_out, live_in;
+
+	  if (n->num_children == 0)
+	    live_out = ALL_CCS;
+	  else
+	    for (j = 0, live_out = 0; j < n->num_children; j++)
+	      live_out |= ((n->child[j] < 0)
+			   ? ALL_CCS : cc_hint[n->child[j]].live_in);
+
+	  live_in = n->needed | (live_out & n->may_not_set);
+	  if (live_in != n->live_in)
+	    {
+	      n->live_in = live_in;
+	      changed = TRUE;
+	    }
+	}
+    }
+  while (changed);
+}
+
+
+void
+optimize_discard_cc_hints (void)
+{
+  free (cc_hint);
+  cc_hint = NULL;
+  num_cc_hints = 0;
+}
+
+
+/* Appends to *ADDRS the start addresses of B and of the blocks
+ * reachable from it through child links, stopping at
+ * MAX_OPTIMIZE_REGION_BLOCKS.  Visited blocks are left with
+ * recursive_mark set.
+ */
+static void
+collect_region (Block *b, syn68k_addr_t *addrs, unsigned long *num_addrs)
+{
+  while (b != NULL && !b->recursive_mark && !b->immortal
+	 && *num_addrs < MAX_OPTIMIZE_REGION_BLOCKS)
+    {
+      b->recursive_mark = TRUE;
+      addrs[(*num_addrs)++] = b->m68k_start_address;
+      if (b->num_children > 1)
+	collect_region (b->child[1], addrs, num_addrs);
+      b = (b->num_children > 0) ? b->child[0] : NULL;
+    }
+}
+
+
+/* Appends to *ADDRS the start addresses of all unmarked ancestors of
+ * B, marking them, since destroying B destroys them too.
+ */
+static void
+collect_ancestors (Block *b, syn68k_addr_t **addrs, unsigned long *num_addrs,
+		   unsigned long *max_addrs)
+{
+  int i;
+
+  for (i = b->num_parents - 1; i >= 0; i--)
+    {
+      Block *p = b->parent[i];
+      if (p->recursive_mark || p->immortal)
+	continue;
+      p->recursive_mark = TRUE;
+      if (*num_addrs >= *max_addrs)
+	{
+	  *max_addrs *= 2;
+	  *addrs = (syn68k_addr_t *) xrealloc (*addrs, (*max_addrs
+							* sizeof (*addrs)[0]));
+	}
+      (*addrs)[(*num_addrs)++] = p->m68k_start_address;
+      collect_ancestors (p, addrs, num_addrs, max_addrs);
+    }
+}
+
+
+/* Retranslates the region of code reachable from the hot block B with
+ * exact cc bit liveness.  B and everything that links to code in the
+ * region are destroyed, so the caller must look B's code up again.
+ */
+void
+optimize_hot_region (Block *b)
+{
+  syn68k_addr_t *addrs;
+  unsigned long num_region, num_addrs, max_addrs, i;
+  int old_sigmask;
+
+  BLOCK_INTERRUPTS (old_sigmask);
+  TRACE_BEGIN (TRACE_OPTIMIZE, b->m68k_start_address, 0);
+
+  max_addrs = 2 * MAX_OPTIMIZE_REGION_BLOCKS;
+  addrs = (syn68k_addr_t *) xmalloc (max_addrs * sizeof addrs[0]);
+  num_region = 0;
+  collect_region (b, addrs, &num_region);
+  num_addrs = num_region;
+  for (i = 0; i < num_region; i++)
+    collect_ancestors (hash_lookup (addrs[i]), &addrs, &num_addrs,
+		       &max_addrs);
+
+  for (i = 0; i < num_addrs; i++)
+    hash_lookup (addrs[i])->recursive_mark = FALSE;
+
+  /* Only the region itself gets hints; its ancestors are translated
+   * the usual way.
+   */
+  optimize_compute_cc_hints (addrs, num_region);
+
+  for (i = num_addrs; i-- > 0; )
+    {
+      /* Earlier destroys may have taken this one with them. */
+      Block *old = hash_lookup (addrs[i]);
+      if (old != NULL)
+	destroy_block (old);
+    }
+
+  for (i = 0; i < num_addrs; i++)
+    {
+      Block *junk;
+      generate_block (NULL, addrs[i], &junk, FALSE);
+    }
+
+  optimize_discard_cc_hints ();
+  free (addrs);
+
+  /* Smash the jsr stack, since it may point into code we freed. */
+  memset (&cpu_state.jsr_stack, -1, sizeof cpu_state.jsr_stack);
+
+  TRACE_END (TRACE_OPTIMIZE, num_addrs, 0);
+  RESTORE_INTERRUPTS (old_sigmask);
+}
@@ -0,0 +1,320 @@
+/*
+ * pagedir.c - Routines for maintaining a directory that maps each 68k
+ *             page to the Blocks whose code overlaps it.  The hash table
+ *             in hash.c finds a block by its starting address; this finds
+ *             every block touching an arbitrary range of addresses, which
+ *             is what invalidating self-modified code needs.
+ *
+ *   Each page keeps a small unordered array of block indices.  A block
+ *   spanning several pages appears in each of them, so queries report a
+ *   block only from the first page where it meets the queried range.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "pagedir.h"
+#include "alloc.h"
+
+typedef struct {
+  block_index_t *block;     /* Blocks overlapping this page, unordered. */
+  uint32 num_blocks;
+  uint32 max_blocks;
+} PageEntry;
+
+static PageEntry *page_dir[PAGE_DIR_ROOT_ENTRIES];
+
+#ifndef MAX
+#define MAX(a,b) ((a) > (b) ? (a) : (b))
+#endif
+
+
+/* Returns the address of the last byte of B's 68k code.  Artificial
+ * blocks may claim zero bytes; they still occupy their first page.
+ */
+static syn68k_addr_t
+block_last_address (const Block *b)
+{
+  uint32 len = MAX (b->m68k_code_length, 1);
+
+  if (b->m68k_start_address + (len - 1) < b->m68k_start_address)
+    return (syn68k_addr_t) ~0;
+  return b->m68k_start_address + (len - 1);
+}
+
+
+/* Returns the entry for the given page, or NULL if no block has ever
+ * touched its leaf table.
+ */
+static inline PageEntry *
+page_entry (uint32 page)
+{
+  PageEntry *leaf = page_dir[page >> LOG_PAGE_DIR_LEAF_PAGES];
+  return (leaf == NULL) ? NULL : &leaf[page & (PAGE_DIR_LEAF_PAGES - 1)];
+}
+
+
+/* Initializes the page directory.  Call this before calling any other
+ * page directory functions, and call it exactly once.
+ */
+void
+page_dir_init ()
+{
+  memset (page_dir, 0, sizeof page_dir);
+}
+
+
+/* Frees all memory associated with the page directory. */
+void
+page_dir_destroy ()
+{
+  unsigned long i, j;
+
+  for (i = 0; i < PAGE_DIR_ROOT_ENTRIES; i++)
+    if (page_dir[i] != NULL)
+      {
+	for (j = 0; j < PAGE_DIR_LEAF_PAGES; j++)
+	  free (page_dir[i][j].block);
+	free (page_dir[i]);
+	page_dir[i] = NULL;
+      }
+}
+
+
+/* Records B in every page its 68k code overlaps.  Inserting a block twice
+ * is illegal but is not checked for.
+ */
+void
+page_dir_insert (Block *b)
+{
+  uint32 page, last_page;
+
+  last_page = PAGE_DIR_PAGE (block_last_address (b));
+  for (page = PAGE_DIR_PAGE (b->m68k_start_address); ; page++)
+    {
+      PageEntry *p;
+      unsigned long root = page >> LOG_PAGE_DIR_LEAF_PAGES;
+
+      if (page_dir[root] == NULL)
+	{
+	  PageEntry *leaf = (PageEntry *) xcalloc (PAGE_DIR_LEAF_PAGES,
+						   sizeof *leaf);
+	  if (page_dir[root] == NULL)
+	    page_dir[root] = leaf;
+	  else
+	    free (leaf);
+	}
+      p = &page_dir[root][page & (PAGE_DIR_LEAF_PAGES - 1)];
+
+      if (p->num_blocks == p->max_blocks)
+	{
+	  uint32 new_max = MAX (p->max_blocks * 2, 4);
+	  block_index_t *n;
+
+	  /* xmalloc may reclaim blocks, which only ever shrinks this
+	   * page's list, so copy whatever is left afterwards.
+	   */
+	  n = (block_index_t *) xmalloc (new_max * sizeof n[0]);
+	  memcpy (n, p->block, p->num_blocks * sizeof n[0]);
+	  free (p->block);
+	  p->block = n;
+	  p->max_blocks = new_max;
+	}
+      p->block[p->num_blocks++] = b->index;
+
+      if (page == last_page)
+	break;
+    }
+}
+
+
+/* Removes B from every page its 68k code overlaps.  Pages that don't
+ * list B are left alone.
+ */
+void
+page_dir_remove (Block *b)
+{
+  uint32 page, last_page;
+
+  last_page = PAGE_DIR_PAGE (block_last_address (b));
+  for (page = PAGE_DIR_PAGE (b->m68k_start_address); ; page++)
+    {
+      PageEntry *p = page_entry (page);
+
+      if (p != NULL)
+	{
+	  uint32 i;
+
+	  for (i = 0; i < p->num_blocks; i++)
+	    if (p->block[i] == b->index)
+	      {
+		p->block[i] = p->block[--p->num_blocks];
+		break;
+	      }
+
+	  if (p->num_blocks == 0)
+	    {
+	      free (p->block);
+	      p->block = NULL;
+	      p->max_blocks = 0;
+	    }
+	}
+
+      if (page == last_page)
+	break;
+    }
+}
+
+
+/* Given a 68k address, this attempts to locate some Block that contains
+ * it.  No guarantees are made about which such Block will be returned if
+ * there is more than one which intersects the specified address.  If such
+ * a Block is found that Block is returned, else NULL.
+ */
+Block *
+page_dir_lookup (syn68k_addr_t addr)
+{
+  PageEntry *p = page_entry (PAGE_DIR_PAGE (addr));
+  uint32 i;
+
+  if (p != NULL)
+    for (i = 0; i < p->num_blocks; i++)
+      {
+	Block *b = BLOCK_FROM_INDEX (p->block[i]);
+	if (addr >= b->m68k_start_address && addr <= block_last_address (b))
+	  return b;
+      }
+
+  return NULL;
+}
+
+
+static int
+compare_addrs (const void *p1, const void *p2)
+{
+  syn68k_addr_t a1 = *(const syn68k_addr_t *) p1;
+  syn68k_addr_t a2 = *(const syn68k_addr_t *) p2;
+
+  return (a1 < a2) ? -1 : (a1 > a2);
+}
+
+
+/* Finds every Block whose 68k code intersects [low, high] and stores
+ * their starting addresses in a freshly xmalloc'd array, sorted in
+ * increasing order, in *ADDRS.  Returns the number found; *ADDRS is NULL
+ * if there were none.  Addresses rather than Blocks are returned so the
+ * caller can destroy blocks (and their parents) as it goes and simply
+ * hash_lookup each address again to see whether it is still around.
+ */
+unsigned long
+page_dir_find_intersecting (syn68k_addr_t low, syn68k_addr_t high,
+			    syn68k_addr_t **addrs)
+{
+  syn68k_addr_t *result;
+  unsigned long num, max;
+  uint32 page, first_page, last_page;
+
+  result = NULL;
+  num = max = 0;
+  first_page = PAGE_DIR_PAGE (low);
+  last_page = PAGE_DIR_PAGE (high);
+
+  for (page = first_page; ; page++)
+    {
+      PageEntry *p;
+      uint32 i;
+
+      /* Skip whole leaf tables no block has ever touched. */
+      if (page_dir[page >> LOG_PAGE_DIR_LEAF_PAGES] == NULL)
+	{
+	  uint32 leaf_last = page | (PAGE_DIR_LEAF_PAGES - 1);
+	  if (leaf_last >= last_page)
+	    break;
+	  page = leaf_last;
+	  continue;
+	}
+
+      p = page_entry (page);
+      for (i = 0; i < p->num_blocks; i++)
+	{
+	  Block *b = BLOCK_FROM_INDEX (p->block[i]);
+	  syn68k_addr_t l = b->m68k_start_address;
+	  syn68k_addr_t h = block_last_address (b);
+
+	  /* Report each block only from the first page it shares with
+	   * the range, so blocks spanning pages aren't listed twice.
+	   */
+	  if (l <= high && h >= low
+	      && PAGE_DIR_PAGE (MAX (l, low)) == page)
+	    {
+	      if (num == max)
+		{
+		  max = MAX (max * 2, 16);
+		  result = (syn68k_addr_t *) xrealloc (result,
+						       max * sizeof result[0]);
+		}
+	      result[num++] = l;
+	    }
+	}
+
+      if (page == last_page)
+	break;
+    }
+
+  if (num > 1)
+    qsort (result, num, sizeof result[0], compare_addrs);
+
+  *addrs = result;
+  return num;
+}
+
+
+#ifdef DEBUG
+/* Checks the page directory for consistency.  Returns YES if everything
+ * is OK, NO if something is bad (in which case it prints out appropriate
+ * errors to stderr.)
+ */
+BOOL
+page_dir_verify ()
+{
+  BOOL ok = YES;
+  unsigned long i, j;
+  uint32 k, m;
+
+  for (i = 0; i < PAGE_DIR_ROOT_ENTRIES; i++)
+    if (page_dir[i] != NULL)
+      for (j = 0; j < PAGE_DIR_LEAF_PAGES; j++)
+	{
+	  const PageEntry *p = &page_dir[i][j];
+	  uint32 page = (i << LOG_PAGE_DIR_LEAF_PAGES) | j;
+
+	  for (k = 0; k < p->num_blocks; k++)
+	    {
+	      Block *b = BLOCK_FROM_INDEX (p->block[k]);
+
+	      if (PAGE_DIR_PAGE (b->m68k_start_address) > page
+		  || PAGE_DIR_PAGE (block_last_address (b)) < page)
+		{
+		  fprintf (stderr, "Internal inconsistency: Block 0x%lX is "
+			   "listed in page 0x%lX, which it doesn't "
+			   "overlap.\n",
+			   (unsigned long) b->m68k_start_address,
+			   (unsigned long) page);
+		  ok = NO;
+		}
+
+	      for (m = k + 1; m < p->num_blocks; m++)
+		if (p->block[m] == p->block[k])
+		  {
+		    fprintf (stderr, "Internal inconsistency: Block 0x%lX "
+			     "is listed twice in page 0x%lX.\n",
+			     (unsigned long) b->m68k_start_address,
+			     (unsigned long) page);
+		    ok = NO;
+		  }
+	    }
+	}
+
+  return ok;
+}
+#endif
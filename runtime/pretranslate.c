@@ -0,0 +1,230 @@
+/*
+ * pretranslate.c - Routines for translating freshly loaded m68k code
+ *                  before it is first executed.
+ *
+ * Blocks are normally created the first time they are hit, which puts
+ * translation latency in the middle of whatever the guest is doing.
+ * These routines sweep a range of m68k code linearly looking for entry
+ * points and translate them ahead of time.  generate_block already
+ * follows statically known branches, so the entry points we look for
+ * are the ones it can't see: the start of the range, subroutine
+ * targets, the return points after subroutine calls, and function
+ * prologues right after unconditional transfers of control.
+ *
+ * Only the entry points have to lie inside the range.  generate_block
+ * translates everything reachable from an entry point by static
+ * branches and fall through, wherever that leads, so an entry point
+ * that is really data can still pull in code (or more data) from
+ * outside the range.  That's why the prologue heuristic is strict: it
+ * wants a plausible link or movem, and only where nothing can fall
+ * into it.
+ */
+
+#include "syn68k_private.h"
+#include "block.h"
+#include "hash.h"
+#include "mapping.h"
+#include "blockinfo.h"
+#include "alloc.h"
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+  syn68k_addr_t start, end;  /* The range is [start, end). */
+  syn68k_addr_t next;        /* Address of the next instruction to sweep. */
+  BOOL entry_p;              /* TRUE iff next is known to be an entry. */
+  BOOL after_transfer_p;     /* TRUE iff nothing falls through to next. */
+} PretranslateRange;
+
+/* Queue of ranges waiting to be swept by syn68k_pretranslate_some. */
+static PretranslateRange *pending_range;
+static int num_pending_ranges, max_pending_ranges;
+
+
+/* Translates the code at ADDR if it lies in range R and hasn't been
+ * translated yet.  Returns 1 if we created anything, else 0.
+ */
+static int
+pretranslate_entry (const PretranslateRange *r, syn68k_addr_t addr)
+{
+  if (addr < r->start || addr >= r->end || (addr & 1)
+      || hash_lookup (addr) != NULL)
+    return 0;
+  hash_lookup_code_and_create_if_needed (addr);
+  return 1;
+}
+
+
+/* Returns TRUE iff the instruction M68KOP at PC looks like the start of
+ * a subroutine: link An,#d with a frame of a sane size, or movem.l with
+ * some registers to -(a7).
+ */
+static BOOL
+prologue_p (uint16 m68kop, syn68k_addr_t pc)
+{
+  int32 d;
+
+  if ((m68kop & 0xFFF8) == 0x4E50)
+    {
+      d = READSW (pc + 2);
+      return d <= 0 && !(d & 1);
+    }
+  return m68kop == 0x48E7 && READUW (pc + 2) != 0;
+}
+
+
+/* Returns TRUE iff M68KOP never falls through to the next instruction:
+ * bra, jmp, rts, rtd, rte or rtr.
+ */
+static BOOL
+unconditional_transfer_p (uint16 m68kop)
+{
+  return ((m68kop >> 8) == 0x60 || (m68kop & 0xFFC0) == 0x4EC0
+	  || m68kop == 0x4E75 || m68kop == 0x4E74 || m68kop == 0x4E73
+	  || m68kop == 0x4E77);
+}
+
+
+/* Sweeps range R until it is exhausted, MAX_ENTRIES entry points have
+ * been translated, or MAX_INSTRS instructions have been looked at.
+ * Returns the number of entry points translated.
+ */
+static unsigned long
+pretranslate_sweep (PretranslateRange *r, unsigned long max_entries,
+		    unsigned long max_instrs)
+{
+  unsigned long translated = 0;
+
+  while (r->next < r->end && translated < max_entries && max_instrs-- > 0)
+    {
+      syn68k_addr_t pc = r->next;
+      const OpcodeMappingInfo *map;
+      uint16 m68kop;
+      syn68k_addr_t target;
+      int insn_size;
+
+      m68kop = READUW (pc);
+      map = OPCODE_MAP_INFO (m68kop, SYN68K_TO_US (pc));
+      insn_size = instruction_size (SYN68K_TO_US (pc), map);
+      if (opcode_map_index[m68kop] == 0 || insn_size <= 0)
+	{
+	  /* Not code, or at least not code we understand.  Resync. */
+	  r->next = pc + 2;
+	  r->entry_p = r->after_transfer_p = FALSE;
+	  continue;
+	}
+
+      if (r->entry_p || (r->after_transfer_p && prologue_p (m68kop, pc)))
+	translated += pretranslate_entry (r, pc);
+      r->next = pc + insn_size * sizeof (uint16);
+      r->entry_p = FALSE;
+      r->after_transfer_p = unconditional_transfer_p (m68kop);
+
+      /* Look for subroutine calls with known targets. */
+      target = ~0;
+      if ((m68kop >> 8) == 0x61)		/* bsr */
+	{
+	  if ((m68kop & 0xFF) == 0)
+	    target = pc + 2 + READSW (pc + 2);
+	  else if ((m68kop & 0xFF) == 0xFF)
+	    target = pc + 2 + READSL (pc + 2);
+	  else
+	    target = pc + 2 + (int8) m68kop;
+	}
+      else if (m68kop == 0x4EB8)		/* jsr abs.w */
+	target = READSW (pc + 2);
+      else if (m68kop == 0x4EB9)		/* jsr abs.l */
+	target = READUL (pc + 2);
+      else if (m68kop == 0x4EBA)		/* jsr d16(pc) */
+	target = pc + 2 + READSW (pc + 2);
+
+      if (target != (syn68k_addr_t) ~0
+	  || (m68kop & 0xFFC0) == 0x4E80)	/* Any jsr. */
+	{
+	  if (target != (syn68k_addr_t) ~0)
+	    translated += pretranslate_entry (r, target);
+	  /* The callee will return here. */
+	  r->entry_p = TRUE;
+	}
+    }
+
+  return translated;
+}
+
+
+/* Translates the entry points we can find in the NUM_BYTES of m68k code
+ * starting at ADDR right away.  Returns the number of entry points
+ * translated.
+ */
+unsigned long
+syn68k_pretranslate (syn68k_addr_t addr, uint32 num_bytes)
+{
+  PretranslateRange r;
+
+  r.start = r.next = addr;
+  r.end = addr + num_bytes;
+  r.entry_p = TRUE;
+  r.after_transfer_p = FALSE;
+  return pretranslate_sweep (&r, ~0UL, ~0UL);
+}
+
+
+/* Queues the NUM_BYTES of m68k code starting at ADDR to be translated
+ * bit by bit by syn68k_pretranslate_some.
+ */
+void
+syn68k_pretranslate_later (syn68k_addr_t addr, uint32 num_bytes)
+{
+  PretranslateRange *r;
+
+  if (num_pending_ranges == max_pending_ranges)
+    {
+      max_pending_ranges = max_pending_ranges ? max_pending_ranges * 2 : 8;
+      pending_range = (PretranslateRange *)
+	xrealloc (pending_range, max_pending_ranges * sizeof pending_range[0]);
+    }
+
+  r = &pending_range[num_pending_ranges++];
+  r->start = r->next = addr;
+  r->end = addr + num_bytes;
+  r->entry_p = TRUE;
+  r->after_transfer_p = FALSE;
+}
+
+
+/* Translates at most MAX_ENTRIES entry points from the queued ranges,
+ * oldest first, sweeping no more than PRETRANSLATE_SWEEP_PER_ENTRY
+ * instructions per entry point allowed.  This is meant to be called
+ * from a host idle hook.  Returns nonzero iff there is still work
+ * queued.
+ */
+#define PRETRANSLATE_SWEEP_PER_ENTRY 64
+
+int
+syn68k_pretranslate_some (unsigned long max_entries)
+{
+  unsigned long max_instrs = max_entries * PRETRANSLATE_SWEEP_PER_ENTRY;
+
+  while (num_pending_ranges > 0 && max_entries > 0 && max_instrs > 0)
+    {
+      PretranslateRange *r = &pending_range[0];
+      syn68k_addr_t old_next = r->next;
+      unsigned long words_swept, n;
+
+      /* One instruction can yield two entry points, so we may overshoot. */
+      n = pretranslate_sweep (r, max_entries, max_instrs);
+      max_entries = (n < max_entries) ? max_entries - n : 0;
+
+      /* Charge a word swept as an instruction; close enough. */
+      words_swept = (r->next - old_next) / sizeof (uint16);
+      max_instrs = (words_swept < max_instrs) ? max_instrs - words_swept : 0;
+      if (r->next >= r->end)
+	{
+	  --num_pending_ranges;
+	  memmove (&pending_range[0], &pending_range[1],
+		   num_pending_ranges * sizeof pending_range[0]);
+	}
+    }
+
+  return num_pending_ranges > 0;
+}
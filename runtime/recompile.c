@@ -8,6 +8,7 @@
 #include "hash.h"
 #include "alloc.h"
 #include "native.h"
+#include "optimize.h"
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
@@ -36,6 +37,7 @@ recompile_block_as_native (Block *b)
   BLOCK_INTERRUPTS (old_sigmask);
   
   orig_address = b->m68k_start_address;
+  TRACE_BEGIN (TRACE_RECOMPILE_NATIVE, orig_address, 0);
 
 #if 0
   fprintf (stderr,
@@ -56,9 +58,12 @@ recompile_block_as_native (Block *b)
   assert (num_bad_blocks != 0);
 
   /* Sort the blocks by address.  Hopefully this will require fewer
-   * passes when recompiling below.
+   * passes when recompiling below.  While we're at it, work out which
+   * cc bits they really need, so loops among them don't compute cc
+   * bits nobody reads.
    */
   qsort (bad_blocks, num_bad_blocks, sizeof bad_blocks[0], compare_m68k_addrs);
+  optimize_compute_cc_hints (bad_blocks, num_bad_blocks);
 
 #if 0
   for (n = 0; n < num_bad_blocks; n++)
@@ -85,6 +90,7 @@ recompile_block_as_native (Block *b)
       generate_block (NULL, bad_blocks[n], &junk, TRUE);
     }
 
+  optimize_discard_cc_hints ();
   free (bad_blocks);
 
   /* Smash the jsr stack to be safe. */
@@ -92,6 +98,7 @@ recompile_block_as_native (Block *b)
 
   assert ((b = hash_lookup (orig_address)) && NATIVE_CODE_TRIED (b));
 
+  TRACE_END (TRACE_RECOMPILE_NATIVE, num_bad_blocks, 0);
   RESTORE_INTERRUPTS (old_sigmask);
 
 #if 0
@@ -172,7 +179,8 @@ native_fraction ()
   double ratio;
 
   native = nonnative = 0;
-  for (b = death_queue_head; b != NULL; b = b->death_queue_next)
+  for (b = death_queue_head; b != NULL;
+       b = BLOCK_FROM_INDEX (b->death_queue_next))
     {
       if (NATIVE_CODE_TRIED (b))
 	++native;
@@ -0,0 +1,80 @@
+/*
+ * rom.c - Read-only regions of 68k memory; see rom.h.
+ *
+ *   A host typically declares its ROM image once at startup, before
+ *   running any code there, so the region list is a short array that
+ *   is searched linearly.  Blocks translated before their region was
+ *   declared keep being treated as ordinary code until they are
+ *   retranslated.
+ */
+
+#include "syn68k_private.h"
+#include "rom.h"
+#include "alloc.h"
+#include "destroyblock.h"
+#include <stdlib.h>
+
+typedef struct
+{
+  syn68k_addr_t start;
+  uint32 num_bytes;
+} rom_region_t;
+
+static rom_region_t *rom_region;
+static int num_rom_regions;
+
+
+/* Returns TRUE iff [ADDR, ADDR + NUM_BYTES) lies entirely within one
+ * ROM region.
+ */
+BOOL
+rom_range_p (syn68k_addr_t addr, uint32 num_bytes)
+{
+  int i;
+
+  for (i = num_rom_regions - 1; i >= 0; i--)
+    {
+      const rom_region_t *r = &rom_region[i];
+      if (addr - r->start < r->num_bytes
+	  && num_bytes <= r->num_bytes - (addr - r->start))
+	return TRUE;
+    }
+
+  return FALSE;
+}
+
+
+/* Declares the NUM_BYTES of 68k memory starting at ADDR to be ROM,
+ * whose contents will never change.  Writing there afterwards, even by
+ * the host, leaves stale code and data behind.
+ */
+void
+syn68k_rom_region_add (syn68k_addr_t addr, uint32 num_bytes)
+{
+  if (num_bytes == 0)
+    return;
+
+  rom_region = (rom_region_t *) xrealloc (rom_region,
+					  ((num_rom_regions + 1)
+					   * sizeof rom_region[0]));
+  rom_region[num_rom_regions].start = addr;
+  rom_region[num_rom_regions].num_bytes = num_bytes;
+  ++num_rom_regions;
+}
+
+
+/* Forgets every ROM region.  Since translated code may depend on what
+ * was in them, all of it is thrown away, so don't call this from
+ * inside a callback.
+ */
+void
+syn68k_rom_regions_clear (void)
+{
+  if (num_rom_regions == 0)
+    return;
+
+  free (rom_region);
+  rom_region = NULL;
+  num_rom_regions = 0;
+  destroy_all_blocks ();
+}
@@ -0,0 +1,224 @@
+/*
+ * sample.c - A SIGPROF sampling profiler that attributes host CPU time
+ *            to the 68k blocks being run; see sample.h.
+ *
+ *   Samples are counted per block start address in a fixed size open
+ *   addressing table, which only sample_charge touches; the signal
+ *   handler just bumps counters.  Time the runtime spends translating
+ *   or invalidating code, and time spent outside the emulator
+ *   altogether, get counts of their own.  The result is written in the
+ *   "folded stacks" format understood by flamegraph.pl, speedscope and
+ *   friends.
+ */
+
+#include "syn68k_private.h"
+#include "sample.h"
+#include "translate.h"
+#include "callback.h"
+#include "alloc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if !defined (_WIN32)
+# include <sys/time.h>
+#endif
+
+volatile sig_atomic_t sample_busy_depth;
+volatile sig_atomic_t sample_ticks_pending;
+
+#define LOG_SAMPLE_TABLE_SIZE 14
+#define SAMPLE_TABLE_SIZE (1UL << LOG_SAMPLE_TABLE_SIZE)
+
+typedef struct
+{
+  syn68k_addr_t addr;
+  uint32 count;       /* 0 means this slot is free. */
+} sample_t;
+
+static sample_t *sample_table;
+static uint32 samples_busy, samples_host, samples_dropped;
+
+#if defined (SIGPROF) && defined (ITIMER_PROF)
+static struct sigaction old_sigprof_action;
+static BOOL sampling_p;
+
+
+static void
+sample_handler (int signo)
+{
+  if (sample_busy_depth != 0)
+    ++samples_busy;
+  else if (emulation_depth == 0)
+    ++samples_host;
+  else
+    {
+      ++sample_ticks_pending;
+      SET_INTERRUPT_STATUS (INTERRUPT_STATUS_CHANGED);
+    }
+}
+#endif  /* SIGPROF && ITIMER_PROF */
+
+
+/* Charges the pending ticks to the block at ADDR.  The interrupt poll
+ * calls this when there are any.
+ */
+void
+sample_charge (syn68k_addr_t addr)
+{
+  uint32 ticks;
+  unsigned long h, i;
+
+  ticks = sample_ticks_pending;
+  sample_ticks_pending = 0;
+  if (sample_table == NULL)
+    return;
+
+  h = (uint32) (addr * 0x9E3779B1U) >> (32 - LOG_SAMPLE_TABLE_SIZE);
+  for (i = 0; i < SAMPLE_TABLE_SIZE; i++)
+    {
+      sample_t *s = &sample_table[(h + i) & (SAMPLE_TABLE_SIZE - 1)];
+      if (s->count == 0)
+	{
+	  s->addr = addr;
+	  s->count = ticks;
+	  return;
+	}
+      if (s->addr == addr)
+	{
+	  s->count += ticks;
+	  return;
+	}
+    }
+
+  samples_dropped += ticks;
+}
+
+
+/* Starts taking about HZ samples per second of CPU time used by this
+ * process, discarding any samples taken so far.  Returns 0 on success,
+ * or -1 if sampling isn't supported on this host or the profiling timer
+ * couldn't be set.
+ */
+int
+syn68k_sample_start (unsigned hz)
+{
+#if defined (SIGPROF) && defined (ITIMER_PROF)
+  struct sigaction sa;
+  struct itimerval it;
+
+  if (hz == 0)
+    return -1;
+
+  syn68k_sample_stop ();
+
+  if (sample_table == NULL)
+    sample_table = (sample_t *) xmalloc (SAMPLE_TABLE_SIZE
+					 * sizeof sample_table[0]);
+  memset (sample_table, 0, SAMPLE_TABLE_SIZE * sizeof sample_table[0]);
+  samples_busy = samples_host = samples_dropped = 0;
+
+  memset (&sa, 0, sizeof sa);
+  sa.sa_handler = sample_handler;
+  sa.sa_flags = SA_RESTART;
+  sigemptyset (&sa.sa_mask);
+  if (sigaction (SIGPROF, &sa, &old_sigprof_action) != 0)
+    return -1;
+
+  it.it_interval.tv_sec = 0;
+  it.it_interval.tv_usec = (hz >= 1000000) ? 1 : 1000000 / hz;
+  it.it_value = it.it_interval;
+  if (setitimer (ITIMER_PROF, &it, NULL) != 0)
+    {
+      sigaction (SIGPROF, &old_sigprof_action, NULL);
+      return -1;
+    }
+
+  sampling_p = TRUE;
+  return 0;
+#else  /* !(SIGPROF && ITIMER_PROF) */
+  return -1;
+#endif  /* !(SIGPROF && ITIMER_PROF) */
+}
+
+
+/* Stops taking samples.  Samples already taken are kept for
+ * syn68k_sample_write.
+ */
+void
+syn68k_sample_stop (void)
+{
+#if defined (SIGPROF) && defined (ITIMER_PROF)
+  struct itimerval it;
+
+  if (!sampling_p)
+    return;
+
+  memset (&it, 0, sizeof it);
+  setitimer (ITIMER_PROF, &it, NULL);
+  sigaction (SIGPROF, &old_sigprof_action, NULL);
+  sampling_p = FALSE;
+  sample_ticks_pending = 0;
+#endif  /* SIGPROF && ITIMER_PROF */
+}
+
+
+static int
+compare_samples (const void *p1, const void *p2)
+{
+  syn68k_addr_t a1 = ((const sample_t *) p1)->addr;
+  syn68k_addr_t a2 = ((const sample_t *) p2)->addr;
+
+  return (a1 < a2) ? -1 : (a1 > a2);
+}
+
+
+/* Writes the samples taken so far to FP as folded stacks, one line per
+ * 68k block ("m68k;0x00001234 57"), plus lines for the time spent in
+ * the runtime itself and outside the emulator.  Sampling, if running,
+ * carries on.  Returns 0 on success, -1 on failure.
+ */
+int
+syn68k_sample_write (FILE *fp)
+{
+  sample_t *s;
+  unsigned long i, n;
+  uint32 busy, host, dropped;
+#if defined (SIGPROF) && defined (ITIMER_PROF)
+  sigset_t prof, old_mask;
+#endif
+
+  if (sample_table == NULL)
+    return -1;
+
+  /* Take a consistent copy, so we can sort it in peace. */
+  s = (sample_t *) xmalloc (SAMPLE_TABLE_SIZE * sizeof s[0]);
+#if defined (SIGPROF) && defined (ITIMER_PROF)
+  sigemptyset (&prof);
+  sigaddset (&prof, SIGPROF);
+  sigprocmask (SIG_BLOCK, &prof, &old_mask);
+#endif
+  for (i = n = 0; i < SAMPLE_TABLE_SIZE; i++)
+    if (sample_table[i].count != 0)
+      s[n++] = sample_table[i];
+  busy = samples_busy;
+  host = samples_host;
+  dropped = samples_dropped;
+#if defined (SIGPROF) && defined (ITIMER_PROF)
+  sigprocmask (SIG_SETMASK, &old_mask, NULL);
+#endif
+
+  qsort (s, n, sizeof s[0], compare_samples);
+  for (i = 0; i < n; i++)
+    fprintf (fp, "%s;0x%08lX %lu\n",
+	     IS_CALLBACK (s[i].addr) ? "callback" : "m68k",
+	     (unsigned long) s[i].addr, (unsigned long) s[i].count);
+  if (busy != 0)
+    fprintf (fp, "syn68k runtime %lu\n", (unsigned long) busy);
+  if (host != 0)
+    fprintf (fp, "host %lu\n", (unsigned long) host);
+  if (dropped != 0)
+    fprintf (fp, "m68k;[table full] %lu\n", (unsigned long) dropped);
+
+  free (s);
+  return ferror (fp) ? -1 : 0;
+}
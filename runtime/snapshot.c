@@ -0,0 +1,322 @@
+/*
+ * snapshot.c - Routines for saving and restoring a warmed up emulator.
+ *
+ * A snapshot records the CPU state, the host mapping of guest memory,
+ * and an inventory of the translated guest blocks (by 68k address).  The
+ * compiled code itself is full of host pointers, so rather than copy
+ * it we keep whatever is still in the cache when a snapshot is
+ * restored, throw away blocks whose m68k code no longer matches, and
+ * translate the rest of the inventory up front.  Guest memory belongs
+ * to the host, which must put it back before restoring.
+ *
+ * Forked children need none of this: they inherit the whole cache copy
+ * on write, and only have to call syn68k_fork_child_init.
+ */
+
+#include "syn68k_private.h"
+#include "block.h"
+#include "hash.h"
+#include "deathqueue.h"
+#include "destroyblock.h"
+#include "callback.h"
+#include "interrupt.h"
+#include "alloc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SNAPSHOT_MAGIC   0x5336384BUL  /* "S68K" */
+#define SNAPSHOT_VERSION 2
+
+/* A snapshot records only the parts of the CPU state the guest can
+ * see, plus the slice budgets, as a fixed sequence of 32 bit words
+ * (see cpu_state_to_words).  Everything else in CPUState is either
+ * scratch space or host pointers, like the trap handlers, which belong
+ * to the process doing the restoring.
+ */
+#define SNAPSHOT_CPU_WORDS 62
+
+struct syn68k_snapshot {
+  uint32 cpu[SNAPSHOT_CPU_WORDS];
+  BOOL has_memory_map;  /* FALSE for snapshots read from a file. */
+#if SIZEOF_CHAR_P == 4
+  uint32 offset;
+#else
+  uint64 offsets[OFFSET_TABLE_SIZE];
+  uint64 sizes[OFFSET_TABLE_SIZE];
+#endif
+  uint32 num_blocks;
+  syn68k_addr_t *block_address;  /* Least recently used first. */
+};
+
+
+static uint32 *
+put_uint64 (uint32 *w, uint64 n)
+{
+  w[0] = n >> 32;
+  w[1] = n;
+  return w + 2;
+}
+
+
+static const uint32 *
+get_uint64 (const uint32 *w, uint64 *n)
+{
+  *n = ((uint64) w[0] << 32) | w[1];
+  return w + 2;
+}
+
+
+/* Stores the guest visible parts of C in the SNAPSHOT_CPU_WORDS words
+ * at W.
+ */
+static void
+cpu_state_to_words (const CPUState *c, uint32 *w)
+{
+  uint64 bits;
+  int i;
+
+  for (i = 0; i < 16; i++)
+    *w++ = c->regs[i].ul.n;
+  *w++ = c->ccnz;
+  *w++ = c->ccn;
+  *w++ = c->ccc;
+  *w++ = c->ccv;
+  *w++ = c->ccx;
+  *w++ = c->sr;
+  *w++ = c->vbr;
+  *w++ = c->cacr;
+  *w++ = c->caar;
+  *w++ = c->usp;
+  *w++ = c->msp;
+  *w++ = c->isp;
+  for (i = 0; i < 8; i++)
+    *w++ = c->interrupt_pending[i];
+  for (i = 0; i < 8; i++)
+    {
+      memcpy (&bits, &c->fpreg[i], sizeof bits);
+      w = put_uint64 (w, bits);
+    }
+  *w++ = c->fpcr;
+  *w++ = c->fpsr;
+  *w++ = c->fpiar;
+  w = put_uint64 (w, c->instructions_executed);
+  w = put_uint64 (w, c->block_budget);
+  w = put_uint64 (w, c->instruction_budget);
+  *w++ = c->resume_address;
+}
+
+
+/* The inverse of cpu_state_to_words.  Fields of C that snapshots don't
+ * record are left alone.
+ */
+static void
+words_to_cpu_state (const uint32 *w, CPUState *c)
+{
+  uint64 bits;
+  int i;
+
+  for (i = 0; i < 16; i++)
+    c->regs[i].ul.n = *w++;
+  c->ccnz = *w++;
+  c->ccn  = *w++;
+  c->ccc  = *w++;
+  c->ccv  = *w++;
+  c->ccx  = *w++;
+  c->sr   = *w++;
+  c->vbr  = *w++;
+  c->cacr = *w++;
+  c->caar = *w++;
+  c->usp  = *w++;
+  c->msp  = *w++;
+  c->isp  = *w++;
+  for (i = 0; i < 8; i++)
+    c->interrupt_pending[i] = *w++;
+  for (i = 0; i < 8; i++)
+    {
+      w = get_uint64 (w, &bits);
+      memcpy (&c->fpreg[i], &bits, sizeof bits);
+    }
+  c->fpcr  = *w++;
+  c->fpsr  = *w++;
+  c->fpiar = *w++;
+  w = get_uint64 (w, &c->instructions_executed);
+  w = get_uint64 (w, &bits);
+  c->block_budget = bits;
+  w = get_uint64 (w, &bits);
+  c->instruction_budget = bits;
+  c->resume_address = *w;
+}
+
+
+/* Returns TRUE iff ADDR is real 68k code, rather than one of the magic
+ * blocks made by initialize_68k_emulator or a callback stub.  Those
+ * live in the runtime's own address window and are made on demand.
+ */
+static BOOL
+guest_code_p (syn68k_addr_t addr)
+{
+  return !IS_CALLBACK (addr)
+    && !(addr >= MAGIC_ADDRESS_BASE && addr < CALLBACK_STUB_BASE);
+}
+
+
+/* Captures the current emulator state.  Don't call this while the
+ * emulator is running.
+ */
+syn68k_snapshot_t *
+syn68k_snapshot_take (void)
+{
+  syn68k_snapshot_t *s;
+  Block *b;
+  uint32 n;
+
+  s = (syn68k_snapshot_t *) xcalloc (1, sizeof *s);
+  cpu_state_to_words (&cpu_state, s->cpu);
+  s->has_memory_map = TRUE;
+#if SIZEOF_CHAR_P == 4
+  s->offset = ROMlib_offset;
+#else
+  memcpy (s->offsets, ROMlib_offsets, sizeof s->offsets);
+  memcpy (s->sizes, ROMlib_sizes, sizeof s->sizes);
+#endif
+
+  for (n = 0, b = death_queue_head; b != NULL;
+       b = BLOCK_FROM_INDEX (b->death_queue_next))
+    if (guest_code_p (b->m68k_start_address))
+      n++;
+  s->num_blocks = n;
+  s->block_address = (syn68k_addr_t *) xmalloc ((n + 1)
+						* sizeof s->block_address[0]);
+  for (n = 0, b = death_queue_head; b != NULL;
+       b = BLOCK_FROM_INDEX (b->death_queue_next))
+    if (guest_code_p (b->m68k_start_address))
+      s->block_address[n++] = b->m68k_start_address;
+
+  return s;
+}
+
+
+/* Makes the emulator look as it did when snapshot S was taken.  Guest
+ * memory must already hold what it did then.  Blocks translated since
+ * then are kept if their m68k code still matches, and blocks in the
+ * snapshot's inventory which have since been destroyed are translated
+ * again now rather than one at a time as they are hit.
+ */
+void
+syn68k_snapshot_restore (const syn68k_snapshot_t *s)
+{
+  uint32 i;
+
+  words_to_cpu_state (s->cpu, &cpu_state);
+  memset (&cpu_state.jsr_stack, -1, sizeof cpu_state.jsr_stack);
+
+  if (s->has_memory_map)
+    {
+#if SIZEOF_CHAR_P == 4
+      ROMlib_offset = s->offset;
+#else
+      memcpy (ROMlib_offsets, s->offsets, sizeof ROMlib_offsets);
+      memcpy (ROMlib_sizes, s->sizes, sizeof ROMlib_sizes);
+#endif
+    }
+
+  /* Get rid of anything whose m68k code has changed. */
+#ifdef CHECKSUM_BLOCKS
+  destroy_blocks_with_checksum_mismatch (0, ~0);
+#else
+  destroy_blocks (0, ~0);
+#endif
+
+  /* Snapshot files from older versions may still list callback stubs,
+   * which we mustn't translate for a callback that isn't installed.
+   */
+  for (i = 0; i < s->num_blocks; i++)
+    if (guest_code_p (s->block_address[i])
+	&& hash_lookup (s->block_address[i]) == NULL)
+      hash_lookup_code_and_create_if_needed (s->block_address[i]);
+
+#ifdef SYNCHRONOUS_INTERRUPTS
+  interrupt_note_if_present ();
+#endif
+}
+
+
+void
+syn68k_snapshot_free (syn68k_snapshot_t *s)
+{
+  if (s != NULL)
+    {
+      free (s->block_address);
+      free (s);
+    }
+}
+
+
+/* Writes S to FP.  The file can be loaded by any process running
+ * syn68k on a host with the same byte order.  Returns 0 on success,
+ * -1 on failure.
+ */
+int
+syn68k_snapshot_save (const syn68k_snapshot_t *s, FILE *fp)
+{
+  uint32 header[4];
+
+  header[0] = SNAPSHOT_MAGIC;
+  header[1] = SNAPSHOT_VERSION;
+  header[2] = SNAPSHOT_CPU_WORDS;
+  header[3] = s->num_blocks;
+
+  if (fwrite (header, sizeof header, 1, fp) != 1
+      || fwrite (s->cpu, sizeof s->cpu, 1, fp) != 1
+      || (s->num_blocks != 0
+	  && fwrite (s->block_address, sizeof s->block_address[0],
+		     s->num_blocks, fp) != s->num_blocks))
+    return -1;
+  return 0;
+}
+
+
+/* Reads a snapshot written by syn68k_snapshot_save.  Returns NULL if
+ * FP doesn't hold one we understand.
+ */
+syn68k_snapshot_t *
+syn68k_snapshot_load (FILE *fp)
+{
+  syn68k_snapshot_t *s;
+  uint32 header[4];
+
+  if (fread (header, sizeof header, 1, fp) != 1
+      || header[0] != SNAPSHOT_MAGIC || header[1] != SNAPSHOT_VERSION
+      || header[2] != SNAPSHOT_CPU_WORDS)
+    return NULL;
+
+  s = (syn68k_snapshot_t *) xcalloc (1, sizeof *s);
+  s->num_blocks = header[3];
+  s->block_address = (syn68k_addr_t *) xmalloc ((s->num_blocks + 1)
+						* sizeof s->block_address[0]);
+  if (fread (s->cpu, sizeof s->cpu, 1, fp) != 1
+      || (s->num_blocks != 0
+	  && fread (s->block_address, sizeof s->block_address[0],
+		    s->num_blocks, fp) != s->num_blocks))
+    {
+      syn68k_snapshot_free (s);
+      return NULL;
+    }
+
+  s->has_memory_map = FALSE;
+  return s;
+}
+
+
+/* Call this in the child after fork ().  The child already shares the
+ * parent's translation cache copy on write, so all that's left is
+ * forgetting about the parent's threads.
+ */
+void
+syn68k_fork_child_init (void)
+{
+#ifdef SYNCHRONOUS_INTERRUPTS
+  interrupt_forget_waiters ();
+#endif
+}
@@ -10,10 +10,18 @@
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
-#include "rangetree.h"
+#include "pagedir.h"
 #include "native.h"
 #include "translate.h"
 #include "recompile.h"
+#include "checksum.h"
+#include "loopidiom.h"
+#include "idle.h"
+#include "optimize.h"
+#include "callprof.h"
+#include "callback.h"
+#include "fpu.h"
+#include "jumptable.h"
 #include <stdlib.h>
 
 #include "ccfuncs.h"
@@ -24,22 +32,33 @@
 # define IFDEBUG(x)
 #endif
 
-/* Do an efficient inline code lookup.  Whenever we get a hit on a hash table
- * entry, we move it to the head of the linked list.  We can just check the
- * head here; if that fails, we can do the slower check and possible compile.
+/* Do an efficient inline code lookup.  First we try the jump cache.
+ * Whenever we get a hit on a hash table entry, we move it to the head of
+ * the linked list.  We can just check the head here; if that fails, we
+ * can do the slower check and possible compile.
  */
 
 static inline const uint16 *
 code_lookup (uint32 addr)
 {
-  Block *b = block_hash_table[BLOCK_HASH (addr)];
+  JumpCacheEntry *e = &jump_cache[JUMP_CACHE_INDEX (addr)];
+  Block *b;
   const uint16 *c;
-  if (b != NULL && b->m68k_start_address == addr)
+
+  if (e->m68k_address == addr)
+    return e->compiled_code;
+
+  b = BLOCK_FROM_INDEX (block_hash_table[BLOCK_HASH (addr)]);
+  if (b != NULL && b->m68k_start_address == addr
+      && BLOCK_CHECKSUM_CURRENT (b))
     c = b->compiled_code;
   else
     {
       c = hash_lookup_code_and_create_if_needed (addr);
     }
+
+  e->m68k_address = addr;
+  e->compiled_code = c;
   return c;
 }
 
@@ -109,6 +128,52 @@ reset_frequency ()
 #endif
 
 
+/* Does the per-block bookkeeping for entering the block whose compiled
+ * code starts at CODE: counts its instructions and charges it against
+ * the current slice's budget, as block_accounting asks.  Returns FALSE
+ * iff the block would overrun the budget.  Native code chains blocks
+ * without passing through here, so native builds don't keep budgets or
+ * instruction counts at all.
+ */
+static BOOL
+charge_block (const uint16 *code)
+{
+#ifndef GENERATE_NATIVE_CODE
+  uint32 ninstrs = BLOCK_NUM_INSTRS (code);
+
+  if ((block_accounting & BLOCK_ACCOUNTING_BUDGET)
+      && ((cpu_state.block_budget -= 1)
+	  | (cpu_state.instruction_budget -= ninstrs)) < 0)
+    return FALSE;
+  cpu_state.instructions_executed += ninstrs;
+#endif
+  return TRUE;
+}
+
+
+/* CHARGE_BLOCK is invoked from CHECK_FOR_INTERRUPT, with code pointing
+ * at the start of the next block's compiled code and PC its 68k
+ * address.  If block accounting is on, it does the bookkeeping,
+ * leaving the interpreter with cpu_state.resume_address = PC if the
+ * slice's budget would be overrun.
+ */
+#define CHARGE_BLOCK(pc)					\
+{								\
+  if (block_accounting != 0 && !charge_block (code))		\
+    {								\
+      cpu_state.resume_address = (pc);				\
+      SAVE_CPU_STATE ();					\
+      --emulation_depth;					\
+      return;							\
+    }								\
+}
+
+
+/* CHECK_FOR_INTERRUPT is invoked whenever control is about to enter a
+ * new block.  Block accounting gets its own test here rather than
+ * keeping the interrupt status "changed", so it doesn't send every
+ * block transition through interrupt_process_any_pending.
+ */
 #ifdef SYNCHRONOUS_INTERRUPTS
 # define CHECK_FOR_INTERRUPT(pc)			\
 {							\
@@ -122,9 +187,13 @@ reset_frequency ()
       if (new_addr != (__pc))				\
 	{						\
 	  code = code_lookup (new_addr);		\
+	  CHARGE_BLOCK (new_addr);			\
 	  NEXT_INSTRUCTION (PTR_WORDS);			\
 	}						\
+      CHARGE_BLOCK (__pc);				\
     }							\
+  else							\
+    CHARGE_BLOCK (pc);					\
 }
 #else  /* !SYNCHRONOUS_INTERRUPTS */
 # define CHECK_FOR_INTERRUPT(pc)
@@ -355,7 +424,66 @@ interpret_code1 (const uint16 *start_code, CPUState *cpu_state_ptr, const void *
 void
 interpret_code (const uint16 *start_code)
 {
+  syn68k_addr_t start_address, old_resume_address;
+  uint32 old_budget_p;
+
+#if SIZEOF_CHAR_P != 8
+  start_address = READUL (US_TO_SYN68K (start_code - PTR_WORDS));
+#else
+  start_address = READUL_US (start_code - PTR_WORDS);
+#endif
+
+  /* We may be nested inside a budgeted slice (e.g. a callback calling
+   * back into the emulator), so run unlimited and put things back.
+   */
+  old_budget_p       = block_accounting & BLOCK_ACCOUNTING_BUDGET;
+  old_resume_address = cpu_state.resume_address;
+
+  block_accounting_disable (BLOCK_ACCOUNTING_BUDGET);
+  if (block_accounting != 0)
+    charge_block (start_code);
   interpret_code1(start_code, &cpu_state, NULL);
+
+  if (old_budget_p)
+    block_accounting_enable (BLOCK_ACCOUNTING_BUDGET);
+  cpu_state.resume_address = old_resume_address;
+}
+
+/* Like interpret_code, but gives up at the first block boundary past
+ * either budget; see syn68k_public.h.
+ */
+syn68k_interpret_status_t
+syn68k_interpret_code_with_budget (const uint16 *start_code,
+				   int64 max_blocks, int64 max_instructions)
+{
+  syn68k_addr_t start_address;
+
+#if SIZEOF_CHAR_P != 8
+  start_address = READUL (US_TO_SYN68K (start_code - PTR_WORDS));
+#else
+  start_address = READUL_US (start_code - PTR_WORDS);
+#endif
+  if (max_blocks <= 0 || max_instructions <= 0)
+    {
+      cpu_state.resume_address = start_address;
+      return SYN68K_INTERPRET_BUDGET_EXHAUSTED;
+    }
+
+  /* The first block always runs, so each slice makes progress. */
+  block_accounting_disable (BLOCK_ACCOUNTING_BUDGET);
+  if (block_accounting != 0)
+    charge_block (start_code);
+  cpu_state.block_budget       = max_blocks - 1;
+  cpu_state.instruction_budget = (max_instructions
+				  - (int64) BLOCK_NUM_INSTRS (start_code));
+  cpu_state.resume_address     = MAGIC_EXIT_EMULATOR_ADDRESS;
+  block_accounting_enable (BLOCK_ACCOUNTING_BUDGET);
+  interpret_code1 (start_code, &cpu_state, NULL);
+  block_accounting_disable (BLOCK_ACCOUNTING_BUDGET);
+
+  /* Stopping just before the exit block is as good as finishing. */
+  return (cpu_state.resume_address == MAGIC_EXIT_EMULATOR_ADDRESS
+	  ? SYN68K_INTERPRET_DONE : SYN68K_INTERPRET_BUDGET_EXHAUSTED);
 }
 
 #ifdef USE_DIRECT_DISPATCH
@@ -906,11 +1034,18 @@ main_loop:
 
       CASE (0x00B3)
 	CASE_PREAMBLE ("Reserved - callback", "", "", "", "")
-	SAVE_CPU_STATE ();
-	code = code_lookup ((*((uint32 (**)(uint32, void *)) code))
-			    (*(uint32 *)(code + PTR_WORDS + PTR_WORDS),
-			     *(void **)(code + PTR_WORDS)));
-	LOAD_CPU_STATE ();
+	{
+	  syn68k_addr_t addr = *(const uint32 *)code;
+	  const CallBackInfo *cb = &callback[CALLBACK_SLOT (addr)];
+
+	  syn68k_addr_t next;
+
+	  SAVE_CPU_STATE ();
+	  next = cb->func (addr, cb->arg);
+	  code = code_lookup (next);
+	  LOAD_CPU_STATE ();
+	  CHECK_FOR_INTERRUPT (next);
+	}
 	CASE_POSTAMBLE (ROUND_UP (PTR_WORDS));
 
       CASE (0x00B4)
@@ -930,5 +1065,110 @@ main_loop:
 	code = *(const uint16 **)code;
 	a7.ul.n -= 4;
 	WRITEUL_UNSWAPPED (SYN68K_TO_US (CLEAN (a7.ul.n)), retaddr);
+#if SIZEOF_CHAR_P != 8
+	CALLPROF_CALL (READUL (US_TO_SYN68K (code - PTR_WORDS)), a7.ul.n);
+	CHECK_FOR_INTERRUPT (READUL (US_TO_SYN68K (code - PTR_WORDS)));
+#else
+	CALLPROF_CALL (READUL_US (code - PTR_WORDS), a7.ul.n);
+	CHECK_FOR_INTERRUPT (READUL_US (code - PTR_WORDS));
+#endif
+	CASE_POSTAMBLE (ROUND_UP (PTR_WORDS));
+
+      CASE (0x00B5)
+	CASE_PREAMBLE ("Reserved - bulk copy/fill/compare loop", "", "", "", "")
+	SAVE_CPU_STATE ();
+	loop_idiom_execute (*(const uint32 *)code);
+	LOAD_CPU_STATE ();
+	CASE_POSTAMBLE (ROUND_UP (PTR_WORDS + 2));
+
+      CASE (0x00B6)
+	CASE_PREAMBLE ("Reserved - idle loop check", "", "", "", "")
+#ifdef SYNCHRONOUS_INTERRUPTS
+	if (idle_spin_threshold != 0)
+	  {
+	    SAVE_CPU_STATE ();
+	    idle_loop_spin (*(const Block **)code);
+	    LOAD_CPU_STATE ();
+	  }
+#endif
+	CASE_POSTAMBLE (ROUND_UP (PTR_WORDS + PTR_WORDS));
+
+      CASE (0x00B7)
+	CASE_PREAMBLE ("Reserved - count hot block", "", "", "", "")
+	{
+	  Block *b = *(Block **)code;
+
+	  if (++b->num_times_called >= OPTIMIZE_CUTOFF
+	      && emulation_depth == 1)
+	    {
+	      syn68k_addr_t addr = b->m68k_start_address;
+
+	      SAVE_CPU_STATE ();
+	      optimize_hot_region (b);
+	      LOAD_CPU_STATE ();
+	      code = (hash_lookup_code_and_create_if_needed (addr)
+		      /* Compensate for the add we do below. */
+		      - ROUND_UP (PTR_WORDS + PTR_WORDS) + OPCODE_WORDS);
+	    }
+	}
+	CASE_POSTAMBLE (ROUND_UP (PTR_WORDS + PTR_WORDS));
+
+      /* Enter another block's code at one of its instructions; see
+       * make_alias_block.
+       */
+      CASE (0x00B8)
+	CASE_PREAMBLE ("Reserved - alias block entry", "", "", "", "")
+	code = (*(const uint16 **)code
+		/* Compensate for the add we do below. */
+		- ROUND_UP (PTR_WORDS + PTR_WORDS) + OPCODE_WORDS);
+	CASE_POSTAMBLE (ROUND_UP (PTR_WORDS + PTR_WORDS));
+
+      /* Count a transition between native and synthetic code; see
+       * nativecov.c.  The second counter is optional.
+       */
+      CASE (0x00B9)
+	CASE_PREAMBLE ("Reserved - count native transition", "", "", "", "")
+	++**(uint32 **)code;
+	if (((uint32 **)code)[1] != NULL)
+	  ++*((uint32 **)code)[1];
+	CASE_POSTAMBLE (ROUND_UP (PTR_WORDS + PTR_WORDS + PTR_WORDS));
+
+      /* jmp (d8,PC,Xn) through a switch's jump table; see jumptable.h. */
+      CASE (0x00BA)
+	CASE_PREAMBLE ("Reserved - jump table dispatch", "", "", "", "")
+	{
+	  JumpTable *t = (JumpTable *) code;
+	  JumpCacheEntry *e;
+	  syn68k_addr_t target;
+	  int32 index;
+	  uint32 generation;
+
+	  if (t->index & (1 << 11))
+	    index = GENERAL_REGISTER_SL (t->index >> 12);
+	  else
+	    index = GENERAL_REGISTER_SW (t->index >> 12);
+	  target = CLEAN (t->base + (index << ((t->index >> 9) & 3)));
+
+	  e = &t->slot[JUMP_TABLE_SLOT (target, t->base, t->shift, t->mask)];
+	  generation = jump_cache_generation;
+	  if (e->m68k_address == target && t->generation == generation)
+	    code = e->compiled_code;
+	  else
+	    {
+	      code = code_lookup (target);
+
+	      /* Remember the target, unless looking it up destroyed
+	       * blocks, maybe including this one.
+	       */
+	      if (jump_cache_generation == generation)
+		{
+		  if (t->generation != generation)
+		    jump_table_clear (t);
+		  e->m68k_address = target;
+		  e->compiled_code = code;
+		}
+	    }
+	  CHECK_FOR_INTERRUPT (target);
+	}
 	CASE_POSTAMBLE (ROUND_UP (PTR_WORDS));
 
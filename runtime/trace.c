@@ -0,0 +1,202 @@
+/*
+ * trace.c - Records runtime activity in a ring buffer and writes it out
+ *           as Chrome trace JSON; see trace.h.
+ *
+ *   Translation and invalidation events are begin/end pairs on one
+ *   track, so nested activity (say, a revalidation inside a lookup)
+ *   shows up as nested slices.  Busy notifications get a track of their
+ *   own since they needn't nest with anything.
+ */
+
+#include "syn68k_private.h"
+#include "trace.h"
+#include "alloc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+trace_event_t *trace_events = NULL;
+static unsigned long max_trace_events;
+static unsigned long num_trace_events;   /* Total recorded, may wrap. */
+static uint64 trace_start_ns;
+static BOOL trace_busy_p;
+
+#define TRACE_PID 1
+#define TRACE_MAIN_TID 1
+#define TRACE_BUSY_TID 2
+
+/* Names and argument formats for each event type.  The formats are
+ * handed the event's two args as unsigned longs, so they may ignore
+ * either one.
+ */
+static const struct
+{
+  const char *name;
+  const char *begin_args;   /* Used for 'B' and 'i' events. */
+  const char *end_args;
+} trace_event_info[NUM_TRACE_EVENT_TYPES] =
+{
+  { "generate_block", "\"address\":\"0x%lX\"", "\"blocks\":%lu" },
+  { "destroy_blocks", "\"address\":\"0x%lX\",\"bytes\":%lu",
+      "\"destroyed\":%lu" },
+  { "checksum_sweep", "\"blocks\":%lu", "\"destroyed\":%lu" },
+  { "checksum_defer", "\"generation\":%lu", NULL },
+  { "revalidate_block", "\"address\":\"0x%lX\"",
+      "\"mismatches\":%lu,\"destroyed\":%lu" },
+  { "recompile_native", "\"address\":\"0x%lX\"", "\"blocks\":%lu" },
+  { "optimize_hot_region", "\"address\":\"0x%lX\"", "\"blocks\":%lu" },
+  { "interrupt", "\"pc\":\"0x%lX\",\"priority\":%lu", NULL },
+  { "busy", NULL, NULL },
+  { "idle_park", "\"address\":\"0x%lX\"", NULL },
+};
+
+
+static uint64
+trace_now (void)
+{
+#ifdef CLOCK_MONOTONIC
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (uint64) ts.tv_sec * 1000000000 + ts.tv_nsec;
+#else  /* !CLOCK_MONOTONIC */
+  return (uint64) clock () * (1000000000 / CLOCKS_PER_SEC);
+#endif  /* !CLOCK_MONOTONIC */
+}
+
+
+/* Starts recording runtime events, keeping only the most recent
+ * MAX_EVENTS of them.  Any events already recorded are discarded.
+ */
+void
+syn68k_trace_start (unsigned long max_events)
+{
+  if (max_events == 0)
+    max_events = 1;
+
+  free (trace_events);
+  trace_events = NULL;  /* Don't record anything while we allocate. */
+  trace_events = (trace_event_t *) xmalloc (max_events
+					    * sizeof trace_events[0]);
+  max_trace_events = max_events;
+  num_trace_events = 0;
+  trace_busy_p = FALSE;
+  trace_start_ns = trace_now ();
+}
+
+
+/* Stops recording and throws away any events not yet written. */
+void
+syn68k_trace_stop (void)
+{
+  free (trace_events);
+  trace_events = NULL;
+  num_trace_events = 0;
+}
+
+
+/* Appends an event to the ring buffer, overwriting the oldest one if
+ * the buffer is full.  Use the TRACE_ macros, which skip this call
+ * when tracing is off.
+ */
+void
+trace_record (trace_event_type_t type, char phase, uint32 arg0, uint32 arg1)
+{
+  trace_event_t *e = &trace_events[num_trace_events % max_trace_events];
+
+  e->time_ns = trace_now ();
+  e->arg[0] = arg0;
+  e->arg[1] = arg1;
+  e->type = type;
+  e->phase = phase;
+  ++num_trace_events;
+}
+
+
+/* Records a busy slice each time call_while_busy_func is told we have
+ * become busy or idle.  Repeated notifications of the same state, as
+ * generate_block makes for every block it translates, are ignored.
+ */
+void
+trace_note_busy (int busy_p)
+{
+  if (!busy_p != !trace_busy_p)
+    {
+      trace_busy_p = (busy_p != 0);
+      trace_record (TRACE_BUSY, busy_p ? 'B' : 'E', 0, 0);
+    }
+}
+
+
+/* Writes every recorded event to FP as a Chrome trace JSON object and
+ * empties the ring buffer; recording continues afterwards.  End events
+ * whose beginnings were overwritten are dropped so the slices nest
+ * properly.  Returns 0 on success, -1 on failure.
+ */
+int
+syn68k_trace_write (FILE *fp)
+{
+  unsigned long first, i;
+  int depth[2];
+  int old_sigmask;
+
+  if (trace_events == NULL)
+    return -1;
+
+  BLOCK_INTERRUPTS (old_sigmask);
+
+  fprintf (fp, "{\"traceEvents\":[\n"
+	   "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+	   "\"args\":{\"name\":\"syn68k runtime\"}},\n"
+	   "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+	   "\"args\":{\"name\":\"busy\"}}",
+	   TRACE_PID, TRACE_MAIN_TID, TRACE_PID, TRACE_BUSY_TID);
+
+  depth[0] = depth[1] = 0;
+  first = ((num_trace_events > max_trace_events)
+	   ? num_trace_events - max_trace_events : 0);
+  for (i = first; i < num_trace_events; i++)
+    {
+      const trace_event_t *e = &trace_events[i % max_trace_events];
+      int track = (e->type == TRACE_BUSY);
+      const char *args;
+      uint64 ns;
+
+      if (e->phase == 'B')
+	++depth[track];
+      else if (e->phase == 'E')
+	{
+	  if (depth[track] == 0)
+	    continue;
+	  --depth[track];
+	}
+
+      ns = (e->time_ns >= trace_start_ns) ? e->time_ns - trace_start_ns : 0;
+      fprintf (fp, ",\n{\"name\":\"%s\",\"cat\":\"syn68k\",\"ph\":\"%c\","
+	       "\"ts\":%lu.%03lu,\"pid\":%d,\"tid\":%d",
+	       trace_event_info[e->type].name, e->phase,
+	       (unsigned long) (ns / 1000), (unsigned long) (ns % 1000),
+	       TRACE_PID, track ? TRACE_BUSY_TID : TRACE_MAIN_TID);
+      if (e->phase == 'i')
+	fputs (",\"s\":\"t\"", fp);
+
+      args = ((e->phase == 'E')
+	      ? trace_event_info[e->type].end_args
+	      : trace_event_info[e->type].begin_args);
+      if (args != NULL)
+	{
+	  fputs (",\"args\":{", fp);
+	  fprintf (fp, args, (unsigned long) e->arg[0],
+		   (unsigned long) e->arg[1]);
+	  fputc ('}', fp);
+	}
+      fputc ('}', fp);
+    }
+
+  fputs ("\n]}\n", fp);
+  num_trace_events = 0;
+
+  RESTORE_INTERRUPTS (old_sigmask);
+
+  return ferror (fp) ? -1 : 0;
+}
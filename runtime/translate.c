@@ -1,7 +1,7 @@
 #include "syn68k_private.h"
 #include "block.h"
 #include "mapping.h"
-#include "rangetree.h"
+#include "pagedir.h"
 #include "translate.h"
 #include "alloc.h"
 #include "blockinfo.h"
@@ -12,6 +12,11 @@
 #include "deathqueue.h"
 #include "checksum.h"
 #include "native.h"
+#include "optimize.h"
+#include "nativecov.h"
+#include "rom.h"
+#include "sample.h"
+#include "jumptable.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -60,6 +65,22 @@ static int translate_instruction (const uint16 *m68k_code,
 static int generate_amode_fetch (uint16 *scode, const uint16 *m68koperand,
 				 int amode, BOOL reversed, int size);
 
+/* While a hot region is retranslated (see optimize.h), we track which
+ * of a0-a6 hold values known at translation time.  Bit n of KNOWN is
+ * set when an holds VALUE[n] on entry to the current instruction.
+ */
+typedef struct
+{
+  uint8 known;
+  uint32 value[8];
+} AregConstants;
+
+static int fold_constant_areg (uint16 *code, const uint16 *m68koperand,
+			       int amode, BOOL reversed, int size,
+			       const AregConstants *ac);
+static void note_areg_constants (AregConstants *ac,
+				 const uint16 *m68k_code);
+
 typedef struct
 {
   const OpcodeMappingInfo *map;
@@ -70,33 +91,90 @@ static void compute_maps_and_ccs (Block *b, MapAndCC *m,
 				  const TempBlockInfo *tbi);
 
 static inline uint16 * output_opcode (uint16 *code, uint32 opcode);
+#ifndef GENERATE_NATIVE_CODE
+static Block *make_alias_block (Block *parent, syn68k_addr_t m68k_address);
+#endif
 
 
-/* Compiles a block at a specified address and returns a mask indicating
- * which cc bits must be valid on entry to this block.  The block is placed
- * in the hashtable and the rangetree.  The block just created is
- * returned by reference in *new.  If a block already exists at the specified
- * address, a new block is not created; cc bit information from the already
- * existing block is returned.
+#ifdef CHECKSUM_BLOCKS
+/* Addresses of out of date blocks that generate_block_aux linked to
+ * while other blocks were half built; see revalidate_stale_links.
  */
-int
-generate_block (Block *parent, uint32 m68k_address, Block **new
+static syn68k_addr_t *stale_link;
+static unsigned long num_stale_links, max_stale_links;
+
+
+static void
+note_stale_link (syn68k_addr_t m68k_address)
+{
+  if (num_stale_links == max_stale_links)
+    {
+      max_stale_links = max_stale_links ? 2 * max_stale_links : 16;
+      stale_link = (syn68k_addr_t *) xrealloc (stale_link,
+					       (max_stale_links
+						* sizeof stale_link[0]));
+    }
+  stale_link[num_stale_links++] = m68k_address;
+}
+
+
+/* Verifies the blocks noted by note_stale_link, now that every block
+ * linking to them is complete.  Returns the number of blocks destroyed.
+ */
+static unsigned long
+revalidate_stale_links (void)
+{
+  unsigned long total_destroyed = 0;
+
+  while (num_stale_links > 0)
+    {
+      Block *b = hash_lookup (stale_link[--num_stale_links]);
+      if (b != NULL)
+	total_destroyed += revalidate_block (b);
+    }
+
+  return total_destroyed;
+}
+#endif  /* CHECKSUM_BLOCKS */
+
+
+/* Does the work for generate_block, below. */
+static int
+generate_block_aux (Block *parent, uint32 m68k_address, Block **new
 /* #ifdef GENERATE_NATIVE_CODE */
-		, BOOL try_native_p
+		    , BOOL try_native_p
 /* #endif */  /* GENERATE_NATIVE_CODE */
-		)
+		    )
 {
   Block *b, *old_block;
   TempBlockInfo tbi;
   int cc_needed_by_this_block, cc_needed_by_children;
+  int cc_hint;
+  BOOL provisional_p;
   int i;
 
   /* Call a user-defined function periodically while doing stuff. */
-  if (call_while_busy_func != NULL)
-    call_while_busy_func (1);
+  note_busy (1);
 
   /* If a block already exists there, just return its info. */
   old_block = hash_lookup (m68k_address);
+#ifdef CHECKSUM_BLOCKS
+  /* Linking to a block bypasses code_lookup, so it must be verified.
+   * That can destroy blocks along with their parents, which may include
+   * blocks still being built (our caller's already resolved children,
+   * say), so below the outermost call we leave it to generate_block.
+   */
+  if (old_block != NULL && !BLOCK_CHECKSUM_CURRENT (old_block))
+    {
+      if (parent == NULL)
+	{
+	  revalidate_block (old_block);
+	  old_block = hash_lookup (m68k_address);
+	}
+      else
+	note_stale_link (m68k_address);
+    }
+#endif  /* CHECKSUM_BLOCKS */
   if (old_block != NULL)
     {
       *new = old_block;
@@ -105,6 +183,18 @@ generate_block (Block *parent, uint32 m68k_address, Block **new
       return old_block->cc_needed;
     }
 
+#ifndef GENERATE_NATIVE_CODE
+  /* If the address starts an instruction inside an existing block, share
+   * that block's code rather than translating it all over again.
+   */
+  b = make_alias_block (parent, m68k_address);
+  if (b != NULL)
+    {
+      *new = b;
+      return b->cc_needed;
+    }
+#endif  /* !GENERATE_NATIVE_CODE */
+
   /* See if this is really a magical callback address; if so, compile
    * it as such.
    */
@@ -119,19 +209,25 @@ generate_block (Block *parent, uint32 m68k_address, Block **new
   b = *new = block_new ();
 
   compute_block_info (b, SYN68K_TO_US (m68k_address), &tbi);
+  b->rom = rom_range_p (m68k_address, b->m68k_code_length);
   if (parent != NULL)
     block_add_parent (b, parent);
 
   /* Temporarily, additionally demand that all cc bits we might not set
    * be valid on entry into this block.  We'll get a better idea what
-   * bits need to be set, but we need to assume the worst for this recursion.
+   * bits need to be set, but we need to assume the worst for this recursion,
+   * unless we are retranslating a hot region and know better.
    */
   cc_needed_by_this_block = b->cc_needed;
-  b->cc_needed |= b->cc_may_not_set;
+  cc_hint = optimize_cc_hint (m68k_address);
+  if (cc_hint >= 0)
+    b->cc_needed = cc_hint;
+  else
+    b->cc_needed |= b->cc_may_not_set;
 
   /* Add this block to the universe of blocks. */
   hash_insert (b);
-  range_tree_insert (b);
+  page_dir_insert (b);
 
   /* Generate all child blocks & determine what cc bits they need.  If this
    * block has itself as a child, we ignore what cc bits it needs (since
@@ -139,21 +235,34 @@ generate_block (Block *parent, uint32 m68k_address, Block **new
    * Hopefully this should help tight loops compute fewer cc bits.
    */
   b->num_children = tbi.num_child_blocks;
+  provisional_p = FALSE;
   if (tbi.num_child_blocks == 0)     /* No children -> next_block_dynamic. */
     cc_needed_by_children = ALL_CCS;
   else
     for (i = 0, cc_needed_by_children = 0; i < b->num_children; i++)
       {
 	if (tbi.child[i] != m68k_address)
-	  cc_needed_by_children |= generate_block (b, tbi.child[i],
-						   &b->child[i],
-						   try_native_p);
+	  {
+	    Block *c;
+
+	    cc_needed_by_children |= generate_block (b, tbi.child[i],
+						     &b->child[i],
+						     try_native_p);
+
+	    /* A child still being translated gave us a worst case guess. */
+	    c = b->child[i];
+	    if (c->cc_provisional
+		|| (c->compiled_code == NULL
+		    && optimize_cc_hint (tbi.child[i]) < 0))
+	      provisional_p = TRUE;
+	  }
 	else
 	  {
 	    block_add_parent (b, b);
 	    b->child[i] = b;
 	  }
       }
+  b->cc_provisional = provisional_p && cc_hint < 0;
   
   /* Compute exactly what cc bits must be valid on block entry. */
   b->cc_needed = (cc_needed_by_this_block
@@ -176,6 +285,51 @@ generate_block (Block *parent, uint32 m68k_address, Block **new
 }
 
 
+/* Compiles a block at a specified address and returns a mask indicating
+ * which cc bits must be valid on entry to this block.  The block is placed
+ * in the hashtable and the page directory.  The block just created is
+ * returned by reference in *new.  If a block already exists at the specified
+ * address, a new block is not created; cc bit information from the already
+ * existing block is returned.
+ */
+int
+generate_block (Block *parent, uint32 m68k_address, Block **new
+/* #ifdef GENERATE_NATIVE_CODE */
+		, BOOL try_native_p
+/* #endif */  /* GENERATE_NATIVE_CODE */
+		)
+{
+  static BOOL outermost_p = TRUE;
+  unsigned long old_num_blocks;
+  int cc;
+
+  if (!outermost_p)
+    return generate_block_aux (parent, m68k_address, new, try_native_p);
+
+  /* Trace only the outermost call, which includes all its children. */
+  old_num_blocks = num_blocks_created;
+  TRACE_BEGIN (TRACE_GENERATE, m68k_address, 0);
+  SAMPLE_BUSY_BEGIN ();
+  outermost_p = FALSE;
+  cc = generate_block_aux (parent, m68k_address, new, try_native_p);
+
+#ifdef CHECKSUM_BLOCKS
+  /* Now that nothing is half built, check the out of date blocks we
+   * linked to.  If that destroyed the new block, build it again.
+   */
+  while (revalidate_stale_links () > 0
+	 && (*new = hash_lookup (m68k_address)) == NULL)
+    cc = generate_block_aux (parent, m68k_address, new, try_native_p);
+#endif  /* CHECKSUM_BLOCKS */
+
+  outermost_p = TRUE;
+  SAMPLE_BUSY_END ();
+  TRACE_END (TRACE_GENERATE, num_blocks_created - old_num_blocks, 0);
+
+  return cc;
+}
+
+
 /* This function fills in the synthetic operands that point to subsequent
  * blocks with pointers to the compiled code in the child blocks.  Because
  * we have to compile loops, it may not always be possible to get the
@@ -190,7 +344,7 @@ compute_child_code_pointers (Block *b)
   backpatch_t *p, *next;
   
   /* Loop over all of our backpatches and fill in what we can. */
-  for (p = b->backpatch; p != NULL; p = next)
+  for (p = BLOCK_COLD (b)->backpatch; p != NULL; p = next)
     {
       next = p->next;
       if (p->target == NULL || p->target->compiled_code != NULL)
@@ -200,7 +354,7 @@ compute_child_code_pointers (Block *b)
   /* Only recurse on those parents interested in our new code location. */
   for (i = b->num_parents - 1; i >= 0; i--)
     {
-      for (p = b->parent[i]->backpatch; p != NULL; p = p->next)
+      for (p = BLOCK_COLD (b->parent[i])->backpatch; p != NULL; p = p->next)
 	if (p->target == b)
 	  break;
       
@@ -213,16 +367,56 @@ compute_child_code_pointers (Block *b)
 
 #ifdef GENERATE_NATIVE_CODE
 /* We use these to keep track of where we need to backpatch transitions
- * from native to synthetic code.
+ * from native to synthetic code.  A counted transition goes by way of
+ * its own 0xB9 counter at counter_offset (0 if there is none), out of
+ * line, since synthetic code can fall into synth_offset too.
  */
 typedef struct
 {
   unsigned long stub_offset;
   unsigned long synth_offset;
+  unsigned long counter_offset;
+  uint32 *opcode_counter;
 } ntos_cleanup_t;
+
+
+/* Writes a 0xB9 opcode bumping the given transition counters at P;
+ * see nativecov.c.  Returns the number of bytes written.
+ */
+static unsigned long
+output_transition_counter (uint8 *p, uint32 *block_counter,
+			   uint32 *opcode_counter)
+{
+  uint32 **operand = (uint32 **) output_opcode ((uint16 *) p, 0x00B9);
+
+  operand[0] = block_counter;
+  operand[1] = opcode_counter;
+  return OPCODE_BYTES + PTR_BYTES + PTR_BYTES;
+}
 #endif  /* GENERATE_NATIVE_CODE */
 
 
+/* Writes the 0xBA opcode that replaces the jmp at JMP_CODE at P, with
+ * the empty slots described by JT; see jumptable.h.  Returns the number
+ * of bytes written.
+ */
+static unsigned long
+output_jump_table (uint8 *p, const uint16 *jmp_code,
+		   const JumpTableInfo *jt)
+{
+  JumpTable *t = (JumpTable *) output_opcode ((uint16 *) p, 0x00BA);
+  uint16 ext = READUW (US_TO_SYN68K (jmp_code + 1));
+
+  t->base  = US_TO_SYN68K (jmp_code + 1) + (int8) ext;
+  t->index = ext & 0xFE00;
+  t->shift = jt->shift;
+  t->mask  = jt->mask;
+  jump_table_clear (t);
+
+  return OPCODE_BYTES + JUMP_TABLE_BYTES (jt->mask);
+}
+
+
 /* The function generates the synthetic code for a given block.  It does
  * not fill in the pointers to the code in subsequent blocks (if they
  * are even known at translation time).
@@ -245,7 +439,13 @@ generate_code (Block *b, TempBlockInfo *tbi, BOOL try_native_p)
 #ifdef SYNCHRONOUS_INTERRUPTS
   int check_int_stub_offset = -1;
 #endif
-#endif  /* GENERATE_NATIVE_CODE */
+#else  /* !GENERATE_NATIVE_CODE */
+  BlockEntryPoint *entry_point;
+  BOOL entry_points_fit_p;
+#endif  /* !GENERATE_NATIVE_CODE */
+  unsigned long entry_point_bytes;
+  AregConstants areg_constants;
+  BOOL track_aregs_p, folded_aregs_p;
   SAFE_DECL();
 
   instr_code[(sizeof instr_code / sizeof instr_code[0]) - 1] = 0xFEEBFADE;
@@ -259,15 +459,16 @@ generate_code (Block *b, TempBlockInfo *tbi, BOOL try_native_p)
   num_ntos_cleanup = 0;
 #endif
 
-  /* Allocate space for code.  We'll skip over PTR_BYTES because that
-   * space is reserved.
+  /* Allocate space for code.  We'll skip over BLOCK_HEADER_BYTES because
+   * that space is reserved.
    */
   max_code_bytes = (tbi->num_68k_instrs * 32 + 512);
-  code = (uint8 *) xmalloc (PTR_BYTES + max_code_bytes) + PTR_BYTES;
+  code = ((uint8 *) xmalloc (BLOCK_HEADER_BYTES + max_code_bytes)
+	  + BLOCK_HEADER_BYTES);
   num_code_bytes = 0;
 
   /* Start with no backpatches. */
-  b->backpatch = NULL;
+  BLOCK_COLD (b)->backpatch = NULL;
 
   /* Compute exactly which cc bits and OpcodeMappingInfo *'s we should
    * use for each m68k instruction in this block.
@@ -276,6 +477,20 @@ generate_code (Block *b, TempBlockInfo *tbi, BOOL try_native_p)
 					 * sizeof map_and_cc[0]);
   compute_maps_and_ccs (b, map_and_cc, tbi);
 
+  /* Only hot regions are worth the extra work of tracking constant
+   * address registers.  Nothing is known on entry to the block.
+   */
+  track_aregs_p = (optimize_cc_hint (b->m68k_start_address) >= 0);
+  folded_aregs_p = FALSE;
+  areg_constants.known = 0;
+
+#ifndef GENERATE_NATIVE_CODE
+  /* Remember where each instruction starts, for alias blocks. */
+  entry_point = (BlockEntryPoint *) SAFE_alloca ((tbi->num_68k_instrs + 1)
+						 * sizeof entry_point[0]);
+  entry_points_fit_p = TRUE;
+#endif
+
 #ifdef GENERATE_NATIVE_CODE
   /* Output the block preamble.  We have separate entry points for
    * incoming native code and incoming synthetic code.  Why?  Incoming
@@ -328,25 +543,55 @@ generate_code (Block *b, TempBlockInfo *tbi, BOOL try_native_p)
       int j, main_size;
       int32 backpatch_request_index;
       const OpcodeMappingInfo *map = map_and_cc[i].map;
+      BOOL jump_table_p = (i == tbi->num_68k_instrs - 1
+			   && tbi->jump_table.num_targets != 0);
 #ifdef GENERATE_NATIVE_CODE
       BOOL native_p = FALSE;
       backpatch_t *old_backpatch, *native_backpatch;
 
-      old_backpatch = b->backpatch;
-      b->backpatch = NULL;
+      old_backpatch = BLOCK_COLD (b)->backpatch;
+      BLOCK_COLD (b)->backpatch = NULL;
 #endif  /* GENERATE_NATIVE_CODE */
 
-      main_size = translate_instruction (m68k_code, (uint16 *)instr_code,
-					 map, map_and_cc[i].live_cc,
-					 (map_and_cc[i].live_cc
-					  & map->cc_may_set),
-					 amf, tbi, b,
-					 &backpatch_request_index
+#ifndef GENERATE_NATIVE_CODE
+      {
+	unsigned long m68k_offset, code_offset;
+
+	m68k_offset = ((const char *) m68k_code
+		       - (const char *) SYN68K_TO_US (b->m68k_start_address));
+	code_offset = num_code_bytes / sizeof (uint16);
+	if (m68k_offset > 0xFFFF || code_offset > 0xFFFF)
+	  entry_points_fit_p = FALSE;
+	entry_point[i].m68k_offset = m68k_offset;
+	entry_point[i].code_offset = code_offset;
+      }
+#endif  /* !GENERATE_NATIVE_CODE */
+
+      /* The jmp ending a recognized jump table becomes opcode 0xBA,
+       * written out below.
+       */
+      if (jump_table_p)
+	{
+	  main_size = 0;
+	  amf[0].valid = amf[1].valid = FALSE;
+	  backpatch_request_index = -1;
+	}
+      else
+	main_size = translate_instruction (m68k_code, (uint16 *)instr_code,
+					   map, map_and_cc[i].live_cc,
+					   (map_and_cc[i].live_cc
+					    & map->cc_may_set),
+					   amf, tbi, b,
+					   &backpatch_request_index
 #ifdef GENERATE_NATIVE_CODE
-					 , &cache_info, &native_p,
-					 try_native_p
+					   , &cache_info, &native_p,
+					   /* Bulk loop opcode must precede
+					    * synthetic code.
+					    */
+					   try_native_p && !(i == 0
+							     && tbi->loop_idiom)
 #endif
-					 );
+					   );
 
       /* Make sure we didn't overrun our temp array. */
       assert (instr_code[sizeof instr_code / sizeof instr_code[0] - 1]
@@ -356,8 +601,8 @@ generate_code (Block *b, TempBlockInfo *tbi, BOOL try_native_p)
 
       if (native_p)
 	{
-	  native_backpatch = b->backpatch;
-	  b->backpatch = old_backpatch;
+	  native_backpatch = BLOCK_COLD (b)->backpatch;
+	  BLOCK_COLD (b)->backpatch = old_backpatch;
 
 	  if (num_code_bytes == NATIVE_START_BYTE_OFFSET)
 	    {
@@ -380,6 +625,10 @@ generate_code (Block *b, TempBlockInfo *tbi, BOOL try_native_p)
 	       * is, we need to throw in a synthetic opcode that will
 	       * jump us to the native code.
 	       */
+	      if (native_coverage_p)
+		num_code_bytes += output_transition_counter
+		  (&code[num_code_bytes],
+		   &BLOCK_COLD (b)->ston_transitions, NULL);
 	      backpatch_add (b, num_code_bytes * 8,
 			     OPCODE_BYTES * 8, FALSE,
 			     OPCODE_BYTES + num_code_bytes, b);
@@ -390,9 +639,10 @@ generate_code (Block *b, TempBlockInfo *tbi, BOOL try_native_p)
 #endif  /* GENERATE_NATIVE_CODE */
 	{
 #ifdef GENERATE_NATIVE_CODE
-	  assert (b->backpatch == NULL);  /* They shouldn't have added any. */
+	  /* They shouldn't have added any. */
+	  assert (BLOCK_COLD (b)->backpatch == NULL);
 	  native_backpatch = NULL;
-	  b->backpatch = old_backpatch;
+	  BLOCK_COLD (b)->backpatch = old_backpatch;
 
 	  if (prev_native_p)
 	    {
@@ -448,20 +698,81 @@ generate_code (Block *b, TempBlockInfo *tbi, BOOL try_native_p)
 	      else
 		ntos_cleanup[num_ntos_cleanup].synth_offset = num_code_bytes;
 
+	      /* Charge the transition to the instruction that forced it.
+	       * The counter itself goes after the block; see below.
+	       */
+	      ntos_cleanup[num_ntos_cleanup].counter_offset = 0;
+	      ntos_cleanup[num_ntos_cleanup].opcode_counter
+		= ((native_coverage_p && try_native_p)
+		   ? native_coverage_fallback_counter (READUW (US_TO_SYN68K
+							       (m68k_code)))
+		   : NULL);
+
 	      ++num_ntos_cleanup;
 	    }
 #endif
+
+#ifndef GENERATE_NATIVE_CODE
+	  /* Count entries into blocks that might profit from being
+	   * retranslated once we know more; see optimize.c.
+	   */
+	  if (i == 0 && b->cc_provisional)
+	    {
+	      Block **operand = (Block **) output_opcode (((uint16 *)
+							   &code[num_code_bytes]),
+							  0x00B7);
+	      *operand = b;
+	      num_code_bytes += OPCODE_BYTES + PTR_BYTES;
+	    }
+#endif
+
+	  /* A recognized copy/fill/compare loop gets an opcode that does
+	   * all but its last iteration in one step; see loopidiom.c.
+	   */
+	  if (i == 0 && tbi->loop_idiom != 0)
+	    {
+	      uint32 *operand = (uint32 *) output_opcode (((uint16 *)
+							   &code[num_code_bytes]),
+							  0x00B5);
+	      *operand = tbi->loop_idiom;
+	      num_code_bytes += ((OPCODE_BYTES + sizeof *operand + PTR_BYTES - 1)
+				 / PTR_BYTES) * PTR_BYTES;
+	    }
+
+	  /* An idle loop counts its spins so it can park; see idle.c.
+	   * Other opcodes may come first, so it is told its Block.
+	   */
+	  if (i == 0 && tbi->idle_loop)
+	    {
+	      Block **operand = (Block **) output_opcode (((uint16 *)
+							   &code[num_code_bytes]),
+							  0x00B6);
+	      *operand = b;
+	      num_code_bytes += OPCODE_BYTES + PTR_BYTES;
+	    }
+
 	  /* Generate instructions to fetch pointer to amode, if necessary. */
 	  for (j = 0; j < 2; j++)
 	    if (amf[j].valid)
 	      {
-		int afetch_size;
-		afetch_size = generate_amode_fetch (((uint16 *)
+		int afetch_size = 0;
+		if (areg_constants.known != 0)
+		  afetch_size = fold_constant_areg (((uint16 *)
 						     &code[num_code_bytes]),
 						    amf[j].m68koperand,
 						    amf[j].amode,
 						    amf[j].reversed,
-						    amf[j].size);
+						    amf[j].size,
+						    &areg_constants);
+		if (afetch_size != 0)
+		  folded_aregs_p = TRUE;
+		else
+		  afetch_size = generate_amode_fetch (((uint16 *)
+						       &code[num_code_bytes]),
+						      amf[j].m68koperand,
+						      amf[j].amode,
+						      amf[j].reversed,
+						      amf[j].size);
 		num_code_bytes += afetch_size * sizeof (uint16);
 	      }
 
@@ -477,6 +788,26 @@ generate_code (Block *b, TempBlockInfo *tbi, BOOL try_native_p)
 				 PTR_BYTES * 8, FALSE, 0, b->child[bln]);
 		}
 	    }
+
+	  /* Write out the jump table dispatch, growing our code space to
+	   * fit it if necessary.
+	   */
+	  if (jump_table_p)
+	    {
+	      while (max_code_bytes - num_code_bytes
+		     < (OPCODE_BYTES + JUMP_TABLE_BYTES (tbi->jump_table.mask)
+			+ 512))
+		{
+		  max_code_bytes *= 2;
+		  code = (uint8 *) xrealloc (code - BLOCK_HEADER_BYTES,
+					     (max_code_bytes
+					      + BLOCK_HEADER_BYTES));
+		  code += BLOCK_HEADER_BYTES;
+		}
+	      num_code_bytes += output_jump_table (&code[num_code_bytes],
+						   m68k_code,
+						   &tbi->jump_table);
+	    }
 	}
 
 #ifdef GENERATE_NATIVE_CODE
@@ -492,8 +823,8 @@ generate_code (Block *b, TempBlockInfo *tbi, BOOL try_native_p)
 	    {
 	      next = n->next;
 	      n->offset_location += 8 * num_code_bytes;
-	      n->next = b->backpatch;
-	      b->backpatch = n;
+	      n->next = BLOCK_COLD (b)->backpatch;
+	      BLOCK_COLD (b)->backpatch = n;
 	    }
 	}
 #endif  /* GENERATE_NATIVE_CODE */
@@ -509,11 +840,14 @@ generate_code (Block *b, TempBlockInfo *tbi, BOOL try_native_p)
       if (max_code_bytes - num_code_bytes < 512)
 	{
 	  max_code_bytes *= 2;
-	  code = (uint8 *) xrealloc (code - PTR_BYTES,
-				     max_code_bytes + PTR_BYTES);
-	  code += PTR_BYTES;  /* Skip over reserved space again. */
+	  code = (uint8 *) xrealloc (code - BLOCK_HEADER_BYTES,
+				     max_code_bytes + BLOCK_HEADER_BYTES);
+	  code += BLOCK_HEADER_BYTES;  /* Skip over reserved space again. */
 	}
 
+      if (track_aregs_p)
+	note_areg_constants (&areg_constants, m68k_code);
+
       /* Move on to the next instruction. */
       m68k_code += tbi->next_instr_offset[i];
 #ifdef GENERATE_NATIVE_CODE
@@ -529,19 +863,69 @@ generate_code (Block *b, TempBlockInfo *tbi, BOOL try_native_p)
       num_code_bytes = p - code;
     }
 
+#ifdef GENERATE_NATIVE_CODE
+  /* Give each counted native->synthetic stub a counter followed by a
+   * jump to where the stub was going.  Only the stub comes here, so
+   * synthetic code entering the block or falling into the same spot
+   * isn't counted.
+   */
+  num_code_bytes = (num_code_bytes + PTR_BYTES - 1) & ~(PTR_BYTES - 1);
+  for (i = 0; i < num_ntos_cleanup; i++)
+    if (ntos_cleanup[i].opcode_counter != NULL)
+      {
+	if (max_code_bytes - num_code_bytes < 512)
+	  {
+	    max_code_bytes *= 2;
+	    code = (uint8 *) xrealloc (code - BLOCK_HEADER_BYTES,
+				       max_code_bytes + BLOCK_HEADER_BYTES);
+	    code += BLOCK_HEADER_BYTES;
+	  }
+	ntos_cleanup[i].counter_offset = num_code_bytes;
+	num_code_bytes += output_transition_counter
+	  (&code[num_code_bytes], &BLOCK_COLD (b)->ntos_transitions,
+	   ntos_cleanup[i].opcode_counter);
+	output_opcode ((uint16 *) &code[num_code_bytes], 0x00B8);
+	num_code_bytes += OPCODE_BYTES + PTR_BYTES;
+      }
+#endif  /* GENERATE_NATIVE_CODE */
+
   /* Copy the code we just created over to the block.  We allocate a little
    * extra space because we prepend all compiled code with the big-endian
    * 68k PC of the first instruction, in case we hit an interrupt when
    * we are about to start the block.  NOTE: to preserve alignment we
    * allocate PTR_WORDS to hold the 68k PC even though we only need to
-   * use 2 (shorts).
+   * use 2 (shorts).  The instruction count used for execution budgets
+   * lives in the rest of the header (see block.h).  The table of
+   * instruction entry points, if any, follows the code.
+   */
+  entry_point_bytes = 0;
+#ifndef GENERATE_NATIVE_CODE
+  /* Code that relies on registers set earlier in the block can't be
+   * entered in the middle.
    */
-  b->compiled_code = (((uint16 *) xrealloc (code - PTR_BYTES,
-					    PTR_BYTES + num_code_bytes))
-		      + PTR_WORDS);
-  b->malloc_code_offset = PTR_WORDS;
+  if (entry_points_fit_p && !folded_aregs_p)
+    entry_point_bytes = tbi->num_68k_instrs * sizeof entry_point[0];
+#endif
+  b->compiled_code = (((uint16 *) xrealloc (code - BLOCK_HEADER_BYTES,
+					    BLOCK_HEADER_BYTES
+					    + num_code_bytes
+					    + entry_point_bytes))
+		      + BLOCK_HEADER_WORDS);
+  b->malloc_code_offset = BLOCK_HEADER_WORDS;
+#ifndef GENERATE_NATIVE_CODE
+  if (entry_point_bytes != 0)
+    {
+      BlockEntryPoint *ep = (BlockEntryPoint *) ((char *) b->compiled_code
+						 + num_code_bytes);
+      memcpy (ep, entry_point, entry_point_bytes);
+      BLOCK_COLD (b)->entry_point = ep;
+    }
+  else
+    BLOCK_COLD (b)->entry_point = NULL;
+#endif
 
   WRITE_LONG (&b->compiled_code[-PTR_WORDS], b->m68k_start_address);
+  BLOCK_NUM_INSTRS (b->compiled_code) = tbi->num_68k_instrs;
 
 #ifdef GENERATE_NATIVE_CODE
   /* Now that the block's code is at a fixed address, patch up any
@@ -549,13 +933,24 @@ generate_code (Block *b, TempBlockInfo *tbi, BOOL try_native_p)
    */
   for (i = 0; i < num_ntos_cleanup; i++)
     {
+      char *synth = (char *)b->compiled_code + ntos_cleanup[i].synth_offset;
+      unsigned long target = ntos_cleanup[i].synth_offset;
+
+      if (ntos_cleanup[i].counter_offset != 0)
+	{
+	  /* Point the 0xB8 after the counter at the synthetic code. */
+	  target = ntos_cleanup[i].counter_offset;
+	  *(const char **) ((char *)b->compiled_code + target
+			    + OPCODE_BYTES + PTR_BYTES + PTR_BYTES
+			    + OPCODE_BYTES) = synth;
+	}
       host_backpatch_native_to_synth_stub (b,
 					   ((host_code_t *)
 					    ((char *)b->compiled_code
 					     + ntos_cleanup[i].stub_offset)),
 					   ((uint32 *)
 					    ((char *)b->compiled_code
-					     + ntos_cleanup[i].synth_offset)));
+					     + target)));
     }
 
 #ifdef SYNCHRONOUS_INTERRUPTS
@@ -578,6 +973,8 @@ generate_code (Block *b, TempBlockInfo *tbi, BOOL try_native_p)
 
 #ifdef GENERATE_NATIVE_CODE
   ASSERT_SAFE (ntos_cleanup);
+#else
+  ASSERT_SAFE (entry_point);
 #endif
 }
 
@@ -696,9 +1093,16 @@ translate_instruction (const uint16 *m68k_code, uint16 *synthetic_code,
 			       map->cc_needed, ccbits_live, ccbits_to_compute,
 			       map->ends_block, block, m68k_code))
     {
+      if (native_coverage_p)
+	native_coverage_note (m68kop, NATIVE_COVERAGE_NATIVE);
       *prev_native_p = TRUE;
       return (char *)hc_scode - (char *)synthetic_code;
     }
+
+  if (native_coverage_p && try_native_p)
+    native_coverage_note (m68kop, ((map->guest_code_descriptor == NULL)
+				   ? NATIVE_COVERAGE_NO_TEMPLATE
+				   : NATIVE_COVERAGE_REJECTED));
   }
 #endif
 
@@ -816,7 +1220,8 @@ translate_instruction (const uint16 *m68k_code, uint16 *synthetic_code,
    */
   if ((m68kop & 0xF0C0) == 0x80C0     /* divs/divu    ditto */
       || (m68kop & 0xFFC0) == 0x4C40     /* divsl/divul  ditto */
-      || (m68kop & 0xFF28) == 0xF428
+      || ((m68kop & 0xFF00) == 0xF400    /* cinv/cpush? */
+	  && (m68kop & 0x18) != 0)
       || (map->next_block_dynamic
 	  && ((m68kop >> 12) == 0xA             /* a-line trap? */
 	      || m68kop == 0x4E73               /* rte? */
@@ -876,6 +1281,294 @@ translate_instruction (const uint16 *m68k_code, uint16 *synthetic_code,
 }
 
 
+/* If a memory indirect amode (whose extension word is EXTWORD) fetches
+ * its pointer from POINTER_ADDRESS in ROM, reads the pointer now and
+ * generates the equivalent base suppressed (bd) or (bd,Xn) amode, which
+ * is much cheaper than opcode 0xB2.  Returns the number of 16-bit words
+ * generated, or 0 if the amode can't be folded.
+ */
+static int
+fold_rom_memory_indirect (uint16 *code, syn68k_addr_t pointer_address,
+			  int32 outer_displacement, uint16 extword,
+			  BOOL reversed)
+{
+  uint16 *scode = code;
+
+  /* Pre-indexing makes the pointer's address depend on a register. */
+  if (!(extword & 0x40) && !(extword & 0x4))
+    return 0;
+  if (!rom_range_p (pointer_address, 4))
+    return 0;
+
+  /* Pretend this is (bd,Xn) or (bd) with the base suppressed. */
+  if (extword & 0x40)
+    scode = output_opcode (scode, 0xA0 + (reversed * 9) + 8);
+  else
+    scode = output_opcode (scode, (0x58 - 0x12 - 0x24
+				   + (0x12 << (extword >> 15))
+				   + (0x24 << ((extword >> 11) & 1))
+				   + (reversed * 9) + 8));
+  WRITESL_UNSWAPPED (scode, READSL (pointer_address) + outer_displacement);
+  scode += 2;
+
+  if (!(extword & 0x40))
+    {
+      *(uint32 *)(scode    ) = (extword >> 12) & 7;
+      *(uint32 *)(scode + 2) = (extword >> 9) & 3;
+      return ROUND_UP (scode + 4 - code);
+    }
+  return ROUND_UP (scode - code);
+}
+
+
+/* If the address register used by AMODE is in AC, generates the fetch
+ * for the resulting constant address as an absolute long or a base
+ * suppressed indexed amode, or folds a memory indirect amode whose
+ * pointer lives in ROM.  Returns the number of 16-bit words generated,
+ * or 0 if the amode can't be folded.
+ */
+static int
+fold_constant_areg (uint16 *code, const uint16 *m68koperand, int amode,
+		    BOOL reversed, int size, const AregConstants *ac)
+{
+  int mode = amode >> 3, reg = amode & 7;
+  uint16 *scode = code;
+  uint32 addr;
+
+  if (mode < 2 || mode > 6 || !(ac->known & (1 << reg)))
+    return 0;
+  addr = ac->value[reg];
+
+  switch (mode) {
+  case 2:
+  case 3:
+    break;
+  case 4:
+    addr -= size;
+    break;
+  case 5:
+    addr += READSW (US_TO_SYN68K (m68koperand));
+    break;
+  case 6:
+    {
+      uint16 extword = READUW (US_TO_SYN68K (m68koperand));
+
+      if ((extword & 0x100) == 0)
+	addr += ((int8 *) m68koperand)[1];
+      else if (!(extword & 0x80))
+	{
+	  switch ((extword >> 4) & 0x3) {
+	  case 2:
+	    addr += READSW (US_TO_SYN68K (m68koperand + 1));
+	    m68koperand += 1;
+	    break;
+	  case 3:
+	    addr += READSL (US_TO_SYN68K (m68koperand + 1));
+	    m68koperand += 2;
+	    break;
+	  default:
+	    break;
+	  }
+
+	  /* Memory indirect, through a pointer at a constant address. */
+	  if ((extword & 0xF) != 0x0)
+	    {
+	      int32 outer_displacement;
+
+	      switch (extword & 0x3) {
+	      case 2:
+		outer_displacement = READSW (US_TO_SYN68K (m68koperand + 1));
+		break;
+	      case 3:
+		outer_displacement = READSL (US_TO_SYN68K (m68koperand + 1));
+		break;
+	      default:
+		outer_displacement = 0;
+		break;
+	      }
+	      return fold_rom_memory_indirect (scode, addr, outer_displacement,
+					       extword, reversed);
+	    }
+
+	  if (extword & 0x40)   /* Index suppressed? */
+	    {
+	      scode = output_opcode (scode, 0x56 + reversed);
+	      WRITEUL_UNSWAPPED (scode, addr);
+	      return ROUND_UP (scode + 2 - code);
+	    }
+	}
+      else
+	return 0;
+
+      /* Keep the index, with "a8" (== 0) as the base. */
+      scode = output_opcode (scode, (0x58 - 0x12 - 0x24
+				     + (0x12 << (extword >> 15))
+				     + (0x24 << ((extword >> 11) & 1))
+				     + (reversed * 9) + 8));
+      WRITEUL_UNSWAPPED (scode, addr);
+      scode += 2;
+      *(uint32 *)(scode    ) = (extword >> 12) & 7;
+      *(uint32 *)(scode + 2) = (extword >> 9) & 3;
+      return ROUND_UP (scode + 4 - code);
+    }
+  }
+
+  scode = output_opcode (scode, 0x56 + reversed);
+  WRITEUL_UNSWAPPED (scode, addr);
+  return ROUND_UP (scode + 2 - code);
+}
+
+
+/* Returns a mask of the registers among a0-a6 that the postincrement
+ * or predecrement amode AMODE modifies.
+ */
+static inline uint8
+amode_areg_writes (int amode)
+{
+  int mode = amode >> 3, reg = amode & 7;
+  return (mode == 3 || mode == 4) ? (1 << reg) & 0x7F : 0;
+}
+
+
+/* Updates AC to reflect the effects of the m68k instruction at
+ * M68K_CODE.  Any instruction we don't understand forgets everything;
+ * those that load a constant (lea with a known address, movea #imm)
+ * or add one to a known register keep it known.
+ */
+static void
+note_areg_constants (AregConstants *ac, const uint16 *m68k_code)
+{
+  uint16 op = READUW (US_TO_SYN68K (m68k_code));
+  syn68k_addr_t ext = US_TO_SYN68K (&m68k_code[1]);
+  int ea = op & 63, mode = (op >> 3) & 7, reg = op & 7;
+  int an = (op >> 9) & 7, opmode = (op >> 6) & 7;
+  uint8 kill;
+
+  switch (op >> 12) {
+  case 0x0:
+    /* Immediate ops and bit ops only write their ea. */
+    if ((op & 0x100) || (op & 0xF00) == 0x800
+	|| ((op & 0xC0) != 0xC0 && (op & 0xE00) != 0xE00))
+      kill = amode_areg_writes (ea);
+    else
+      kill = 0x7F;
+    break;
+
+  case 0x1:
+  case 0x2:
+  case 0x3:
+    kill = (amode_areg_writes (ea)
+	    | amode_areg_writes (((op >> 3) & 0x38) | an));
+    if (((op >> 6) & 7) == 1 && an != 7)   /* movea? */
+      {
+	if ((op & 0xF1FF) == 0x207C)   /* movea.l #imm,an */
+	  {
+	    ac->value[an] = READUL (ext);
+	    ac->known |= 1 << an;
+	    return;
+	  }
+	if ((op & 0xF1FF) == 0x307C)   /* movea.w #imm,an */
+	  {
+	    ac->value[an] = READSW (ext);
+	    ac->known |= 1 << an;
+	    return;
+	  }
+	kill |= 1 << an;
+      }
+    break;
+
+  case 0x4:
+    if ((op & 0xF1C0) == 0x41C0)   /* lea <ea>,an */
+      {
+	BOOL known_p = TRUE;
+	uint32 addr = 0;
+
+	if (ea == 0x38)
+	  addr = READSW (ext);
+	else if (ea == 0x39)
+	  addr = READUL (ext);
+	else if (ea == 0x3A)
+	  addr = ext + READSW (ext);
+	else if ((mode == 2 || mode == 5) && (ac->known & (1 << reg)))
+	  addr = ac->value[reg] + ((mode == 5) ? READSW (ext) : 0);
+	else
+	  known_p = FALSE;
+
+	if (known_p && an != 7)
+	  {
+	    ac->value[an] = addr;
+	    ac->known |= 1 << an;
+	    return;
+	  }
+	kill = (1 << an) & 0x7F;
+      }
+    else if (((op & 0xF900) == 0x4000 && (op & 0xC0) != 0xC0)  /* negx, clr,
+								 * neg, not */
+	     || ((op & 0xFF00) == 0x4A00 && (op & 0xC0) != 0xC0)   /* tst */
+	     || ((op & 0xFFC0) == 0x4840 && mode != 1)      /* swap, pea */
+	     || (op & 0xFFB8) == 0x4880                     /* ext */
+	     || (op & 0xFFF8) == 0x49C0)                    /* extb */
+      kill = amode_areg_writes (ea);
+    else
+      kill = 0x7F;
+    break;
+
+  case 0x5:
+    if ((op & 0xC0) == 0xC0)   /* scc, dbcc or trapcc */
+      kill = amode_areg_writes (ea);
+    else if (mode == 1)        /* addq/subq #q,an */
+      {
+	uint32 q = (an == 0) ? 8 : an;
+	ac->value[reg] += (op & 0x100) ? -q : q;
+	return;
+      }
+    else
+      kill = amode_areg_writes (ea);
+    break;
+
+  case 0x7:                    /* moveq */
+    kill = 0;
+    break;
+
+  case 0x8:
+  case 0x9:
+  case 0xB:
+  case 0xC:
+  case 0xD:
+    if ((opmode & 3) == 3)     /* divu/divs, suba, cmpa, mulu/muls, adda */
+      {
+	kill = amode_areg_writes (ea);
+	if ((op >> 12) == 0x9 || (op >> 12) == 0xD)
+	  {
+	    if (ea == 0x3C && an != 7)   /* adda/suba #imm,an */
+	      {
+		uint32 imm = ((opmode == 3) ? (uint32) READSW (ext)
+			      : READUL (ext));
+		ac->value[an] += ((op >> 12) == 0x9) ? -imm : imm;
+		return;
+	      }
+	    kill |= (1 << an) & 0x7F;
+	  }
+      }
+    else if (opmode >= 4 && mode <= 1)   /* abcd, addx, cmpm, exg, etc. */
+      kill = ((1 << an) | (1 << reg)) & 0x7F;
+    else
+      kill = amode_areg_writes (ea);
+    break;
+
+  case 0xE:
+    kill = ((op & 0xC0) == 0xC0) ? amode_areg_writes (ea) : 0;
+    break;
+
+  default:
+    kill = 0x7F;
+    break;
+  }
+
+  ac->known &= ~kill;
+}
+
+
 /* Generates synthetic code to compute the value for an addressing mode
  * and store it in cpu_state.amode_p or cpu_state.reversed_amode_p;
  * Returns the number of 16-bit words generated (historical; should be
@@ -965,9 +1658,7 @@ generate_amode_fetch (uint16 *code, const uint16 *m68koperand, int amode,
       else  /* Memory indirect pre-indexed or memory indirect post-indexed. */
 	{
 	  int32 base_displacement, outer_displacement;
-
-	  /* Memory indirect pre- or post-indexed. */
-	  scode = output_opcode (scode, 0xB2);
+	  int folded_size;
 
 	  /* Get base displacement size. */
 	  switch ((extword >> 4) & 0x3) {
@@ -997,6 +1688,18 @@ generate_amode_fetch (uint16 *code, const uint16 *m68koperand, int amode,
 	    break;
 	  }
 
+	  /* With the base suppressed, the pointer's address is constant. */
+	  if (extword & 0x80)
+	    {
+	      folded_size = fold_rom_memory_indirect (scode, base_displacement,
+						      outer_displacement,
+						      extword, reversed);
+	      if (folded_size != 0)
+		return folded_size;
+	    }
+
+	  /* Memory indirect pre- or post-indexed. */
+	  scode = output_opcode (scode, 0xB2);
 	  WRITEUL_UNSWAPPED (scode,     base_displacement);
 	  WRITEUL_UNSWAPPED (scode + 2, outer_displacement);
 	  
@@ -1100,9 +1803,7 @@ generate_amode_fetch (uint16 *code, const uint16 *m68koperand, int amode,
       else  /* PC relative mem indir pre-indexed or mem indir post-indexed. */
 	{
 	  int32 base_displacement, outer_displacement;
-
-	  /* Memory indirect pre- or post-indexed. */
-	  scode = output_opcode (scode, 0xB2);
+	  int folded_size;
 
 	  if (extword & 0x80)
 	    base_displacement = 0;            /* Suppress PC base */
@@ -1136,6 +1837,14 @@ generate_amode_fetch (uint16 *code, const uint16 *m68koperand, int amode,
 	    break;
 	  }
 
+	  folded_size = fold_rom_memory_indirect (scode, base_displacement,
+						  outer_displacement,
+						  extword, reversed);
+	  if (folded_size != 0)
+	    return folded_size;
+
+	  /* Memory indirect pre- or post-indexed. */
+	  scode = output_opcode (scode, 0xB2);
 	  WRITEUL_UNSWAPPED (scode,     base_displacement);
 	  WRITEUL_UNSWAPPED (scode + 2, outer_displacement);
 	  scode += 4;
@@ -1201,7 +1910,7 @@ compute_maps_and_ccs (Block *b, MapAndCC *m, const TempBlockInfo *tbi)
       m68k_code -= tbi->next_instr_offset[i];
 
       /* Grab first struct in opcode mapping sequence. */
-      map = &opcode_map_info[opcode_map_index[READUW (US_TO_SYN68K (m68k_code))]];
+      map = OPCODE_MAP_INFO (READUW (US_TO_SYN68K (m68k_code)), m68k_code);
 
       /* Grab the parity of this sequence and max cc bits computable. */
       parity = map->sequence_parity;
@@ -1240,15 +1949,15 @@ make_artificial_block (Block *parent, syn68k_addr_t m68k_address,
   if (parent != NULL)
     block_add_parent (b, parent);
 
-  b->malloc_code_offset = PTR_WORDS;
-  code = (((uint16 *) xcalloc (PTR_WORDS
+  b->malloc_code_offset = BLOCK_HEADER_WORDS;
+  code = (((uint16 *) xcalloc (BLOCK_HEADER_WORDS
 #ifdef GENERATE_NATIVE_CODE
 			       + NATIVE_START_BYTE_OFFSET / sizeof (uint16)
 			       + NATIVE_PREAMBLE_WORDS
 #endif
 			       + extra_words,
 			       sizeof (uint16)))
-	  + PTR_WORDS);  /* Skip over prepended m68k address. */
+	  + BLOCK_HEADER_WORDS);  /* Skip over prepended block header. */
   WRITE_LONG (&code[-PTR_WORDS], m68k_address);
   b->compiled_code = code;
   b->checksum = compute_block_checksum (b);
@@ -1284,3 +1993,90 @@ make_artificial_block (Block *parent, syn68k_addr_t m68k_address,
 
   return b;
 }
+
+
+#ifndef GENERATE_NATIVE_CODE
+/* If M68K_ADDRESS is the start of some instruction in the middle of an
+ * existing, up to date block, this creates and returns an alias block
+ * for that address whose code just jumps into the existing block's code
+ * at that instruction.  Otherwise it returns NULL.  The alias claims the
+ * existing block as its only child, so destroying that block destroys
+ * the alias too.  Since we can't know what cc bits the middle of the
+ * block relies on, the alias demands all of them.
+ */
+static Block *
+make_alias_block (Block *parent, syn68k_addr_t m68k_address)
+{
+  const BlockEntryPoint *ep;
+  Block *host, *b;
+  BOOL host_immortal;
+  uint32 offset;
+  long lo, hi, mid;
+  uint16 *code;
+
+  host = page_dir_lookup (m68k_address);
+  if (host != NULL && host->alias)
+    host = host->child[0];
+  if (host == NULL || host->compiled_code == NULL
+      || !BLOCK_CHECKSUM_CURRENT (host))
+    return NULL;
+  ep = BLOCK_COLD (host)->entry_point;
+  if (ep == NULL)
+    return NULL;
+
+  /* Binary search for the instruction, skipping the first, which
+   * would be the block itself.
+   */
+  offset = m68k_address - host->m68k_start_address;
+  lo = 1;
+  hi = (long) BLOCK_NUM_INSTRS (host->compiled_code) - 1;
+  while (lo <= hi)
+    {
+      mid = (lo + hi) / 2;
+      if (ep[mid].m68k_offset < offset)
+	lo = mid + 1;
+      else
+	hi = mid - 1;
+    }
+  if (lo >= BLOCK_NUM_INSTRS (host->compiled_code)
+      || ep[lo].m68k_offset != offset)
+    return NULL;
+
+  /* Keep the host from being reclaimed while we allocate. */
+  host_immortal = host->immortal;
+  host->immortal = TRUE;
+
+  b = block_new ();
+  b->m68k_start_address = m68k_address;
+  b->m68k_code_length   = host->m68k_code_length - offset;
+  b->cc_may_not_set     = ALL_CCS;
+  b->cc_needed          = ALL_CCS;
+  b->alias              = TRUE;
+  b->rom                = host->rom;
+
+  b->malloc_code_offset = BLOCK_HEADER_WORDS;
+  code = (((uint16 *) xmalloc (BLOCK_HEADER_BYTES + OPCODE_BYTES
+			       + PTR_BYTES))
+	  + BLOCK_HEADER_WORDS);
+  WRITE_LONG (&code[-PTR_WORDS], m68k_address);
+  BLOCK_NUM_INSTRS (code) = BLOCK_NUM_INSTRS (host->compiled_code) - lo;
+  *(const uint16 **) output_opcode (code, 0xB8)
+    = host->compiled_code + ep[lo].code_offset;
+  b->compiled_code = code;
+#ifdef CHECKSUM_BLOCKS
+  b->checksum = compute_block_checksum (b);
+#endif
+
+  block_add_child (b, host);
+  block_add_parent (host, b);
+  if (parent != NULL)
+    block_add_parent (b, parent);
+  host->immortal = host_immortal;
+
+  hash_insert (b);
+  page_dir_insert (b);
+  death_queue_enqueue (b);
+
+  return b;
+}
+#endif  /* !GENERATE_NATIVE_CODE */
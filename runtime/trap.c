@@ -1,11 +1,22 @@
 #include "trap.h"
 #include "callback.h"
+#include "alloc.h"
 #include <stdio.h>
 #include <stdlib.h>
 
 /* Pointer to the array of trap vectors. */
 uint32 *trap_vector_array;
 
+typedef struct {
+  callback_handler_t func;
+  void *arg;
+} ALineHandlerInfo;
+
+/* Host handlers for individual A-line opcodes, indexed by the low 12
+ * bits of the opcode.  NULL until someone installs one.
+ */
+static ALineHandlerInfo *a_line_handler;
+
 void
 trap_init ()
 {
@@ -39,6 +50,65 @@ trap_remove_handler (unsigned trap_number)
 }
 
 
+/* Installs FUNC as the handler for every A-line opcode from FIRST_OPCODE
+ * through LAST_OPCODE, inclusive.  As long as the A-line vector still
+ * points to our own trap 10 callback, those traps call FUNC directly,
+ * without building an exception frame or switching to supervisor mode.
+ * FUNC gets the address of the trap instruction and returns the address
+ * at which to resume execution (normally the address of the trap + 2).
+ */
+void
+syn68k_a_line_trap_install_handler (uint16 first_opcode, uint16 last_opcode,
+				    callback_handler_t func,
+				    void *arbitrary_argument)
+{
+  unsigned i;
+
+  if (a_line_handler == NULL)
+    a_line_handler = (ALineHandlerInfo *) xcalloc (0x1000,
+						   sizeof a_line_handler[0]);
+
+  for (i = first_opcode & 0xFFF; i <= (last_opcode & 0xFFFU); i++)
+    {
+      a_line_handler[i].func = func;
+      a_line_handler[i].arg  = arbitrary_argument;
+    }
+}
+
+
+void
+syn68k_a_line_trap_remove_handler (uint16 first_opcode, uint16 last_opcode)
+{
+  unsigned i;
+
+  if (a_line_handler != NULL)
+    for (i = first_opcode & 0xFFF; i <= (last_opcode & 0xFFFU); i++)
+      a_line_handler[i].func = NULL;
+}
+
+
+/* Called for every A-line trap.  If there's a host handler for this
+ * opcode and nobody has patched the A-line vector, call the handler
+ * directly; otherwise take a real A-line exception.  Returns the m68k
+ * address at which to continue.
+ */
+syn68k_addr_t
+a_line_trap_dispatch (syn68k_addr_t trap_pc)
+{
+  if (a_line_handler != NULL)
+    {
+      const ALineHandlerInfo *h = &a_line_handler[READUW (trap_pc) & 0xFFF];
+
+      if (h->func != NULL
+	  && (READUL (cpu_state.vbr + (10 << 2))
+	      == cpu_state.trap_handler_info[10].callback_address))
+	return h->func (trap_pc, h->arg);
+    }
+
+  return trap_direct (10, trap_pc, 0);
+}
+
+
 uint32
 trap_forwarded (uint32 m68k_address, void *arg)
 {
@@ -78,8 +78,8 @@ begin_generating_code ()
   opcode_map_info[NO_MAP].next_block_dynamic = TRUE;
   map_info_opcode_name[0] = "(reserved)";
 
-  /* Opcodes 0 through 0xB4 are reserved. */
-  for (i = 0; i <= 0xB4; i++)
+  /* Opcodes 0 through 0xBA are reserved. */
+  for (i = 0; i <= 0xBA; i++)
     synthetic_opcode_taken[i] = OPCODE_TAKEN;
 
   /* We've used one opcode map, and should now be on odd parity for the
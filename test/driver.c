@@ -128,7 +128,8 @@ test_instruction (uint32 times_to_test, const TestInfo *info, DriverMode mode)
 #endif
   uint16 pre_crc = 0, mem_crc = 0, reg_crc = 0, cc_crc = 0;
 
-  my_random_seed = compute_crc(info->name, strlen(info->name), 0);
+  my_random_seed = compute_crc((unsigned char *) info->name,
+                               strlen(info->name), 0);
   memset(mem, 0, MEM_SIZE+CODE_SIZE);
   memset(&cpu_state, 0, sizeof(cpu_state));
   /* NOTE: cc_crc is the old reg_crc, where we include condition codes.
@@ -0,0 +1,6 @@
+#ifndef _testruntime_h_
+#define _testruntime_h_
+
+extern int test_runtime (void);
+
+#endif  /* Not _testruntime_h_ */
@@ -5,7 +5,9 @@
 #include "crc.h"
 #include "testrt.h"
 #include "testqsort.h"
+#include "testruntime.h"
 #include "setup.h"
+#include "../runtime/include/callback.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -13,6 +15,36 @@
 #ifndef EXIT_SUCCESS
 #define EXIT_SUCCESS 0
 #endif
+#ifndef EXIT_FAILURE
+#define EXIT_FAILURE 1
+#endif
+
+
+/* Maps the test memory at 68k address 0.  With 64 bit pointers, the
+ * callback window and TRAP_VECTORS get a 68k address range of their own.
+ */
+static void
+map_test_memory (uint32 *trap_vectors)
+{
+#if SIZEOF_CHAR_P == 4 && !defined (TWENTYFOUR_BIT_ADDRESSING)
+  ROMlib_offset = (uintptr_t) mem;
+#else
+  uint64 lo = (uint64) callback_dummy_address_space;
+  uint64 hi = (uint64) &callback_dummy_address_space[MAX_CALLBACKS
+						       + CALLBACK_SLOP];
+
+  if ((uint64) trap_vectors < lo)
+    lo = (uint64) trap_vectors;
+  if ((uint64) &trap_vectors[64] > hi)
+    hi = (uint64) &trap_vectors[64];
+  lo &= ~(uint64) 0xFFF;
+
+  ROMlib_offsets[0] = (uint64) mem;
+  ROMlib_sizes[0] = MEM_SIZE + CODE_SIZE;
+  ROMlib_offsets[1] = lo - (1ULL << (ADDRESS_BITS - OFFSET_TABLE_BITS));
+  ROMlib_sizes[1] = hi - lo;
+#endif
+}
 
 
 int
@@ -21,16 +53,17 @@ main (int argc, char *argv[])
   static uint32 trap_vectors[64];
   uint32 count = 10000;
   int i;
-  int native_p;
+  int native_p, runtime_p;
 
   native_p = 1;
+  runtime_p = 0;
 
 #ifdef NeXT
   malloc_debug (31);   /* Just to be safe. */
 #endif
 
   mem = malloc (MEM_SIZE + CODE_SIZE);
-  ROMlib_offset = (uintptr_t) mem;
+  map_test_memory (trap_vectors);
 
   /* Set up default values for command line switches. */
   test_only_non_cc_variants = 0;
@@ -52,21 +85,27 @@ main (int argc, char *argv[])
 	test_only_non_cc_variants = 1;
       else if (strcmp (argv[i], "-notnative") == 0)
 	native_p = 0;
+      else if (strcmp (argv[i], "-runtime") == 0)
+	runtime_p = 1;
       else if (atoi (argv[i]) != 0)
 	count = atoi (argv[i]);
       else
 	{
 #ifdef mc68000
-	  fprintf (stderr, "Usage: %s [test count] [-crc] [-noncc] [-notnative]\n",
-		   argv[0]);
+	  fprintf (stderr, "Usage: %s [test count] [-crc] [-noncc] [-notnative] "
+		   "[-runtime]\n", argv[0]);
 #else
-	  fprintf (stderr, "Usage: %s [test count] [-noncc] [-notnative]\n",
-		   argv[0]);
+	  fprintf (stderr, "Usage: %s [test count] [-noncc] [-notnative] "
+		   "[-runtime]\n", argv[0]);
 #endif
 	  exit (-1);
 	}
     }
 
+  /* The runtime tests set up their own memory and emulator. */
+  if (runtime_p)
+    return (test_runtime () == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+
   /* Initialize stuff. */
   initialize_68k_emulator (NULL, native_p, trap_vectors, 0);
 
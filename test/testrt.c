@@ -1,11 +1,12 @@
-/* This file tests the range tree.  It has to include private header files
- * belonging to the runtime system because there is no official outside
- * interface to blocks or to the range tree; don't do this at home.
+/* This file tests the page directory.  It has to include private header
+ * files belonging to the runtime system because there is no official
+ * outside interface to blocks or to the page directory; don't do this at
+ * home.
  */
 
 #define DEBUG
 #include "../runtime/include/block.h"
-#include "../runtime/include/rangetree.h"
+#include "../runtime/include/pagedir.h"
 #include "../runtime/include/destroyblock.h"
 #include "../runtime/include/hash.h"
 #include "../runtime/include/deathqueue.h"
@@ -46,10 +47,7 @@ test_rangetree ()
 	printf ("%d...", i), fflush (stdout);
 
       if (i % 5 == 0)
-	{
-	  destroy_blocks (0, ~0);
-/*	  range_tree_verify (); */
-	}
+	destroy_blocks (0, ~0);
 
       b = block_new ();
 
@@ -58,19 +56,19 @@ test_rangetree ()
 	{
 	  b->m68k_start_address = rand () & ~1;
 	}
-      while (range_tree_find_first_at_or_after (b->m68k_start_address) != NULL);
+      while (hash_lookup (b->m68k_start_address) != NULL);
 
       /* Add this block to the end of the death queue. */
       death_queue_enqueue (b);
 
       b->num_children = 0;
 
-      range_tree_insert (b);
+      page_dir_insert (b);
       hash_insert (b);
 
       if (random () & 1)
 	{
-	  b2 = range_tree_find_first_at_or_after (random ());
+	  b2 = page_dir_lookup (random () & ~1);
 	  if (b2 != NULL && !b2->immortal)
 	    {
 	      b->child[0] = b2;
@@ -79,7 +77,7 @@ test_rangetree ()
 
 	      if (random () & 1)
 		{
-		  b2 = range_tree_find_first_at_or_after (random ());
+		  b2 = page_dir_lookup (random () & ~1);
 		  if (b2 != NULL && b2 != b->child[0] && !b2->immortal)
 		    {
 		      b->child[1] = b2;
@@ -89,7 +87,5 @@ test_rangetree ()
 		}
 	    }
 	}
-
-/*      range_tree_verify (); */
     }
 }
@@ -0,0 +1,1092 @@
+/* This file checks the results of running small 68k routines through
+ * parts of the runtime that the instruction battery doesn't reach.
+ * Each test writes its code at its own address, runs it, and checks
+ * registers and memory afterwards.  Like testrt.c, some tests include
+ * private header files belonging to the runtime system; don't do this
+ * at home.
+ */
+
+#include "syn68k_public.h"
+#include "../runtime/include/callback.h"
+#include "../runtime/include/fpu.h"
+#include "../runtime/include/hash.h"
+#include "../runtime/include/jumptable.h"
+#include "../runtime/include/pagedir.h"
+#include "../runtime/include/sample.h"
+#include "testruntime.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RT_MEM_SIZE (1024 * 1024)
+#define STACK_TOP 0xF0000
+
+static uint8 *rt_mem;
+static uint32 trap_vectors[64];
+static int num_failures;
+
+#define CHECK(expr) check ((expr), #expr, __LINE__)
+
+
+static void
+check (int ok, const char *what, int line)
+{
+  if (!ok)
+    {
+      printf ("testruntime.c:%d: check failed: %s\n", line, what);
+      ++num_failures;
+    }
+}
+
+
+static void
+write_word (syn68k_addr_t addr, uint16 w)
+{
+  rt_mem[addr]     = w >> 8;
+  rt_mem[addr + 1] = w;
+}
+
+
+static uint32
+read_long (syn68k_addr_t addr)
+{
+  return ((rt_mem[addr] << 24) | (rt_mem[addr + 1] << 16)
+	  | (rt_mem[addr + 2] << 8) | rt_mem[addr + 3]);
+}
+
+
+/* Copies NUM_WORDS words of 68k code to ADDR. */
+static void
+put_code (syn68k_addr_t addr, const uint16 *code, int num_words)
+{
+  int i;
+
+  for (i = 0; i < num_words; i++)
+    write_word (addr + 2 * i, code[i]);
+}
+
+
+/* Runs the 68k subroutine at ADDR until it returns. */
+static void
+run_code (syn68k_addr_t addr)
+{
+  EM_A7 = STACK_TOP;
+  CALL_EMULATOR (addr);
+}
+
+
+/* Copy, fill, clear and compare loops run in bulk; see loopidiom.h.
+ * Their results must match running them an iteration at a time,
+ * including overlapping copies and the dbf count edge cases.
+ */
+static void
+test_loop_idioms (void)
+{
+  static const uint16 copy_long[] = {
+    0x22D8,		/* loop: move.l (a0)+,(a1)+	*/
+    0x51C8, 0xFFFC,	/*	 dbf d0,loop		*/
+    0x4E75		/*	 rts			*/
+  };
+  static const uint16 copy_byte[] = {
+    0x12D8, 0x51C8, 0xFFFC, 0x4E75	/* move.b (a0)+,(a1)+ ...	*/
+  };
+  static const uint16 copy_word[] = {
+    0x32D8, 0x51C8, 0xFFFC, 0x4E75	/* move.w (a0)+,(a1)+ ...	*/
+  };
+  static const uint16 fill_long[] = {
+    0x22C1, 0x51C8, 0xFFFC, 0x4E75	/* move.l d1,(a1)+ ...		*/
+  };
+  static const uint16 clear_word[] = {
+    0x4259, 0x51C8, 0xFFFC, 0x4E75	/* clr.w (a1)+ ...		*/
+  };
+  static const uint16 compare_byte[] = {
+    0xB308,		/* loop: cmpm.b (a0)+,(a1)+	*/
+    0x56C8, 0xFFFC,	/*	 dbne d0,loop		*/
+    0x4E75
+  };
+  int i, ok;
+
+  put_code (0x1000, copy_long, 4);
+  put_code (0x1010, copy_byte, 4);
+  put_code (0x1020, copy_word, 4);
+  put_code (0x1030, fill_long, 4);
+  put_code (0x1040, clear_word, 4);
+  put_code (0x1050, compare_byte, 4);
+
+  /* A plain copy leaves the high word of the counter alone. */
+  for (i = 0; i < 256; i++)
+    rt_mem[0x20000 + i] = i;
+  EM_A0 = 0x20000;
+  EM_A1 = 0x30000;
+  EM_D0 = 0x1234003F;
+  run_code (0x1000);
+  CHECK (!memcmp (&rt_mem[0x20000], &rt_mem[0x30000], 256));
+  CHECK (EM_A0 == 0x20100 && EM_A1 == 0x30100);
+  CHECK (EM_D0 == 0x1234FFFF);
+
+  /* Copying forwards onto itself smears the first byte along, unlike
+   * memmove.
+   */
+  EM_A0 = 0x20000;
+  EM_A1 = 0x20001;
+  EM_D0 = 15;
+  run_code (0x1010);
+  for (i = 0, ok = 1; i <= 16; i++)
+    ok = ok && rt_mem[0x20000 + i] == 0;
+  CHECK (ok);
+  CHECK (rt_mem[0x20011] == 0x11);
+  CHECK (EM_A0 == 0x20010 && EM_A1 == 0x20011);
+
+  /* Copying backwards onto itself shifts the bytes down. */
+  for (i = 0; i < 32; i++)
+    rt_mem[0x20100 + i] = i;
+  EM_A0 = 0x20101;
+  EM_A1 = 0x20100;
+  EM_D0 = 15;
+  run_code (0x1010);
+  for (i = 0, ok = 1; i < 16; i++)
+    ok = ok && rt_mem[0x20100 + i] == i + 1;
+  CHECK (ok);
+  CHECK (rt_mem[0x20110] == 16);
+
+  /* A count of 0 runs once; a count of 0xFFFF runs 65536 times. */
+  for (i = 0; i < 0x20000; i++)
+    rt_mem[0x40000 + i] = i * 7 + 1;
+  memset (&rt_mem[0x60000], 0, 4);
+  EM_A0 = 0x40000;
+  EM_A1 = 0x60000;
+  EM_D0 = 0xABCD0000;
+  run_code (0x1020);
+  CHECK (EM_A0 == 0x40002 && EM_A1 == 0x60002 && EM_D0 == 0xABCDFFFF);
+  CHECK (read_long (0x60000) == 0x01080000);
+  EM_A0 = 0x40000;
+  EM_A1 = 0x60000;
+  EM_D0 = 0xFFFF;
+  run_code (0x1020);
+  CHECK (EM_A0 == 0x60000 && EM_A1 == 0x80000 && EM_D0 == 0xFFFF);
+  CHECK (!memcmp (&rt_mem[0x40000], &rt_mem[0x60000], 0x20000));
+
+  /* Fill and clear. */
+  memset (&rt_mem[0x80000], 0x55, 64);
+  EM_A1 = 0x80000;
+  EM_D0 = 9;
+  EM_D1 = 0xDEADBEEF;
+  run_code (0x1030);
+  CHECK (read_long (0x80000) == 0xDEADBEEF
+	 && read_long (0x80024) == 0xDEADBEEF
+	 && read_long (0x80028) == 0x55555555);
+  CHECK (EM_A1 == 0x80028 && (EM_D0 & 0xFFFF) == 0xFFFF);
+  EM_A1 = 0x80002;
+  EM_D0 = 3;
+  run_code (0x1040);
+  CHECK (read_long (0x80000) == 0xDEAD0000
+	 && read_long (0x80004) == 0
+	 && read_long (0x80008) == 0x0000BEEF);
+  CHECK (EM_A1 == 0x8000A);
+
+  /* A compare stops just past the first mismatch, with the counter
+   * not decremented for it, or runs out with Z set.
+   */
+  memcpy (&rt_mem[0x90000], "hello world!", 12);
+  memcpy (&rt_mem[0x91000], "hello wOrld!", 12);
+  EM_A0 = 0x90000;
+  EM_A1 = 0x91000;
+  EM_D0 = 11;
+  run_code (0x1050);
+  CHECK (EM_A0 == 0x90008 && EM_A1 == 0x91008 && (EM_D0 & 0xFFFF) == 4);
+  CHECK (cpu_state.ccnz != 0);
+  rt_mem[0x91007] = 'o';
+  EM_A0 = 0x90000;
+  EM_A1 = 0x91000;
+  EM_D0 = 11;
+  run_code (0x1050);
+  CHECK (EM_A0 == 0x9000C && EM_A1 == 0x9100C
+	 && (EM_D0 & 0xFFFF) == 0xFFFF);
+  CHECK (cpu_state.ccnz == 0);
+}
+
+
+static int callback_calls;
+static void *callback_last_arg;
+
+
+static syn68k_addr_t
+count_callback (syn68k_addr_t addr, void *arg)
+{
+  ++callback_calls;
+  callback_last_arg = arg;
+  return POPADDR ();
+}
+
+
+static syn68k_addr_t
+other_callback (syn68k_addr_t addr, void *arg)
+{
+  callback_calls += 1000;
+  callback_last_arg = arg;
+  return POPADDR ();
+}
+
+
+/* Installs and removes far more callbacks than the old fixed table of
+ * 4352 held.  Freed slots must be handed out again, and a reused slot
+ * must run its new handler even if the old one had been translated.
+ */
+static void
+test_callback_churn (void)
+{
+  enum { NUM_CALLBACKS = 20000 };
+  static syn68k_addr_t addr[NUM_CALLBACKS];
+  syn68k_addr_t lo, hi;
+  int i, ok;
+
+  for (i = 0; i < NUM_CALLBACKS; i++)
+    addr[i] = callback_install (count_callback, (void *) (intptr_t) i);
+
+  lo = hi = addr[0];
+  for (i = 0, ok = 1; i < NUM_CALLBACKS; i++)
+    {
+      ok = (ok && callback_function (addr[i]) == count_callback
+	    && callback_argument (addr[i]) == (void *) (intptr_t) i
+	    && (i == 0 || addr[i] != addr[i - 1]));
+      if (addr[i] < lo)
+	lo = addr[i];
+      if (addr[i] > hi)
+	hi = addr[i];
+    }
+  CHECK (ok);
+  CHECK (hi - lo == 2 * (NUM_CALLBACKS - 1));
+
+  callback_calls = 0;
+  run_code (addr[0]);
+  run_code (addr[4352]);
+  run_code (addr[NUM_CALLBACKS - 1]);
+  CHECK (callback_calls == 3);
+  CHECK (callback_last_arg == (void *) (intptr_t) (NUM_CALLBACKS - 1));
+  CHECK (EM_A7 == STACK_TOP);
+
+  /* Free every other slot and fill them again. */
+  for (i = 0; i < NUM_CALLBACKS; i += 2)
+    callback_remove (addr[i]);
+  CHECK (callback_function (addr[0]) == NULL);
+  CHECK (callback_argument (addr[4352]) == NULL);
+  for (i = 0; i < NUM_CALLBACKS; i += 2)
+    addr[i] = callback_install (other_callback, (void *) (intptr_t) -i);
+
+  for (i = 0, ok = 1; i < NUM_CALLBACKS; i++)
+    ok = (ok && addr[i] >= lo && addr[i] <= hi
+	  && callback_function (addr[i]) == ((i & 1)
+					     ? count_callback
+					     : other_callback));
+  CHECK (ok);
+
+  callback_calls = 0;
+  run_code (addr[4352]);
+  CHECK (callback_calls == 1000);
+  CHECK (callback_last_arg == (void *) (intptr_t) -4352);
+  run_code (addr[4353]);
+  CHECK (callback_calls == 1001);
+  CHECK (callback_last_arg == (void *) (intptr_t) 4353);
+
+  for (i = 0; i < NUM_CALLBACKS; i++)
+    callback_remove (addr[i]);
+}
+
+
+/* Once the whole callback window is in use, callback_install has to
+ * fail with 0 rather than abort, and work again when a slot is freed.
+ */
+static void
+test_callback_exhaustion (void)
+{
+  syn68k_addr_t *addr, freed;
+  int i, n;
+
+  addr = malloc (MAX_CALLBACKS * sizeof addr[0]);
+  for (n = 0; n < MAX_CALLBACKS; n++)
+    if ((addr[n] = callback_install (count_callback, NULL)) == 0)
+      break;
+  CHECK (n > 0 && n < MAX_CALLBACKS);
+  CHECK (callback_install (count_callback, NULL) == 0);
+
+  /* Removing the 0 from a failed install must not touch anything. */
+  callback_remove (0);
+
+  freed = addr[n / 2];
+  callback_remove (freed);
+  addr[n / 2] = callback_install (other_callback, NULL);
+  CHECK (addr[n / 2] == freed);
+  CHECK (callback_function (freed) == other_callback);
+  CHECK (callback_install (count_callback, NULL) == 0);
+
+  for (i = 0; i < n; i++)
+    callback_remove (addr[i]);
+  free (addr);
+}
+
+
+/* Runs a counting loop in slices of a few instructions or blocks.  Each
+ * slice must stop at the head of the loop or at the final rts, with the
+ * registers matching the number of iterations done so far, and resuming
+ * must finish the job exactly as one uninterrupted run would.
+ */
+static void
+test_budget_slices (void)
+{
+  static const uint16 count_loop[] = {
+    0x7064,		/*	 moveq #100,d0		*/
+    0x5281,		/* loop: addq.l #1,d1		*/
+    0x5482,		/*	 addq.l #2,d2		*/
+    0x51C8, 0xFFFA,	/*	 dbf d0,loop		*/
+    0x4E75		/*	 rts			*/
+  };
+  static const struct { int64 max_blocks, max_instructions; } budget[] = {
+    { 1000, 10 }, { 1, 1000 }, { 1, 1 }
+  };
+  syn68k_interpret_status_t status;
+  const uint16 *code;
+  int i, slices, ok;
+
+  put_code (0x1100, count_loop, 6);
+
+  for (i = 0; i < (int) (sizeof budget / sizeof budget[0]); i++)
+    {
+      EM_D1 = EM_D2 = 0;
+      EM_A7 = STACK_TOP;
+      PUSHADDR (MAGIC_EXIT_EMULATOR_ADDRESS);
+      code = hash_lookup_code_and_create_if_needed (0x1100);
+      slices = 0;
+      ok = 1;
+      while ((status = syn68k_interpret_code_with_budget
+	      (code, budget[i].max_blocks, budget[i].max_instructions))
+	     == SYN68K_INTERPRET_BUDGET_EXHAUSTED)
+	{
+	  syn68k_addr_t pc = cpu_state.resume_address;
+
+	  ++slices;
+	  if (pc == 0x1102)
+	    ok = (ok && EM_D2 == 2 * EM_D1
+		  && (EM_D0 & 0xFFFF) == 100 - EM_D1);
+	  else if (pc == 0x110A)
+	    ok = ok && EM_D1 == 101 && (EM_D0 & 0xFFFF) == 0xFFFF;
+	  else
+	    ok = 0;
+	  code = hash_lookup_code_and_create_if_needed (pc);
+	}
+      CHECK (ok);
+      CHECK (slices > 0);
+      CHECK (status == SYN68K_INTERPRET_DONE);
+      CHECK (EM_D1 == 101 && EM_D2 == 202 && EM_A7 == STACK_TOP);
+    }
+}
+
+
+/* Returns 1 iff page_dir_find_intersecting reports exactly the blocks a
+ * scan of every address in our memory finds overlapping [LOW, HIGH],
+ * each once and in increasing order.
+ */
+static int
+intersecting_blocks_ok (syn68k_addr_t low, syn68k_addr_t high)
+{
+  syn68k_addr_t *addrs, a;
+  unsigned long n, i;
+  int ok;
+
+  n = page_dir_find_intersecting (low, high, &addrs);
+  ok = (n == 0) == (addrs == NULL);
+  for (a = i = 0; ok && a < RT_MEM_SIZE; a += 2)
+    {
+      Block *b = hash_lookup (a);
+
+      if (b != NULL && a <= high
+	  && a + b->m68k_code_length - 1 >= low)
+	ok = i < n && addrs[i++] == a;
+    }
+  ok = ok && i == n;
+  free (addrs);
+  return ok;
+}
+
+
+/* Blocks have to be found, and destroyed, through every page their code
+ * touches, including blocks straddling a page boundary.
+ */
+static void
+test_page_directory (void)
+{
+  static const uint16 straddle[] = {
+    0x7001,			/* moveq #1,d0	*/
+    0x4E71, 0x4E71, 0x4E71,	/* nop (3)	*/
+    0x5280,			/* addq.l #1,d0	*/
+    0x4E75			/* rts		*/
+  };
+  static const uint16 single[] = {
+    0x7205,			/* moveq #5,d1	*/
+    0x4E75			/* rts		*/
+  };
+  syn68k_addr_t *addrs;
+
+  put_code (0xAFF8, straddle, 6);
+  put_code (0xC000, single, 2);
+  run_code (0xAFF8);
+  run_code (0xC000);
+  CHECK (EM_D0 == 2 && EM_D1 == 5);
+  CHECK (hash_lookup (0xAFF8) != NULL && hash_lookup (0xC000) != NULL);
+
+  CHECK (page_dir_find_intersecting (0xB000, 0xB001, &addrs) == 1
+	 && addrs[0] == 0xAFF8);
+  free (addrs);
+  CHECK (page_dir_find_intersecting (0xA000, 0xCFFF, &addrs) == 2
+	 && addrs[0] == 0xAFF8 && addrs[1] == 0xC000);
+  free (addrs);
+  CHECK (intersecting_blocks_ok (0, RT_MEM_SIZE - 1));
+  CHECK (intersecting_blocks_ok (0xAFF0, 0xAFF7));
+  CHECK (intersecting_blocks_ok (0xB003, 0xB003));
+  CHECK (intersecting_blocks_ok (0xB004, 0xBFFF));
+  CHECK (intersecting_blocks_ok (0xC002, 0xC002));
+
+  /* Touching only the second page destroys the straddling block. */
+  write_word (0xB000, 0x5480);	/* addq.l #2,d0 */
+  CHECK (destroy_blocks (0xB000, 2) == 1);
+  CHECK (hash_lookup (0xAFF8) == NULL && hash_lookup (0xC000) != NULL);
+  CHECK (page_dir_find_intersecting (0xA000, 0xBFFF, &addrs) == 0
+	 && addrs == NULL);
+  CHECK (intersecting_blocks_ok (0, RT_MEM_SIZE - 1));
+  run_code (0xAFF8);
+  CHECK (EM_D0 == 3);
+
+  CHECK (destroy_blocks (0xBF00, 0x100) == 0);
+  CHECK (destroy_blocks (0xC000, 0) == 0);
+  CHECK (hash_lookup (0xC000) != NULL);
+  CHECK (destroy_blocks (0xBF00, 0x1000) == 1);
+  CHECK (hash_lookup (0xC000) == NULL);
+  CHECK (intersecting_blocks_ok (0, RT_MEM_SIZE - 1));
+}
+
+
+/* Returns 1 iff the runtime trace so far contains an event named NAME,
+ * and empties the trace.
+ */
+static int
+traced_p (const char *name)
+{
+  char line[256];
+  FILE *fp;
+  int found;
+
+  fp = tmpfile ();
+  if (fp == NULL)
+    return 0;
+  syn68k_trace_write (fp);
+  rewind (fp);
+  for (found = 0; !found && fgets (line, sizeof line, fp) != NULL; )
+    found = strstr (line, name) != NULL;
+  fclose (fp);
+  return found;
+}
+
+
+/* An idle loop must park the host once it has spun often enough, even
+ * when its block starts with other bookkeeping opcodes.  This loop's
+ * block is translated while the block after it is still pending, which
+ * makes it cc_provisional.
+ */
+static void
+test_idle_loops (void)
+{
+  static const uint16 idle_loop[] = {
+    0x4A78, 0x0F80,	/* loop: tst.w $0F80.w		*/
+    0x67FA,		/*	 beq.s loop		*/
+    0x5382,		/*	 subq.l #1,d2		*/
+    0x66F6,		/*	 bne.s loop		*/
+    0x4E75		/*	 rts			*/
+  };
+  const uint16 *code;
+  Block *b;
+
+  put_code (0xF000, idle_loop, 6);
+  write_word (0x0F80, 0);
+
+  syn68k_trace_start (1000);
+  syn68k_idle_loop_set_threshold (5, 0);
+  EM_A7 = STACK_TOP;
+  PUSHADDR (MAGIC_EXIT_EMULATOR_ADDRESS);
+  code = hash_lookup_code_and_create_if_needed (0xF000);
+  b = hash_lookup (0xF000);
+  CHECK (b != NULL && b->cc_provisional);
+  CHECK (syn68k_interpret_code_with_budget (code, 50, 1000000)
+	 == SYN68K_INTERPRET_BUDGET_EXHAUSTED);
+  CHECK (cpu_state.resume_address == 0xF000);
+  CHECK (traced_p ("idle_park"));
+
+  /* Leaving the loop must still work. */
+  write_word (0x0F80, 1);
+  EM_D2 = 1;
+  interpret_code (hash_lookup_code_and_create_if_needed (0xF000));
+  CHECK (EM_A7 == STACK_TOP && EM_D2 == 0);
+
+  syn68k_idle_loop_set_threshold (0, 0);
+  syn68k_trace_stop ();
+}
+
+
+/* Runs the switch at ADDR with d0 as its index and returns the d1 the
+ * selected case leaves behind.
+ */
+static uint32
+run_switch (syn68k_addr_t addr, uint32 index)
+{
+  EM_D0 = index;
+  EM_D1 = 0;
+  run_code (addr);
+  return EM_D1;
+}
+
+
+/* Switches dispatched through a table of word offsets and straight into
+ * a table of branches must both reach the right case, translating each
+ * case only when it first runs, and must cope with the table being
+ * modified or the cases being destroyed behind their backs.
+ */
+static void
+test_jump_tables (void)
+{
+  static const uint16 offset_switch[] = {
+    0x303B, 0x0806,	/*	  move.w (table,pc,d0.w),d0	*/
+    0x4EFB, 0x0002,	/*	  jmp (table,pc,d0.w)		*/
+    0x0006, 0x000A,	/* table: dc.w case0-table,...	*/
+    0x000E,
+    0x720A, 0x4E75,	/* case0: moveq #10,d1 ; rts	*/
+    0x720B, 0x4E75,	/* case1: moveq #11,d1 ; rts	*/
+    0x720C, 0x4E75	/* case2: moveq #12,d1 ; rts	*/
+  };
+  static const uint16 bra_switch[] = {
+    0x4EFB, 0x0002,	/*	  jmp (table,pc,d0.w)		*/
+    0x6000, 0x000A,	/* table: bra.w case0			*/
+    0x6000, 0x000A,	/*	  bra.w case1			*/
+    0x6000, 0x000A,	/*	  bra.w case2			*/
+    0x7214, 0x4E75,	/* case0: moveq #20,d1 ; rts	*/
+    0x7215, 0x4E75,	/* case1: moveq #21,d1 ; rts	*/
+    0x7216, 0x4E75	/* case2: moveq #22,d1 ; rts	*/
+  };
+  static const uint16 stray_case[] = {
+    0x7263, 0x4E75	/* moveq #99,d1 ; rts		*/
+  };
+  JumpTableInfo jt;
+
+  put_code (0xD000, offset_switch, 13);
+  put_code (0xE000, bra_switch, 14);
+  put_code (0xD100, stray_case, 2);
+
+  CHECK (jump_table_recognize ((const uint16 *) &rt_mem[0xD004],
+			       (const uint16 *) &rt_mem[0xD000], &jt)
+	 && jt.num_targets == 3);
+  CHECK (jump_table_recognize ((const uint16 *) &rt_mem[0xE000], NULL, &jt)
+	 && jt.num_targets == 3);
+
+  /* Only the cases that run get translated. */
+  CHECK (run_switch (0xD000, 0) == 10);
+  CHECK (hash_lookup (0xD00E) != NULL && hash_lookup (0xD012) == NULL);
+  CHECK (run_switch (0xD000, 2) == 11);
+  CHECK (run_switch (0xD000, 4) == 12);
+  CHECK (run_switch (0xD000, 0) == 10);
+  CHECK (hash_lookup (0xD012) != NULL && hash_lookup (0xD016) != NULL);
+
+  CHECK (run_switch (0xE000, 0) == 20);
+  CHECK (run_switch (0xE000, 4) == 21);
+  CHECK (run_switch (0xE000, 8) == 22);
+  CHECK (run_switch (0xE000, 4) == 21);
+
+  /* An entry pointing outside the table falls back to a lookup. */
+  write_word (0xD00A, 0xD100 - 0xD008);
+  CHECK (run_switch (0xD000, 2) == 99);
+  write_word (0xD00A, 0x000A);
+  CHECK (run_switch (0xD000, 2) == 11);
+
+  /* Destroyed cases are translated again rather than reached through
+   * stale slots.
+   */
+  write_word (0xD012, 0x721B);	/* moveq #27,d1 */
+  destroy_blocks (0xD012, 2);
+  CHECK (run_switch (0xD000, 2) == 27);
+  CHECK (run_switch (0xD000, 0) == 10);
+  CHECK (run_switch (0xD000, 4) == 12);
+}
+
+
+/* With checksum flushes deferred, translating a block that links to
+ * out of date blocks must check them first, so that code which changed
+ * since the flush is translated again rather than reached through the
+ * link.  Here the block being translated links to a changed block both
+ * directly and through an unchanged one.
+ */
+static void
+test_deferred_checksums (void)
+{
+  static const uint16 parent[] = {
+    0x4A80,		/*	 tst.l d0		*/
+    0x6700, 0x01FC,	/*	 beq.w $7200		*/
+    0x6000, 0x00F8	/*	 bra.w $7100		*/
+  };
+  static const uint16 changed[] = {
+    0x7201,		/*	 moveq #1,d1		*/
+    0x4E75		/*	 rts			*/
+  };
+  static const uint16 unchanged[] = {
+    0x5282,		/*	 addq.l #1,d2		*/
+    0x6000, 0xFEFC	/*	 bra.w $7100		*/
+  };
+
+  put_code (0x7000, parent, 5);
+  put_code (0x7100, changed, 2);
+  put_code (0x7200, unchanged, 3);
+  EM_D2 = 0;
+  run_code (0x7200);
+  CHECK (EM_D1 == 1 && EM_D2 == 1);
+
+  syn68k_set_checksum_flush_deferred (1);
+  destroy_blocks_with_checksum_mismatch (0, ~0);
+  write_word (0x7100, 0x7202);	/* moveq #2,d1 */
+
+  CHECK (hash_lookup (0x7000) == NULL);
+  CHECK (run_switch (0x7000, 0) == 2);
+  CHECK (EM_D2 == 2);
+  CHECK (run_switch (0x7000, 1) == 2);
+  CHECK (EM_D2 == 2);
+  CHECK (hash_lookup (0x7000) != NULL && hash_lookup (0x7200) != NULL);
+  CHECK (intersecting_blocks_ok (0, RT_MEM_SIZE - 1));
+
+  syn68k_set_checksum_flush_deferred (0);
+}
+
+
+/* Pretranslation must only take a prologue for an entry point where
+ * nothing falls into it, and only when its frame looks sane.
+ */
+static void
+test_pretranslate (void)
+{
+  static const uint16 code[] = {
+    0x4E75,		/*	 rts			*/
+    0x7001,		/*	 moveq #1,d0		*/
+    0x4E56, 0xFFFC,	/*	 link a6,#-4		*/
+    0x4E5E,		/*	 unlk a6		*/
+    0x4E75,		/*	 rts			*/
+    0x4E56, 0xFFF8,	/*	 link a6,#-8		*/
+    0x4E5E,		/*	 unlk a6		*/
+    0x4E75,		/*	 rts			*/
+    0x4E56, 0x0003,	/*	 link a6,#3		*/
+    0x4E75		/*	 rts			*/
+  };
+
+  put_code (0x7D00, code, 13);
+  CHECK (syn68k_pretranslate (0x7D00, sizeof code) == 2);
+  CHECK (hash_lookup (0x7D00) != NULL && hash_lookup (0x7D0C) != NULL);
+  CHECK (hash_lookup (0x7D04) == NULL && hash_lookup (0x7D14) == NULL);
+}
+
+
+/* A snapshot must bring back the guest's registers and translate its
+ * code again up front, but leave callback stubs alone, since the
+ * callbacks they belonged to may be gone.  This goes through a file to
+ * cover saving and loading as well.
+ */
+static void
+test_snapshots (void)
+{
+  static const uint16 code[] = {
+    0x7203,		/*	 moveq #3,d1		*/
+    0x5282,		/*	 addq.l #1,d2		*/
+    0x4E75		/*	 rts			*/
+  };
+  syn68k_snapshot_t *snap, *loaded;
+  syn68k_addr_t cb;
+  FILE *fp;
+
+  put_code (0x7400, code, 3);
+  cb = callback_install (count_callback, NULL);
+  run_code (0x7400);
+  run_code (cb);
+  CHECK (hash_lookup (0x7400) != NULL && hash_lookup (cb) != NULL);
+
+  EM_D5 = 0x12345678;
+  EM_A3 = 0x9ABCDEF0;
+  snap = syn68k_snapshot_take ();
+  fp = tmpfile ();
+  CHECK (fp != NULL && syn68k_snapshot_save (snap, fp) == 0);
+  if (fp == NULL)
+    {
+      syn68k_snapshot_free (snap);
+      return;
+    }
+  rewind (fp);
+  loaded = syn68k_snapshot_load (fp);
+  fclose (fp);
+  CHECK (loaded != NULL);
+
+  callback_remove (cb);
+  destroy_blocks (0x7400, 6);
+  EM_D5 = EM_A3 = 0;
+  CHECK (hash_lookup (0x7400) == NULL && hash_lookup (cb) == NULL);
+
+  if (loaded != NULL)
+    {
+      syn68k_snapshot_restore (loaded);
+      CHECK (EM_D5 == 0x12345678 && EM_A3 == 0x9ABCDEF0);
+      CHECK (hash_lookup (0x7400) != NULL);
+      CHECK (hash_lookup (cb) == NULL);
+      syn68k_snapshot_free (loaded);
+    }
+
+  EM_D5 = 0;
+  destroy_blocks (0x7400, 6);
+  syn68k_snapshot_restore (snap);
+  CHECK (EM_D5 == 0x12345678 && hash_lookup (0x7400) != NULL);
+  CHECK (hash_lookup (cb) == NULL);
+  syn68k_snapshot_free (snap);
+
+  EM_D1 = EM_D2 = 0;
+  run_code (0x7400);
+  CHECK (EM_D1 == 3 && EM_D2 == 1);
+}
+
+
+/* Stores D at ADDR in 68k byte order. */
+static void
+write_double (syn68k_addr_t addr, double d)
+{
+  uint64 bits;
+  int i;
+
+  memcpy (&bits, &d, sizeof bits);
+  for (i = 0; i < 8; i++)
+    rt_mem[addr + i] = bits >> (56 - 8 * i);
+}
+
+
+static double
+read_double (syn68k_addr_t addr)
+{
+  uint64 bits;
+  double d;
+  int i;
+
+  for (i = 0, bits = 0; i < 8; i++)
+    bits = (bits << 8) | rt_mem[addr + i];
+  memcpy (&d, &bits, sizeof d);
+  return d;
+}
+
+
+static int fline_calls;
+static syn68k_addr_t fline_pc;
+
+
+/* F-line handler that skips the trapping instruction, which is
+ * (intptr_t) SKIP bytes long.
+ */
+static syn68k_addr_t
+fline_handler (syn68k_addr_t pc, void *skip)
+{
+  syn68k_addr_t resume = pc + (intptr_t) skip;
+
+  ++fline_calls;
+  fline_pc = pc;
+  write_word (EM_A7 + 2, resume >> 16);
+  write_word (EM_A7 + 4, resume);
+  return MAGIC_RTE_ADDRESS;
+}
+
+
+/* Runs the forms fpu.c translates inline: moves between memory and the
+ * FP registers in each format, the basic arithmetic, fcmp against every
+ * fbcc predicate, fmovem in both directions and extended precision
+ * round trips.  None of them may take the F-line trap.  Immediate
+ * operands aren't translated inline, so those have to trap.
+ */
+static void
+test_fpu (void)
+{
+  static const uint16 moves[] = {
+    0xF218, 0x5400,	/* fmove.d (a0)+,fp0	*/
+    0xF218, 0x4480,	/* fmove.s (a0)+,fp1	*/
+    0xF218, 0x4100,	/* fmove.l (a0)+,fp2	*/
+    0xF218, 0x5180,	/* fmove.w (a0)+,fp3	*/
+    0xF218, 0x5A00,	/* fmove.b (a0)+,fp4	*/
+    0xF221, 0x7400,	/* fmove.d fp0,-(a1)	*/
+    0xF221, 0x6480,	/* fmove.s fp1,-(a1)	*/
+    0xF201, 0x6100,	/* fmove.l fp2,d1	*/
+    0xF202, 0x7180,	/* fmove.w fp3,d2	*/
+    0xF212, 0x7A00,	/* fmove.b fp4,(a2)	*/
+    0x4E75		/* rts			*/
+  };
+  static const uint16 arith[] = {
+    0xF200, 0x4000,	/* fmove.l d0,fp0	*/
+    0xF201, 0x4022,	/* fadd.l d1,fp0	*/
+    0xF202, 0x4023,	/* fmul.l d2,fp0	*/
+    0xF210, 0x5428,	/* fsub.d (a0),fp0	*/
+    0xF211, 0x4420,	/* fdiv.s (a1),fp0	*/
+    0xF212, 0x7400,	/* fmove.d fp0,(a2)	*/
+    0xF200, 0x0520,	/* fdiv.x fp1,fp2	*/
+    0xF200, 0x04A3,	/* fmul.x fp1,fp1	*/
+    0xF200, 0x04A8,	/* fsub.x fp1,fp1	*/
+    0x4E75		/* rts			*/
+  };
+  static const uint16 movem[] = {
+    0xF220, 0xE025,	/* fmovem.x fp0/fp2/fp5,-(a0)	*/
+    0x2248,		/* movea.l a0,a1		*/
+    0xF219, 0xD052,	/* fmovem.x (a1)+,fp1/fp3/fp6	*/
+    0x4E75		/* rts				*/
+  };
+  static const uint16 extended[] = {
+    0xF210, 0x6800,	/* fmove.x fp0,(a0)	*/
+    0xF210, 0x4880,	/* fmove.x (a0),fp1	*/
+    0x4E75		/* rts			*/
+  };
+  static const uint16 immediate[] = {
+    0x7000,		/*	 moveq #0,d0		*/
+    0xF23C, 0x5400,	/*	 fmove.d #1.5,fp0	*/
+    0x3FF8, 0x0000, 0x0000, 0x0000,
+    0x7007,		/*	 moveq #7,d0		*/
+    0x4E75		/*	 rts			*/
+  };
+  /* fp0 for "fp0 = fp1", "fp0 > fp1", "fp0 < fp1" and unordered.  The
+   * fbcc predicates are laid out so that bit N of the low four bits
+   * says whether to branch in case N.
+   */
+  static const double cmp_lhs[4] = { 2.0, 3.0, 1.0, NAN };
+  static const double round_trip[] = {
+    1.0 / 3.0, -0.0, 1e300, -1e-300, 4.9e-324, INFINITY
+  };
+  static const uint8 one_point_five[12] = {
+    0x3F, 0xFF, 0x00, 0x00, 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+  };
+  static const uint8 minus_two_point_two_five[12] = {
+    0xC0, 0x00, 0x00, 0x00, 0x90, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+  };
+  int cond, rel, i, ok;
+
+  syn68k_set_fpu_emulation (1);
+  fline_calls = 0;
+  trap_install_handler (11, fline_handler, (void *) (intptr_t) 12);
+
+  /* Moves in every format but packed. */
+  put_code (0x7A00, moves, sizeof moves / sizeof moves[0]);
+  write_double (0x98000, -1.25);
+  write_word (0x98008, 0x3F40);		/* 0.75 as a single. */
+  write_word (0x9800A, 0x0000);
+  write_word (0x9800C, 0xFFFE);		/* -100000 */
+  write_word (0x9800E, 0x7960);
+  write_word (0x98010, 0xFFF9);		/* -7 */
+  rt_mem[0x98012] = 0xFD;		/* -3 */
+  EM_A0 = 0x98000;
+  EM_A1 = 0x98100;
+  EM_A2 = 0x98200;
+  EM_D2 = 0x12340000;
+  run_code (0x7A00);
+  CHECK (cpu_state.fpreg[0] == -1.25 && cpu_state.fpreg[1] == 0.75
+	 && cpu_state.fpreg[2] == -100000 && cpu_state.fpreg[3] == -7
+	 && cpu_state.fpreg[4] == -3);
+  CHECK (EM_A0 == 0x98013 && EM_A1 == 0x980F4);
+  CHECK (read_double (0x980F8) == -1.25 && read_long (0x980F4) == 0x3F400000);
+  CHECK (EM_D1 == (uint32) -100000 && EM_D2 == 0x1234FFF9);
+  CHECK (rt_mem[0x98200] == 0xFD);
+
+  /* ((3 + 4) * 5 - 0.5) / 2 */
+  put_code (0x7A40, arith, sizeof arith / sizeof arith[0]);
+  write_double (0x98300, 0.5);
+  write_word (0x98308, 0x4000);		/* 2.0 as a single. */
+  write_word (0x9830A, 0x0000);
+  EM_D0 = 3;
+  EM_D1 = 4;
+  EM_D2 = 5;
+  EM_A0 = 0x98300;
+  EM_A1 = 0x98308;
+  EM_A2 = 0x98310;
+  cpu_state.fpreg[1] = 4.0;
+  cpu_state.fpreg[2] = 1.0;
+  run_code (0x7A40);
+  CHECK (cpu_state.fpreg[0] == 17.25 && read_double (0x98310) == 17.25);
+  CHECK (cpu_state.fpreg[2] == 0.25);
+  CHECK (cpu_state.fpreg[1] == 0.0 && (cpu_state.fpsr & FPSR_CC_Z));
+
+  /* Every predicate, signalling or not, after each outcome of fcmp. */
+  for (cond = 0; cond < 32; cond++)
+    {
+      uint16 code[] = {
+	0xF200, 0x0438,		/*	 fcmp.x fp1,fp0		*/
+	0xF280 | cond, 0x0006,	/*	 fbcc taken		*/
+	0x7000, 0x4E75,		/*	 moveq #0,d0 ; rts	*/
+	0x7001, 0x4E75		/* taken: moveq #1,d0 ; rts	*/
+      };
+
+      put_code (0x7800 + 16 * cond, code, sizeof code / sizeof code[0]);
+    }
+  for (rel = 0, ok = 1; rel < 4; rel++)
+    for (cond = 0; cond < 32; cond++)
+      {
+	cpu_state.fpreg[0] = cmp_lhs[rel];
+	cpu_state.fpreg[1] = 2.0;
+	EM_D0 = 0xFF;
+	run_code (0x7800 + 16 * cond);
+	ok = ok && EM_D0 == (((cond & 0xF) >> rel) & 1);
+      }
+  CHECK (ok);
+
+  /* fmovem stores the lowest numbered register at the lowest address
+   * either way round, though the register masks are reversed.
+   */
+  put_code (0x7A80, movem, sizeof movem / sizeof movem[0]);
+  cpu_state.fpreg[0] = 1.5;
+  cpu_state.fpreg[2] = -2.25;
+  cpu_state.fpreg[5] = 1e100;
+  cpu_state.fpreg[1] = cpu_state.fpreg[3] = cpu_state.fpreg[6] = 0;
+  EM_A0 = 0x98440;
+  run_code (0x7A80);
+  CHECK (EM_A0 == 0x98440 - 36 && EM_A1 == 0x98440);
+  CHECK (!memcmp (&rt_mem[0x9841C], one_point_five, 12));
+  CHECK (!memcmp (&rt_mem[0x98428], minus_two_point_two_five, 12));
+  CHECK (cpu_state.fpreg[1] == 1.5 && cpu_state.fpreg[3] == -2.25
+	 && cpu_state.fpreg[6] == 1e100);
+
+  /* Doubles, including zeroes, denormals and infinities, must come
+   * back from extended precision unchanged.
+   */
+  put_code (0x7AC0, extended, sizeof extended / sizeof extended[0]);
+  for (i = 0, ok = 1; i < (int) sizeof round_trip / sizeof round_trip[0]; i++)
+    {
+      cpu_state.fpreg[0] = round_trip[i];
+      cpu_state.fpreg[1] = 42.0;
+      EM_A0 = 0x98500;
+      run_code (0x7AC0);
+      ok = ok && !memcmp ((const void *) &cpu_state.fpreg[1], &round_trip[i],
+			  sizeof (double));
+    }
+  CHECK (ok);
+  cpu_state.fpreg[0] = NAN;
+  run_code (0x7AC0);
+  CHECK (isnan (cpu_state.fpreg[1]));
+  CHECK (fline_calls == 0);
+
+  put_code (0x7B00, immediate, sizeof immediate / sizeof immediate[0]);
+  cpu_state.fpreg[0] = 0.0;
+  run_code (0x7B00);
+  CHECK (fline_calls == 1 && fline_pc == 0x7B02);
+  CHECK (EM_D0 == 7 && cpu_state.fpreg[0] == 0.0);
+
+  trap_remove_handler (11);
+  syn68k_set_fpu_emulation (0);
+}
+
+
+/* Returns nonzero iff the samples taken so far charge anything to
+ * the block at ADDR.
+ */
+static int
+sampled_p (syn68k_addr_t addr)
+{
+  char line[256], name[32];
+  FILE *fp;
+  int found;
+
+  fp = tmpfile ();
+  if (fp == NULL)
+    return 0;
+  syn68k_sample_write (fp);
+  rewind (fp);
+  sprintf (name, "m68k;0x%08lX ", (unsigned long) addr);
+  for (found = 0; !found && fgets (line, sizeof line, fp) != NULL; )
+    found = !strncmp (line, name, strlen (name));
+  fclose (fp);
+  return found;
+}
+
+
+/* Ticks of the sampling profiler are charged at the next block
+ * transition, so a busy loop must show up under its own address, and
+ * the runtime's busy bracketing must balance.
+ */
+static void
+test_sampling (void)
+{
+  static const uint16 code[] = {
+    0x5380,		/* loop: subq.l #1,d0	*/
+    0x66FC,		/*	 bne.s loop	*/
+    0x4E75		/*	 rts		*/
+  };
+  int i;
+
+  put_code (0x7C00, code, 3);
+  if (syn68k_sample_start (1000) != 0)
+    return;   /* Not supported on this host. */
+  for (i = 0; i < 100 && !sampled_p (0x7C00); i++)
+    {
+      EM_D0 = 1000000;
+      run_code (0x7C00);
+    }
+  syn68k_sample_stop ();
+  CHECK (sampled_p (0x7C00));
+  CHECK (sample_busy_depth == 0);
+}
+
+
+/* Gives the tests their own 68k memory at address 0.  The callback
+ * window and the trap vectors are in our data segment, so they have to
+ * be mapped as well.
+ */
+static void
+setup_memory (void)
+{
+  rt_mem = calloc (RT_MEM_SIZE, 1);
+#if SIZEOF_CHAR_P == 4 && !defined (TWENTYFOUR_BIT_ADDRESSING)
+  ROMlib_offset = (uintptr_t) rt_mem;
+#else
+  {
+    uint64 lo = (uint64) callback_dummy_address_space;
+    uint64 hi = (uint64) &callback_dummy_address_space[MAX_CALLBACKS
+							 + CALLBACK_SLOP];
+
+    if ((uint64) trap_vectors < lo)
+      lo = (uint64) trap_vectors;
+    if ((uint64) &trap_vectors[64] > hi)
+      hi = (uint64) &trap_vectors[64];
+    lo &= ~(uint64) 0xFFF;
+
+    ROMlib_offsets[0] = (uint64) rt_mem;
+    ROMlib_sizes[0] = RT_MEM_SIZE;
+    ROMlib_offsets[1] = lo - (1ULL << (ADDRESS_BITS - OFFSET_TABLE_BITS));
+    ROMlib_sizes[1] = hi - lo;
+  }
+#endif
+}
+
+
+/* Sets up the emulator, runs every runtime test, and returns the number
+ * of checks that failed.
+ */
+int
+test_runtime ()
+{
+  setup_memory ();
+  initialize_68k_emulator (NULL, 0, trap_vectors, 0);
+
+  test_loop_idioms ();
+  test_callback_churn ();
+  test_callback_exhaustion ();
+  test_budget_slices ();
+  test_page_directory ();
+  test_jump_tables ();
+  test_idle_loops ();
+  test_deferred_checksums ();
+  test_pretranslate ();
+  test_snapshots ();
+  test_fpu ();
+  test_sampling ();
+
+  if (num_failures == 0)
+    printf ("All runtime tests passed.\n");
+  else
+    printf ("%d runtime check(s) failed.\n", num_failures);
+  return num_failures;
+}
@@ -1534,6 +1534,16 @@ TEST (bfchg_reg, ALL_CCS, 2, WONT_CHANGE_MEMORY, NO_LIMIT)
 }
 
 
+/* The _reg_imm tests use a constant offset and width, which is what
+ * the native code handles in the register forms.
+ */
+TEST (bfchg_reg_imm, ALL_CCS, 2, WONT_CHANGE_MEMORY, NO_LIMIT)
+{
+  code[0] = R ("1110101011000rrr");
+  code[1] = randint (0, 65535) & ~0x0820;
+}
+
+
 TEST (bfchg_ind, ALL_CCS, 2, MIGHT_CHANGE_MEMORY, NO_LIMIT)
 {
   randomize_regs (0, 7, -250 * 8, 250 * 8, 0);           /* Offset/width */
@@ -1569,6 +1579,13 @@ TEST (bfclr_reg, ALL_CCS, 2, WONT_CHANGE_MEMORY, NO_LIMIT)
 }
 
 
+TEST (bfclr_reg_imm, ALL_CCS, 2, WONT_CHANGE_MEMORY, NO_LIMIT)
+{
+  code[0] = R ("1110110011000rrr");
+  code[1] = randint (0, 65535) & ~0x0820;
+}
+
+
 TEST (bfclr_ind, ALL_CCS, 2, MIGHT_CHANGE_MEMORY, NO_LIMIT)
 {
   randomize_regs (0, 7, -250 * 8, 250 * 8, 0);           /* Offset/width */
@@ -1604,6 +1621,13 @@ TEST (bfset_reg, ALL_CCS, 2, WONT_CHANGE_MEMORY, NO_LIMIT)
 }
 
 
+TEST (bfset_reg_imm, ALL_CCS, 2, WONT_CHANGE_MEMORY, NO_LIMIT)
+{
+  code[0] = R ("1110111011000rrr");
+  code[1] = randint (0, 65535) & ~0x0820;
+}
+
+
 TEST (bfset_ind, ALL_CCS, 2, MIGHT_CHANGE_MEMORY, NO_LIMIT)
 {
   randomize_regs (0, 7, -250 * 8, 250 * 8, 0);           /* Offset/width */
@@ -1639,6 +1663,13 @@ TEST (bftst_reg, ALL_CCS, 2, WONT_CHANGE_MEMORY, NO_LIMIT)
 }
 
 
+TEST (bftst_reg_imm, ALL_CCS, 2, WONT_CHANGE_MEMORY, NO_LIMIT)
+{
+  code[0] = R ("1110100011000rrr");
+  code[1] = randint (0, 65535) & ~0x0820;
+}
+
+
 TEST (bftst_ind, ALL_CCS, 2, WONT_CHANGE_MEMORY, NO_LIMIT)
 {
   randomize_mem ();
@@ -1677,6 +1708,13 @@ TEST (bfexts_reg, ALL_CCS, 2, WONT_CHANGE_MEMORY, NO_LIMIT)
 }
 
 
+TEST (bfexts_reg_imm, ALL_CCS, 2, WONT_CHANGE_MEMORY, NO_LIMIT)
+{
+  code[0] = R ("1110101111000rrr");
+  code[1] = randint (0, 65535) & ~0x0820;
+}
+
+
 TEST (bfexts_ind, ALL_CCS, 2, WONT_CHANGE_MEMORY, NO_LIMIT)
 {
   randomize_mem ();
@@ -1715,6 +1753,13 @@ TEST (bfextu_reg, ALL_CCS, 2, WONT_CHANGE_MEMORY, NO_LIMIT)
 }
 
 
+TEST (bfextu_reg_imm, ALL_CCS, 2, WONT_CHANGE_MEMORY, NO_LIMIT)
+{
+  code[0] = R ("1110100111000rrr");
+  code[1] = randint (0, 65535) & ~0x0820;
+}
+
+
 TEST (bfextu_ind, ALL_CCS, 2, WONT_CHANGE_MEMORY, NO_LIMIT)
 {
   randomize_mem ();
@@ -1753,6 +1798,13 @@ TEST (bfffo_reg, ALL_CCS, 2, WONT_CHANGE_MEMORY, NO_LIMIT)
 }
 
 
+TEST (bfffo_reg_imm, ALL_CCS, 2, WONT_CHANGE_MEMORY, NO_LIMIT)
+{
+  code[0] = R ("1110110111000rrr");
+  code[1] = randint (0, 65535) & ~0x0820;
+}
+
+
 TEST (bfffo_ind, ALL_CCS, 2, WONT_CHANGE_MEMORY, NO_LIMIT)
 {
   randomize_mem ();
@@ -1791,6 +1843,13 @@ TEST (bfins_reg, ALL_CCS, 2, WONT_CHANGE_MEMORY, NO_LIMIT)
 }
 
 
+TEST (bfins_reg_imm, ALL_CCS, 2, WONT_CHANGE_MEMORY, NO_LIMIT)
+{
+  code[0] = R ("1110111111000rrr");
+  code[1] = randint (0, 65535) & ~0x0820;
+}
+
+
 TEST (bfins_ind, ALL_CCS, 2, MIGHT_CHANGE_MEMORY, NO_LIMIT)
 {
   randomize_regs (0, 7, -250 * 8, 250 * 8, 0);           /* Offset/width */
@@ -3167,6 +3226,26 @@ TEST (mulul_absl, ALL_CCS, 4, WONT_CHANGE_MEMORY, NO_LIMIT)
 }
 
 
+/* 32 bit products of a data register, which the native code handles,
+ * with operands small enough that they only sometimes overflow.  The
+ * source may be the destination.
+ */
+TEST (mulsl_dreg_32, ALL_CCS, 2, WONT_CHANGE_MEMORY, NO_LIMIT)
+{
+  randomize_regs (0, 7, -70000, 70000, 0);
+  code[0] = R ("0100110000000rrr");
+  code[1] = R ("0rrr100000000rrr");
+}
+
+
+TEST (mulul_dreg_32, ALL_CCS, 2, WONT_CHANGE_MEMORY, NO_LIMIT)
+{
+  randomize_regs (0, 7, 0, 140000, 0);
+  code[0] = R ("0100110000000rrr");
+  code[1] = R ("0rrr000000000rrr");
+}
+
+
 TEST (nbcd_reg, X_BIT | Z_BIT | C_BIT, 1, WONT_CHANGE_MEMORY, NO_LIMIT)
 {
   code[0] = R ("0100100000000rrr");
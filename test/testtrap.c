@@ -33,7 +33,8 @@ test_callbacks ()
   int i, j;
 
   for (i = 0; i < 10; i++)
-    callback_addr[i] = callback_install (handle_callback, (void *) i);
+    callback_addr[i] = callback_install (handle_callback,
+					 (void *) (intptr_t) i);
 
   for (j = 0; j < 2; j++)
     for (i = 0; i < 10; i++)